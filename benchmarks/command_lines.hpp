@@ -0,0 +1,270 @@
+﻿#pragma once
+#include <benchmark/benchmark.h>
+#include <fea_getopt/fea_getopt.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(_WIN32) && __has_include(<getopt.h>)
+#include <getopt.h>
+#define FEA_GETOPT_BENCH_GETOPT_LONG 1
+#endif
+
+namespace bench {
+// The kinds of arguments, a generated command line uses one kind.
+enum class command_e {
+	flag, // '--flag_0 --flag_1'
+	required, // '--required_0 value --required_1 value'
+	default_arg, // '--default_0 value'
+	optional, // '--optional_0 value'
+	multi, // '--multi_0 a b c'
+	concat, // '-abcdefgh -ijklmnop'
+	raw, // 'file_0.txt file_1.txt'
+	mixed, // All of the above, except concat and raw, in turn.
+	count,
+};
+
+inline constexpr std::string_view command_names[] = {
+	"flag",
+	"required",
+	"default",
+	"optional",
+	"multi",
+	"concat",
+	"raw",
+	"mixed",
+};
+
+// A generated command line, and the options it uses. ASCII only.
+struct command_line {
+	struct option {
+		std::string long_name;
+		char short_name = '\0';
+		fea::detail::user_option_e opt_type = fea::detail::user_option_e::flag;
+	};
+
+	// args[0] is arg0.
+	std::vector<std::string> args{ "tool" };
+	std::vector<option> options;
+};
+
+// The short names used by concatenated options.
+inline constexpr std::string_view short_names
+		= "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+// Generates up to argc arguments, including arg0. Concatenated options
+// stop once all short names are used.
+inline command_line make_command_line(command_e kind, size_t argc) {
+	using fea::detail::user_option_e;
+
+	command_line ret;
+	auto add = [&](std::string prefix, user_option_e t, size_t values) {
+		std::string name = prefix + std::to_string(ret.options.size());
+		ret.args.push_back("--" + name);
+		for (size_t i = 0; i < values; ++i) {
+			ret.args.push_back("value_" + std::to_string(i));
+		}
+		ret.options.push_back({ std::move(name), '\0', t });
+	};
+
+	for (size_t i = 0; ret.args.size() < argc; ++i) {
+		size_t left = argc - ret.args.size();
+		command_e k = kind;
+		if (k == command_e::mixed) {
+			k = command_e(i % size_t(command_e::concat));
+		}
+
+		switch (k) {
+		case command_e::flag: {
+			add("flag_", user_option_e::flag, 0);
+		} break;
+		case command_e::required: {
+			add("required_", user_option_e::required_arg, left >= 2 ? 1 : 0);
+			if (left < 2) {
+				// Not enough room for the value, use a flag.
+				ret.options.back().opt_type = user_option_e::flag;
+			}
+		} break;
+		case command_e::default_arg: {
+			add("default_", user_option_e::default_arg, left >= 2 ? 1 : 0);
+		} break;
+		case command_e::optional: {
+			add("optional_", user_option_e::optional_arg, left >= 2 ? 1 : 0);
+		} break;
+		case command_e::multi: {
+			if (left < 2) {
+				add("flag_", user_option_e::flag, 0);
+			} else {
+				add("multi_", user_option_e::multi_arg,
+						left >= 4 ? 3 : left - 1);
+			}
+		} break;
+		case command_e::concat: {
+			size_t used = ret.options.size();
+			if (used == short_names.size()) {
+				return ret;
+			}
+
+			std::string bundle = "-";
+			for (size_t j = used; j < used + 8 && j < short_names.size(); ++j) {
+				bundle += short_names[j];
+				ret.options.push_back({ "concat_" + std::to_string(j),
+						short_names[j], user_option_e::flag });
+			}
+			ret.args.push_back(std::move(bundle));
+		} break;
+		case command_e::raw: {
+			std::string name = "file_" + std::to_string(ret.options.size());
+			ret.args.push_back(name + ".txt");
+			ret.options.push_back({ std::move(name), '\0',
+					user_option_e::raw_arg });
+		} break;
+		default: {
+		} break;
+		}
+	}
+	return ret;
+}
+
+// Adds flags which aren't used, so there are table_size options.
+inline void pad_options(command_line& cl, size_t table_size) {
+	using fea::detail::user_option_e;
+	for (size_t i = cl.options.size(); i < table_size; ++i) {
+		cl.options.push_back(
+				{ "unused_" + std::to_string(i), '\0', user_option_e::flag });
+	}
+}
+
+// The arguments in CharT, and argv pointing to them.
+template <class CharT>
+struct widened_args {
+	explicit widened_args(const command_line& cl) {
+		for (const std::string& arg : cl.args) {
+			args.push_back(std::basic_string<CharT>(arg.begin(), arg.end()));
+		}
+		for (const std::basic_string<CharT>& arg : args) {
+			argv.push_back(arg.c_str());
+		}
+	}
+
+	std::vector<std::basic_string<CharT>> args;
+	std::vector<const CharT*> argv;
+};
+
+// Declares the options of cl. Callbacks only touch their values.
+template <class CharT>
+void add_options(fea::get_opt_spec<CharT>& spec, const command_line& cl) {
+	using fea::detail::user_option_e;
+	using string = std::basic_string<CharT>;
+	using string_view = std::basic_string_view<CharT>;
+
+	auto flag_func = []() { return true; };
+	auto one_func = [](string_view s) {
+		benchmark::DoNotOptimize(s.data());
+		return true;
+	};
+	auto multi_func = [](const std::vector<string_view>& v) {
+		benchmark::DoNotOptimize(v.data());
+		return true;
+	};
+
+	for (const command_line::option& o : cl.options) {
+		string name(o.long_name.begin(), o.long_name.end());
+		CharT short_name = CharT(o.short_name);
+
+		switch (o.opt_type) {
+		case user_option_e::flag: {
+			spec.add_flag_option(std::move(name), flag_func, {}, short_name);
+		} break;
+		case user_option_e::required_arg: {
+			spec.add_required_arg_option(
+					std::move(name), one_func, {}, short_name);
+		} break;
+		case user_option_e::default_arg: {
+			string default_val(3, CharT('d'));
+			spec.add_default_arg_option(std::move(name), one_func, {},
+					std::move(default_val), short_name);
+		} break;
+		case user_option_e::optional_arg: {
+			spec.add_optional_arg_option(
+					std::move(name), one_func, {}, short_name);
+		} break;
+		case user_option_e::multi_arg: {
+			spec.add_multi_arg_option(
+					std::move(name), multi_func, {}, short_name);
+		} break;
+		case user_option_e::raw_arg: {
+			spec.add_raw_option(std::move(name), one_func, {});
+		} break;
+		default: {
+		} break;
+		}
+	}
+}
+
+#if defined(FEA_GETOPT_BENCH_GETOPT_LONG)
+// The same options, for getopt_long.
+struct getopt_long_table {
+	explicit getopt_long_table(const command_line& cl) {
+		using fea::detail::user_option_e;
+
+		// Non-options are returned in order, as the argument of option 1.
+		short_opts = "-";
+		for (const command_line::option& o : cl.options) {
+			if (o.opt_type == user_option_e::raw_arg) {
+				continue;
+			}
+
+			int has_arg = no_argument;
+			if (o.opt_type == user_option_e::required_arg) {
+				has_arg = required_argument;
+			} else if (o.opt_type == user_option_e::optional_arg
+					|| o.opt_type == user_option_e::default_arg) {
+				// Optional values must be attached, '--opt=value'. Detached
+				// values are returned as non-options.
+				has_arg = optional_argument;
+			}
+
+			if (o.short_name != '\0') {
+				short_opts += o.short_name;
+			}
+			long_opts.push_back({ o.long_name.c_str(), has_arg, nullptr,
+					o.short_name != '\0' ? o.short_name : 2 });
+		}
+		long_opts.push_back({ nullptr, 0, nullptr, 0 });
+
+		args = cl.args;
+		for (std::string& arg : args) {
+			argv.push_back(arg.data());
+		}
+	}
+
+	// Parses the command line, returns the count of options and values.
+	size_t parse() {
+		opterr = 0;
+#if defined(__GLIBC__)
+		optind = 0;
+#else
+		optreset = 1;
+		optind = 1;
+#endif
+
+		size_t ret = 0;
+		int idx = 0;
+		int c = 0;
+		while ((c = getopt_long(int(argv.size()), argv.data(),
+						short_opts.c_str(), long_opts.data(), &idx))
+				!= -1) {
+			benchmark::DoNotOptimize(optarg);
+			ret += c == '?' ? 0 : 1;
+		}
+		return ret;
+	}
+
+	std::string short_opts;
+	std::vector<::option> long_opts;
+	std::vector<std::string> args;
+	std::vector<char*> argv;
+};
+#endif
+} // namespace bench
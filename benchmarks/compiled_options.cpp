@@ -0,0 +1,217 @@
+﻿#include "legacy_options.hpp"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <fea_getopt/compiled_options.hpp>
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_getopt/prefix_trie.hpp>
+#include <fea_getopt/suggest.hpp>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+// Option names look like generated tool options, with a shared prefix.
+std::vector<std::string> make_names(size_t count) {
+	std::vector<std::string> ret;
+	ret.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		ret.push_back("generated_option_" + std::to_string(i));
+	}
+	return ret;
+}
+
+// Lookups in a random order, so we don't measure a warm path.
+std::vector<std::string_view> make_queries(
+		const std::vector<std::string>& names) {
+	std::vector<std::string_view> ret{ names.begin(), names.end() };
+	std::shuffle(ret.begin(), ret.end(), std::mt19937{ 42 });
+	return ret;
+}
+
+void map_lookup(benchmark::State& state) {
+	std::vector<std::string> names = make_names(size_t(state.range(0)));
+	std::vector<std::string_view> queries = make_queries(names);
+
+	// What get_opt used before being frozen.
+	std::map<std::string, bench::legacy_option, std::less<>> map;
+	for (const std::string& name : names) {
+		map.insert({ name, bench::legacy_option{} });
+	}
+
+	size_t i = 0;
+	for (auto _ : state) {
+		auto it = map.find(queries[i]);
+		benchmark::DoNotOptimize(it);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(map_lookup)->Arg(10)->Arg(100)->Arg(10'000);
+
+void compiled_lookup(benchmark::State& state) {
+	std::vector<std::string> names = make_names(size_t(state.range(0)));
+	std::vector<std::string_view> queries = make_queries(names);
+
+	fea::compiled_options<char> index;
+	for (const std::string& name : names) {
+		index.add(name);
+	}
+	index.build();
+
+	size_t i = 0;
+	for (auto _ : state) {
+		size_t idx = index.find_long(queries[i]);
+		benchmark::DoNotOptimize(idx);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(compiled_lookup)->Arg(10)->Arg(100)->Arg(10'000);
+
+// Abbreviations, names without their last character. Unique prefixes of
+// '..._1' are ambiguous with '..._10' and the like.
+void prefix_lookup(benchmark::State& state) {
+	std::vector<std::string> names = make_names(size_t(state.range(0)));
+	for (std::string& name : names) {
+		name.pop_back();
+	}
+	std::vector<std::string_view> queries = make_queries(names);
+
+	fea::compiled_options<char> index;
+	for (const std::string& name : make_names(size_t(state.range(0)))) {
+		index.add(name);
+	}
+	index.build();
+	fea::detail::prefix_trie<char> trie;
+	trie.build(index);
+
+	size_t i = 0;
+	for (auto _ : state) {
+		auto r = trie.find(index, queries[i]);
+		benchmark::DoNotOptimize(r);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(prefix_lookup)->Arg(10)->Arg(100)->Arg(10'000)->Arg(1'000'000);
+
+// Misspelled names, two characters swapped. Generated names have similar
+// lengths, length buckets prune little.
+std::vector<std::string> make_typos(size_t count) {
+	std::vector<std::string> ret = make_names(count);
+	for (std::string& name : ret) {
+		std::swap(name[3], name[4]);
+	}
+	std::shuffle(ret.begin(), ret.end(), std::mt19937{ 42 });
+	return ret;
+}
+
+// What a simple "Did you mean" does, a dynamic programming distance to
+// every name.
+void levenshtein_scan(benchmark::State& state) {
+	std::vector<std::string> names = make_names(size_t(state.range(0)));
+	std::vector<std::string> queries = make_typos(names.size());
+
+	std::vector<size_t> row;
+	size_t i = 0;
+	for (auto _ : state) {
+		std::string_view query = queries[i];
+		size_t best = size_t(-1);
+		for (const std::string& name : names) {
+			row.resize(name.size() + 1);
+			for (size_t j = 0; j < row.size(); ++j) {
+				row[j] = j;
+			}
+			for (size_t q = 1; q <= query.size(); ++q) {
+				size_t diag = row[0];
+				row[0] = q;
+				for (size_t j = 1; j <= name.size(); ++j) {
+					size_t up = row[j];
+					size_t cost = query[q - 1] == name[j - 1] ? 0 : 1;
+					row[j] = (std::min)(
+							{ row[j] + 1, row[j - 1] + 1, diag + cost });
+					diag = up;
+				}
+			}
+			best = (std::min)(best, row.back());
+		}
+		benchmark::DoNotOptimize(best);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(levenshtein_scan)->Arg(10)->Arg(100)->Arg(10'000);
+
+void suggest_lookup(benchmark::State& state) {
+	std::vector<std::string> queries = make_typos(size_t(state.range(0)));
+
+	fea::compiled_options<char> index;
+	for (const std::string& name : make_names(size_t(state.range(0)))) {
+		index.add(name);
+	}
+	index.build();
+	fea::detail::suggestion_index<char> suggest;
+	suggest.build(index);
+
+	size_t i = 0;
+	for (auto _ : state) {
+		auto found = suggest.find(index, queries[i]);
+		benchmark::DoNotOptimize(found);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(suggest_lookup)->Arg(10)->Arg(100)->Arg(10'000);
+
+// Every ASCII letter, as used in '-abcdef' bundles.
+std::string make_short_queries() {
+	std::string ret;
+	for (char c = 'a'; c <= 'z'; ++c) {
+		ret += c;
+		ret += char(c - 'a' + 'A');
+	}
+	std::shuffle(ret.begin(), ret.end(), std::mt19937{ 42 });
+	return ret;
+}
+
+void unordered_map_short_lookup(benchmark::State& state) {
+	std::string queries = make_short_queries();
+
+	// What get_opt used before being frozen.
+	std::unordered_map<char, std::string> map;
+	for (char c : queries) {
+		map.insert({ c, "option_" + std::string(1, c) });
+	}
+
+	size_t i = 0;
+	for (auto _ : state) {
+		auto it = map.find(queries[i]);
+		benchmark::DoNotOptimize(it);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(unordered_map_short_lookup);
+
+void compiled_short_lookup(benchmark::State& state) {
+	std::string queries = make_short_queries();
+
+	fea::compiled_options<char> index;
+	for (char c : queries) {
+		index.add("option_" + std::string(1, c), c);
+	}
+	index.build();
+
+	size_t i = 0;
+	for (auto _ : state) {
+		size_t idx = index.find_short(queries[i]);
+		benchmark::DoNotOptimize(idx);
+		i = i + 1 == queries.size() ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(compiled_short_lookup);
+} // namespace
@@ -0,0 +1,52 @@
+﻿#include "command_lines.hpp"
+#include <benchmark/benchmark.h>
+#include <fea_getopt/fea_getopt.hpp>
+#include <string>
+
+// Help rendering, against the number of options.
+
+namespace {
+void add_documented_options(
+		fea::get_opt_spec<char>& spec, size_t option_count) {
+	bench::command_line cl
+			= bench::make_command_line(bench::command_e::mixed, 1);
+	bench::pad_options(cl, option_count);
+	bench::add_options(spec, cl);
+
+	// Descriptions which wrap, with a bit of utf8.
+	for (size_t i = 0; i < 4; ++i) {
+		spec.add_required_arg_option("documented_" + std::to_string(i),
+				[](std::string_view) { return true; },
+				"A long description, which doesn't fit on one line and must "
+				"be wrapped. Some of it is wider than ascii : 日本語のテキス"
+				"ト, and some has accents : é, è, à.");
+	}
+}
+
+// Renders the whole help, what freezing does.
+void help_render(benchmark::State& state) {
+	fea::get_opt_spec<char> spec;
+	add_documented_options(spec, size_t(state.range(0)));
+
+	for (auto _ : state) {
+		std::string help = spec.help_string("tool");
+		benchmark::DoNotOptimize(help.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(help_render)->RangeMultiplier(10)->Range(10, 10'000);
+
+// Copies the help rendered when freezing, what '--help' does.
+void help_frozen(benchmark::State& state) {
+	fea::get_opt_spec<char> spec;
+	add_documented_options(spec, size_t(state.range(0)));
+	spec.freeze();
+
+	for (auto _ : state) {
+		std::string help = spec.help_string("tool");
+		benchmark::DoNotOptimize(help.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(help_frozen)->RangeMultiplier(10)->Range(10, 10'000);
+} // namespace
@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <fea_getopt/fea_getopt.hpp>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+// How get_opt stored an option before the hot/cold option store. Every
+// option held all the callbacks and its strings.
+struct legacy_option {
+	std::string long_name;
+	char short_name = '\0';
+	fea::detail::user_option_e opt_type = fea::detail::user_option_e::count;
+
+	std::function<bool()> flag_func;
+	std::function<bool(std::string_view)> one_arg_func;
+	std::function<bool(const std::vector<std::string_view>&)> multi_arg_func;
+	std::function<fea::detail::value_status(std::string_view)> typed_func;
+	std::string value_desc;
+	bool is_bool = false;
+
+	std::string description;
+	std::string default_val;
+};
+
+// The containers of the legacy layout. Long names were also map keys, and
+// short names were mapped to a copy of the long name.
+struct legacy_options {
+	std::unordered_map<char, std::string> short_opt_to_long_opt;
+	std::map<std::string, legacy_option, std::less<>> long_opt_to_user_opt;
+	std::vector<legacy_option> raw_opts;
+};
+} // namespace bench
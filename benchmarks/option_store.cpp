@@ -0,0 +1,211 @@
+﻿#include "legacy_options.hpp"
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fea_getopt/fea_getopt.hpp>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Memory footprint of the option storage, compared to the legacy layout.
+// The bytes still allocated after building the options are counted, for
+// the whole binary. Blocks store their size before the returned pointer.
+
+// gcc sees the replaced operators as mismatched, they aren't.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+constexpr size_t header_size = alignof(std::max_align_t);
+bool counting = false;
+ptrdiff_t live_bytes = 0;
+} // namespace
+
+void* operator new(size_t size) {
+	char* ret = static_cast<char*>(std::malloc(size + header_size));
+	if (ret == nullptr) {
+		throw std::bad_alloc{};
+	}
+	std::memcpy(ret, &size, sizeof(size));
+	if (counting) {
+		live_bytes += ptrdiff_t(size);
+	}
+	return ret + header_size;
+}
+void operator delete(void* ptr) noexcept {
+	if (ptr == nullptr) {
+		return;
+	}
+	char* block = static_cast<char*>(ptr) - header_size;
+	if (counting) {
+		size_t size = 0;
+		std::memcpy(&size, block, sizeof(size));
+		live_bytes -= ptrdiff_t(size);
+	}
+	std::free(block);
+}
+void operator delete(void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+namespace {
+// What generated tools look like : long names with a shared prefix, long
+// descriptions, a few short names and defaults, mostly flags and values.
+struct generated_option {
+	std::string long_name;
+	char short_name = '\0';
+	fea::detail::user_option_e opt_type = fea::detail::user_option_e::flag;
+	std::string description;
+	std::string default_val;
+};
+
+std::vector<generated_option> make_options(size_t count) {
+	using fea::detail::user_option_e;
+
+	std::vector<generated_option> ret;
+	ret.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		generated_option o;
+		o.long_name = "generated_option_" + std::to_string(i);
+		if (i < 52) {
+			o.short_name = char(i < 26 ? 'a' + i : 'A' + i - 26);
+		}
+
+		switch (i % 4) {
+		case 0: {
+			o.opt_type = user_option_e::flag;
+		} break;
+		case 1: {
+			o.opt_type = user_option_e::required_arg;
+		} break;
+		case 2: {
+			o.opt_type = user_option_e::default_arg;
+			o.default_val = "auto";
+		} break;
+		default: {
+			o.opt_type = user_option_e::multi_arg;
+		} break;
+		}
+
+		// Generated help is often shared between options.
+		o.description = "Generated option of group " + std::to_string(i % 16)
+				+ ", see the tool documentation for more information.";
+		ret.push_back(std::move(o));
+	}
+	return ret;
+}
+
+void add_option(fea::get_opt_spec<char>& spec, const generated_option& o) {
+	using fea::detail::user_option_e;
+	std::string name = o.long_name;
+	std::string help = o.description;
+
+	switch (o.opt_type) {
+	case user_option_e::flag: {
+		spec.add_flag_option(
+				std::move(name), []() { return true; }, std::move(help),
+				o.short_name);
+	} break;
+	case user_option_e::required_arg: {
+		spec.add_required_arg_option(
+				std::move(name), [](std::string_view) { return true; },
+				std::move(help), o.short_name);
+	} break;
+	case user_option_e::default_arg: {
+		spec.add_default_arg_option(
+				std::move(name), [](std::string_view) { return true; },
+				std::move(help), std::string{ o.default_val }, o.short_name);
+	} break;
+	default: {
+		spec.add_multi_arg_option(
+				std::move(name),
+				[](const std::vector<std::string_view>&) { return true; },
+				std::move(help), o.short_name);
+	} break;
+	}
+}
+
+void add_option(bench::legacy_options& opts, const generated_option& o) {
+	using fea::detail::user_option_e;
+
+	bench::legacy_option lo;
+	lo.long_name = o.long_name;
+	lo.short_name = o.short_name;
+	lo.opt_type = o.opt_type;
+	lo.description = o.description;
+	lo.default_val = o.default_val;
+
+	switch (o.opt_type) {
+	case user_option_e::flag: {
+		lo.flag_func = []() { return true; };
+	} break;
+	case user_option_e::required_arg:
+	case user_option_e::default_arg: {
+		lo.one_arg_func = [](std::string_view) { return true; };
+	} break;
+	default: {
+		lo.multi_arg_func
+				= [](const std::vector<std::string_view>&) { return true; };
+	} break;
+	}
+
+	if (lo.short_name != '\0') {
+		opts.short_opt_to_long_opt.insert({ lo.short_name, lo.long_name });
+	}
+	std::string key = lo.long_name;
+	opts.long_opt_to_user_opt.insert({ std::move(key), std::move(lo) });
+}
+
+// The bytes the options hold once built, temporaries aren't counted.
+template <class Options>
+size_t measure(const std::vector<generated_option>& gen) {
+	live_bytes = 0;
+	counting = true;
+	Options opts;
+	for (const generated_option& o : gen) {
+		add_option(opts, o);
+	}
+	counting = false;
+	benchmark::DoNotOptimize(opts);
+	return size_t(live_bytes);
+}
+
+void report(benchmark::State& state, size_t bytes) {
+	state.counters["bytes"] = double(bytes);
+	state.counters["bytes_per_option"] = double(bytes) / double(state.range(0));
+}
+
+void legacy_memory(benchmark::State& state) {
+	std::vector<generated_option> gen = make_options(size_t(state.range(0)));
+	size_t bytes = 0;
+	for (auto _ : state) {
+		bytes = measure<bench::legacy_options>(gen);
+	}
+	report(state, bytes);
+}
+BENCHMARK(legacy_memory)->Arg(100)->Arg(5'000);
+
+void option_store_memory(benchmark::State& state) {
+	std::vector<generated_option> gen = make_options(size_t(state.range(0)));
+	size_t bytes = 0;
+	for (auto _ : state) {
+		bytes = measure<fea::get_opt_spec<char>>(gen);
+	}
+	report(state, bytes);
+
+	// The breakdown, as reported by the spec.
+	fea::get_opt_spec<char> spec;
+	for (const generated_option& o : gen) {
+		add_option(spec, o);
+	}
+	fea::option_memory mem = spec.memory_usage();
+	state.counters["hot"] = double(mem.hot);
+	state.counters["cold"] = double(mem.cold);
+	state.counters["index"] = double(mem.index);
+}
+BENCHMARK(option_store_memory)->Arg(100)->Arg(5'000);
+} // namespace
@@ -0,0 +1,125 @@
+﻿#include "command_lines.hpp"
+#include <benchmark/benchmark.h>
+#include <fea_getopt/fea_getopt.hpp>
+
+// Parse throughput, in arguments per second.
+// getopt_long baselines parse the same command lines. It scans its option
+// table for every long option, its baselines stop at 10k arguments and
+// options.
+
+namespace {
+template <class CharT>
+void run_parse(benchmark::State& state, const bench::command_line& cl,
+		fea::get_opt_engine engine = fea::get_opt_engine::loop) {
+	fea::get_opt<CharT> opt;
+	bench::add_options(opt, cl);
+	opt.parse_engine(engine);
+
+	bench::widened_args<CharT> args{ cl };
+	if (!opt.parse_options(args.argv.size(), args.argv.data())) {
+		state.SkipWithError("Couldn't parse the command line.");
+		return;
+	}
+
+	for (auto _ : state) {
+		bool success = opt.parse_options(args.argv.size(), args.argv.data());
+		benchmark::DoNotOptimize(success);
+	}
+	state.SetItemsProcessed(
+			state.iterations() * int64_t(args.argv.size() - 1));
+}
+
+#if defined(FEA_GETOPT_BENCH_GETOPT_LONG)
+void run_getopt_long(benchmark::State& state, const bench::command_line& cl) {
+	bench::getopt_long_table table{ cl };
+	for (auto _ : state) {
+		size_t parsed = table.parse();
+		benchmark::DoNotOptimize(parsed);
+	}
+	state.SetItemsProcessed(
+			state.iterations() * int64_t(table.argv.size() - 1));
+}
+#endif
+
+// Throughput against argc, with all option kinds.
+void parse_argc(benchmark::State& state) {
+	bench::command_line cl = bench::make_command_line(
+			bench::command_e::mixed, size_t(state.range(0)));
+	run_parse<char>(state, cl);
+}
+BENCHMARK(parse_argc)->RangeMultiplier(10)->Range(10, 1'000'000);
+
+// Throughput against the number of declared options, with the same
+// command line.
+void parse_table_size(benchmark::State& state) {
+	bench::command_line cl
+			= bench::make_command_line(bench::command_e::mixed, 64);
+	bench::pad_options(cl, size_t(state.range(0)));
+	run_parse<char>(state, cl);
+}
+BENCHMARK(parse_table_size)->RangeMultiplier(10)->Range(100, 100'000);
+
+// A daemon which parses tiny command lines against a large table. Resetting
+// between parses mustn't depend on the table size.
+void parse_small_command_line(benchmark::State& state) {
+	bench::command_line cl
+			= bench::make_command_line(bench::command_e::flag, 2);
+	bench::pad_options(cl, size_t(state.range(0)));
+	run_parse<char>(state, cl);
+}
+BENCHMARK(parse_small_command_line)
+		->RangeMultiplier(10)
+		->Range(100, 100'000);
+
+// Throughput of each option kind.
+void parse_kind(benchmark::State& state) {
+	bench::command_e kind = bench::command_e(state.range(0));
+	state.SetLabel(std::string{ bench::command_names[state.range(0)] });
+	run_parse<char>(state, bench::make_command_line(kind, 256));
+}
+BENCHMARK(parse_kind)->DenseRange(0, int64_t(bench::command_e::count) - 1);
+
+// Throughput of each character type.
+template <class CharT>
+void parse_char_type(benchmark::State& state) {
+	run_parse<CharT>(
+			state, bench::make_command_line(bench::command_e::mixed, 1'000));
+}
+BENCHMARK_TEMPLATE(parse_char_type, char);
+BENCHMARK_TEMPLATE(parse_char_type, wchar_t);
+BENCHMARK_TEMPLATE(parse_char_type, char16_t);
+BENCHMARK_TEMPLATE(parse_char_type, char32_t);
+
+// The state machine engine, compared to parse_char_type<char>.
+void parse_fsm_engine(benchmark::State& state) {
+	run_parse<char>(state,
+			bench::make_command_line(bench::command_e::mixed, 1'000),
+			fea::get_opt_engine::fsm);
+}
+BENCHMARK(parse_fsm_engine);
+
+#if defined(FEA_GETOPT_BENCH_GETOPT_LONG)
+void getopt_long_argc(benchmark::State& state) {
+	run_getopt_long(state,
+			bench::make_command_line(
+					bench::command_e::mixed, size_t(state.range(0))));
+}
+BENCHMARK(getopt_long_argc)->RangeMultiplier(10)->Range(10, 10'000);
+
+void getopt_long_table_size(benchmark::State& state) {
+	bench::command_line cl
+			= bench::make_command_line(bench::command_e::mixed, 64);
+	bench::pad_options(cl, size_t(state.range(0)));
+	run_getopt_long(state, cl);
+}
+BENCHMARK(getopt_long_table_size)->RangeMultiplier(10)->Range(100, 10'000);
+
+void getopt_long_kind(benchmark::State& state) {
+	bench::command_e kind = bench::command_e(state.range(0));
+	state.SetLabel(std::string{ bench::command_names[state.range(0)] });
+	run_getopt_long(state, bench::make_command_line(kind, 256));
+}
+BENCHMARK(getopt_long_kind)
+		->DenseRange(0, int64_t(bench::command_e::count) - 1);
+#endif
+} // namespace
@@ -0,0 +1,65 @@
+﻿#include <array>
+#include <benchmark/benchmark.h>
+#include <fea_getopt/fea_getopt.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Startup of a multi-tool, from nothing to one parsed subcommand. Each
+// subcommand has 40 options, the command line invokes one of them.
+
+namespace {
+constexpr size_t options_per_subcommand = 40;
+
+int print_nothing(const std::string&) {
+	return 0;
+}
+
+using get_opt_t = fea::get_opt<char, decltype(&print_nothing)>;
+
+void add_subcommand_options(get_opt_t& opt, size_t sub_idx) {
+	std::string prefix = "sub" + std::to_string(sub_idx) + "_option_";
+	for (size_t i = 0; i < options_per_subcommand; ++i) {
+		opt.add_required_arg_option(
+				prefix + std::to_string(i),
+				[](std::string_view) { return true; }, "An option.");
+	}
+}
+
+// One get_opt per subcommand, all built up front.
+void eager_subcommands(benchmark::State& state) {
+	size_t sub_count = size_t(state.range(0));
+	std::array<const char*, 3> argv{ "tool.exe", "--sub0_option_0", "a" };
+
+	for (auto _ : state) {
+		std::vector<std::unique_ptr<get_opt_t>> subs;
+		for (size_t i = 0; i < sub_count; ++i) {
+			subs.push_back(std::make_unique<get_opt_t>(&print_nothing));
+			add_subcommand_options(*subs.back(), i);
+		}
+		bool success = subs[0]->parse_options(argv.size(), argv.data());
+		benchmark::DoNotOptimize(success);
+	}
+}
+BENCHMARK(eager_subcommands)->Arg(10)->Arg(150)->Arg(1'000);
+
+// Subcommands built by their factory, once parsed.
+void lazy_subcommands(benchmark::State& state) {
+	size_t sub_count = size_t(state.range(0));
+	std::array<const char*, 4> argv{ "tool.exe", "sub0", "--sub0_option_0",
+		"a" };
+
+	for (auto _ : state) {
+		get_opt_t opt{ &print_nothing };
+		for (size_t i = 0; i < sub_count; ++i) {
+			opt.add_subcommand(
+					"sub" + std::to_string(i),
+					[i](get_opt_t& sub) { add_subcommand_options(sub, i); },
+					"A subcommand.");
+		}
+		bool success = opt.parse_options(argv.size(), argv.data());
+		benchmark::DoNotOptimize(success);
+	}
+}
+BENCHMARK(lazy_subcommands)->Arg(10)->Arg(150)->Arg(1'000);
+} // namespace
@@ -0,0 +1,192 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_getopt/response_file.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/*
+parse_batch validates many command lines at once, with all cores. Every
+worker thread parses with its own get_opt_context, the spec is shared.
+
+Lines are split like response files : arguments are separated by
+whitespace, and quotes group arguments which contain spaces. The first
+argument of a line is its arg0. Empty lines succeed.
+
+Your callbacks and print function are called from all worker threads,
+they must be thread-safe.
+
+ex :
+fea::get_opt_spec<char> spec;
+spec.add_flag_option("verbose", []() { return true; }, "Verbose.", 'v');
+spec.freeze();
+std::vector<std::string_view> lines{ "tool -v", "tool --bad" };
+std::vector<bool> valid = fea::parse_batch(spec, lines);
+*/
+
+namespace fea {
+namespace detail {
+// Lines are split into chunks, each worker first parses the chunks of its own
+// range. Once it is empty, the worker steals chunks from the other ranges.
+// Owners and thieves take chunks with the same atomic cursor.
+struct batch_range {
+	alignas(64) std::atomic<size_t> next{ 0 };
+	size_t end = 0;
+};
+
+template <class CharT, class PrintfT>
+bool parse_batch_line(get_opt_context<CharT, PrintfT>& ctx,
+		std::basic_string_view<CharT> line) {
+	response_tokenizer<CharT> tokens{ line };
+
+	std::basic_string_view<CharT> tok;
+	if (!tokens.next(tok)) {
+		return true;
+	}
+
+	do {
+		if (!ctx.feed(tok)) {
+			break;
+		}
+	} while (tokens.next(tok));
+
+	return ctx.finish();
+}
+} // namespace detail
+
+// Parses every line of lines, returns their success in input order.
+// Lines is a random access range of things convertible to string_view.
+// Uses hardware_concurrency threads when num_threads is 0. The calling thread
+// parses too. Workers are started and joined by every call, batches are
+// expected to be large. Fewer workers are used if threads can't be created.
+// Exceptions thrown by callbacks are rethrown once all threads are done.
+template <class CharT, class PrintfT, class Range>
+std::vector<bool> parse_batch(const get_opt_spec<CharT, PrintfT>& spec,
+		const Range& lines, size_t num_threads = 0) {
+	using string_view = std::basic_string_view<CharT>;
+	constexpr size_t chunk_size = 64;
+
+	if (!spec.frozen()) {
+		throw std::invalid_argument{
+			"fea::parse_batch : The spec must be frozen before parsing."
+		};
+	}
+
+	const size_t size = std::size(lines);
+	const size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+	if (num_threads == 0) {
+		num_threads = std::max(size_t(std::thread::hardware_concurrency()),
+				size_t(1));
+	}
+	num_threads = std::max(std::min(num_threads, num_chunks), size_t(1));
+
+	// One range of chunks per worker.
+	std::unique_ptr<detail::batch_range[]> ranges
+			= std::make_unique<detail::batch_range[]>(num_threads);
+	for (size_t i = 0; i < num_threads; ++i) {
+		ranges[i].next = num_chunks * i / num_threads;
+		ranges[i].end = num_chunks * (i + 1) / num_threads;
+	}
+
+	// Not a vector<bool>, workers write neighbouring results.
+	std::vector<std::uint8_t> results(size, 0);
+
+	std::atomic<bool> failed{ false };
+	std::exception_ptr error;
+
+	auto work = [&](size_t worker_idx) {
+		try {
+			get_opt_context<CharT, PrintfT> ctx{ spec };
+
+			for (size_t i = 0; i < num_threads; ++i) {
+				// Own range first, then the next ones.
+				detail::batch_range& r
+						= ranges[(worker_idx + i) % num_threads];
+
+				while (!failed.load(std::memory_order_relaxed)) {
+					size_t chunk = r.next.fetch_add(1);
+					if (chunk >= r.end) {
+						break;
+					}
+
+					size_t end = std::min((chunk + 1) * chunk_size, size);
+					for (size_t l = chunk * chunk_size; l < end; ++l) {
+						results[l] = detail::parse_batch_line(
+								ctx, string_view{ lines[l] });
+					}
+				}
+			}
+		} catch (...) {
+			// Keep the first exception, stop everyone.
+			if (!failed.exchange(true)) {
+				error = std::current_exception();
+			}
+		}
+	};
+
+	// When the system runs out of threads, the workers which started steal
+	// the ranges of the missing ones.
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads - 1);
+	for (size_t i = 1; i < num_threads; ++i) {
+		try {
+			threads.emplace_back(work, i);
+		} catch (const std::system_error&) {
+			break;
+		}
+	}
+	work(0);
+
+	for (std::thread& t : threads) {
+		t.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	return std::vector<bool>(results.begin(), results.end());
+}
+} // namespace fea
@@ -0,0 +1,406 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+compiled_options is a flat, read-only index of option names.
+
+Long names are interned one after the other in a single buffer, and looked
+up with an open-addressing hash table (linear probing). ASCII short names
+are looked up in a direct table, other short names in a small sorted
+array. Lookups return the index of the option, in insertion order.
+Options without a long name are only found by their short name.
+
+Add all your options, then call build(). Adding options after building
+requires a new build(). Options can also be inserted one at a time, the
+index is then kept up to date without calling build().
+
+ex :
+fea::compiled_options<char> index;
+index.add("verbose", 'v');
+index.add("jobs", 'j');
+index.build();
+
+size_t idx = index.find_long("jobs"); // 1
+*/
+
+namespace fea {
+namespace detail {
+template <class CharT>
+constexpr std::uint64_t fnv1a(std::basic_string_view<CharT> str) {
+	std::uint64_t ret = 14695981039346656037ull;
+	for (CharT c : str) {
+		ret ^= std::uint64_t(std::make_unsigned_t<CharT>(c));
+		ret *= 1099511628211ull;
+	}
+	return ret;
+}
+
+constexpr std::uint64_t hash_mix(std::uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+// Reads 8 bytes at a time, for runtime lookups.
+template <class CharT>
+std::uint64_t word_hash(std::basic_string_view<CharT> str) {
+	const unsigned char* data
+			= reinterpret_cast<const unsigned char*>(str.data());
+	size_t size = str.size() * sizeof(CharT);
+
+	std::uint64_t ret = 14695981039346656037ull ^ size;
+	std::uint64_t word = 0;
+	while (size >= sizeof(word)) {
+		std::memcpy(&word, data, sizeof(word));
+		ret = (ret ^ word) * 0x9e3779b97f4a7c15ull;
+		ret ^= ret >> 29;
+		data += sizeof(word);
+		size -= sizeof(word);
+	}
+
+	word = 0;
+	std::memcpy(&word, data, size);
+	return hash_mix(ret ^ word);
+}
+
+constexpr size_t next_pow2(size_t val) {
+	size_t ret = 1;
+	while (ret < val) {
+		ret <<= 1;
+	}
+	return ret;
+}
+} // namespace detail
+
+template <class CharT>
+struct compiled_options {
+	using string_view = std::basic_string_view<CharT>;
+
+	static constexpr size_t npos = size_t(-1);
+
+	// Interns the option names. Returns the option index.
+	// A null short_name means the option has no short name.
+	size_t add(string_view long_name, CharT short_name = CharT('\0'));
+
+	// Builds the lookup tables. Throws on duplicate names.
+	void build();
+
+	// Interns and indexes an option right away, the index stays usable
+	// without calling build(). Throws on duplicate names.
+	// Don't mix with add(), unless build() was called since.
+	size_t insert(string_view long_name, CharT short_name = CharT('\0'));
+
+	// Removes all options.
+	void clear();
+
+	// Returns the option index, or npos.
+	size_t find_long(string_view long_name) const;
+	size_t find_short(CharT short_name) const;
+
+	// The interned long name of an option.
+	string_view long_name(size_t idx) const;
+
+	size_t size() const;
+	bool empty() const;
+
+	// The bytes allocated by the index.
+	size_t memory_usage() const;
+
+private:
+	static constexpr std::uint32_t empty_slot
+			= (std::numeric_limits<std::uint32_t>::max)();
+
+	struct slot {
+		// Low bits of the name hash, compared before the name.
+		std::uint32_t hash = 0;
+		std::uint32_t idx = empty_slot;
+	};
+
+	static std::uint64_t hash(string_view long_name);
+
+	// Long names, one after the other.
+	std::vector<CharT> _names;
+	// Where each name starts in _names, plus one past the last name.
+	std::vector<std::uint32_t> _name_offsets{ 0 };
+
+	// Power of 2 sized, at most half full.
+	std::vector<slot> _slots;
+
+	// All short names, in insertion order.
+	std::vector<std::pair<CharT, std::uint32_t>> _short_opts;
+
+	// ASCII short names point directly to their option.
+	std::array<std::uint32_t, 128> _ascii_short_opts = make_ascii_table();
+	// The other short names, sorted.
+	std::vector<std::pair<CharT, std::uint32_t>> _wide_short_opts;
+
+	static constexpr std::array<std::uint32_t, 128> make_ascii_table() {
+		std::array<std::uint32_t, 128> ret{};
+		for (std::uint32_t& idx : ret) {
+			idx = empty_slot;
+		}
+		return ret;
+	}
+
+	static constexpr bool is_ascii(CharT c) {
+		return std::make_unsigned_t<CharT>(c) < 128;
+	}
+};
+
+
+template <class CharT>
+size_t compiled_options<CharT>::add(string_view long_name, CharT short_name) {
+	if (_names.size() + long_name.size() >= empty_slot) {
+		throw std::length_error{
+			"compiled_options::add : Too many option names."
+		};
+	}
+
+	size_t ret = size();
+	_names.insert(_names.end(), long_name.begin(), long_name.end());
+	_name_offsets.push_back(std::uint32_t(_names.size()));
+
+	if (short_name != CharT('\0')) {
+		_short_opts.push_back({ short_name, std::uint32_t(ret) });
+	}
+	return ret;
+}
+
+template <class CharT>
+void compiled_options<CharT>::build() {
+	_slots.clear();
+	_slots.resize(detail::next_pow2(size() * 2 + 1));
+	const size_t mask = _slots.size() - 1;
+
+	for (size_t i = 0; i < size(); ++i) {
+		string_view name = long_name(i);
+		if (name.empty()) {
+			continue;
+		}
+		std::uint64_t h = hash(name);
+
+		size_t pos = size_t(h) & mask;
+		while (_slots[pos].idx != empty_slot) {
+			if (_slots[pos].hash == std::uint32_t(h)
+					&& long_name(_slots[pos].idx) == name) {
+				throw std::invalid_argument{
+					"compiled_options::build : Long option already exists."
+				};
+			}
+			pos = (pos + 1) & mask;
+		}
+		_slots[pos] = slot{ std::uint32_t(h), std::uint32_t(i) };
+	}
+
+	_ascii_short_opts = make_ascii_table();
+	_wide_short_opts.clear();
+
+	for (const std::pair<CharT, std::uint32_t>& p : _short_opts) {
+		if (!is_ascii(p.first)) {
+			_wide_short_opts.push_back(p);
+			continue;
+		}
+
+		std::uint32_t& idx
+				= _ascii_short_opts[std::make_unsigned_t<CharT>(p.first)];
+		if (idx != empty_slot) {
+			throw std::invalid_argument{
+				"compiled_options::build : Short option already exists."
+			};
+		}
+		idx = p.second;
+	}
+
+	std::sort(_wide_short_opts.begin(), _wide_short_opts.end(),
+			[](const auto& lhs, const auto& rhs) {
+				return lhs.first < rhs.first;
+			});
+
+	auto it = std::adjacent_find(_wide_short_opts.begin(),
+			_wide_short_opts.end(), [](const auto& lhs, const auto& rhs) {
+				return lhs.first == rhs.first;
+			});
+	if (it != _wide_short_opts.end()) {
+		throw std::invalid_argument{
+			"compiled_options::build : Short option already exists."
+		};
+	}
+}
+
+template <class CharT>
+size_t compiled_options<CharT>::insert(
+		string_view long_name, CharT short_name) {
+	if (find_long(long_name) != npos) {
+		throw std::invalid_argument{
+			"compiled_options::insert : Long option already exists."
+		};
+	}
+	if (short_name != CharT('\0') && find_short(short_name) != npos) {
+		throw std::invalid_argument{
+			"compiled_options::insert : Short option already exists."
+		};
+	}
+
+	size_t ret = add(long_name, short_name);
+
+	// Keep the table at most half full, rehash everything when growing.
+	if (_slots.size() < size() * 2 + 1) {
+		build();
+		return ret;
+	}
+
+	if (!long_name.empty()) {
+		std::uint64_t h = hash(long_name);
+		const size_t mask = _slots.size() - 1;
+		size_t pos = size_t(h) & mask;
+		while (_slots[pos].idx != empty_slot) {
+			pos = (pos + 1) & mask;
+		}
+		_slots[pos] = slot{ std::uint32_t(h), std::uint32_t(ret) };
+	}
+
+	if (short_name == CharT('\0')) {
+		return ret;
+	}
+
+	if (is_ascii(short_name)) {
+		_ascii_short_opts[std::make_unsigned_t<CharT>(short_name)]
+				= std::uint32_t(ret);
+	} else {
+		auto it = std::lower_bound(_wide_short_opts.begin(),
+				_wide_short_opts.end(), short_name,
+				[](const auto& p, CharT c) { return p.first < c; });
+		_wide_short_opts.insert(it, { short_name, std::uint32_t(ret) });
+	}
+	return ret;
+}
+
+template <class CharT>
+void compiled_options<CharT>::clear() {
+	_names.clear();
+	_name_offsets.clear();
+	_name_offsets.push_back(0);
+	_slots.clear();
+	_short_opts.clear();
+	_ascii_short_opts = make_ascii_table();
+	_wide_short_opts.clear();
+}
+
+template <class CharT>
+size_t compiled_options<CharT>::find_long(string_view long_name) const {
+	if (_slots.empty() || long_name.empty()) {
+		return npos;
+	}
+
+	std::uint64_t h = hash(long_name);
+	const size_t mask = _slots.size() - 1;
+
+	// The table is never full, we always hit an empty slot.
+	for (size_t pos = size_t(h) & mask;; pos = (pos + 1) & mask) {
+		const slot& s = _slots[pos];
+		if (s.idx == empty_slot) {
+			return npos;
+		}
+
+		if (s.hash == std::uint32_t(h) && this->long_name(s.idx) == long_name) {
+			return s.idx;
+		}
+	}
+}
+
+template <class CharT>
+size_t compiled_options<CharT>::find_short(CharT short_name) const {
+	if (is_ascii(short_name)) {
+		std::uint32_t idx
+				= _ascii_short_opts[std::make_unsigned_t<CharT>(short_name)];
+		return idx == empty_slot ? npos : idx;
+	}
+
+	auto it = std::lower_bound(_wide_short_opts.begin(),
+			_wide_short_opts.end(), short_name,
+			[](const auto& p, CharT c) { return p.first < c; });
+
+	if (it == _wide_short_opts.end() || it->first != short_name) {
+		return npos;
+	}
+	return it->second;
+}
+
+template <class CharT>
+auto compiled_options<CharT>::long_name(size_t idx) const -> string_view {
+	assert(idx < size());
+	std::uint32_t beg = _name_offsets[idx];
+	return string_view{ _names.data() + beg, _name_offsets[idx + 1] - beg };
+}
+
+template <class CharT>
+size_t compiled_options<CharT>::size() const {
+	return _name_offsets.size() - 1;
+}
+
+template <class CharT>
+bool compiled_options<CharT>::empty() const {
+	return size() == 0;
+}
+
+template <class CharT>
+size_t compiled_options<CharT>::memory_usage() const {
+	return _names.capacity() * sizeof(CharT)
+			+ _name_offsets.capacity() * sizeof(std::uint32_t)
+			+ _slots.capacity() * sizeof(slot)
+			+ (_short_opts.capacity() + _wide_short_opts.capacity())
+			* sizeof(std::pair<CharT, std::uint32_t>);
+}
+
+template <class CharT>
+std::uint64_t compiled_options<CharT>::hash(string_view long_name) {
+	return detail::word_hash(long_name);
+}
+} // namespace fea
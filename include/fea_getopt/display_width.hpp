@@ -0,0 +1,472 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+Measures how many terminal columns a string takes, for help layout.
+
+Strings are decoded in place, utf8 for char, utf16 for char16_t, utf32 for
+char32_t, and utf16 or utf32 for wchar_t depending on its size. Runs of
+ascii are measured 8 bytes at a time. Other code points use compact range
+tables :
+- Combining marks, format and zero width characters take 0 columns.
+- East Asian Wide and Fullwidth characters take 2 columns (CJK, Hangul,
+  Kana, fullwidth forms and most emoji).
+- Everything else takes 1 column. Invalid sequences take 1 column per code
+  unit.
+*/
+
+namespace fea {
+namespace detail {
+struct codepoint_range {
+	char32_t first;
+	char32_t last;
+};
+
+// Zero width code points.
+inline constexpr codepoint_range zero_width_ranges[] = {
+	{ 0x0300, 0x036F },
+	{ 0x0483, 0x0489 },
+	{ 0x0591, 0x05BD },
+	{ 0x05BF, 0x05BF },
+	{ 0x05C1, 0x05C2 },
+	{ 0x05C4, 0x05C5 },
+	{ 0x05C7, 0x05C7 },
+	{ 0x0610, 0x061A },
+	{ 0x064B, 0x065F },
+	{ 0x0670, 0x0670 },
+	{ 0x06D6, 0x06DC },
+	{ 0x06DF, 0x06E4 },
+	{ 0x06E7, 0x06E8 },
+	{ 0x06EA, 0x06ED },
+	{ 0x0711, 0x0711 },
+	{ 0x0730, 0x074A },
+	{ 0x07A6, 0x07B0 },
+	{ 0x07EB, 0x07F3 },
+	{ 0x0816, 0x082D },
+	{ 0x0859, 0x085B },
+	{ 0x08D3, 0x0902 },
+	{ 0x093A, 0x093A },
+	{ 0x093C, 0x093C },
+	{ 0x0941, 0x0948 },
+	{ 0x094D, 0x094D },
+	{ 0x0951, 0x0957 },
+	{ 0x0962, 0x0963 },
+	{ 0x0981, 0x0981 },
+	{ 0x09BC, 0x09BC },
+	{ 0x09C1, 0x09C4 },
+	{ 0x09CD, 0x09CD },
+	{ 0x09E2, 0x09E3 },
+	{ 0x0A01, 0x0A02 },
+	{ 0x0A3C, 0x0A3C },
+	{ 0x0A41, 0x0A51 },
+	{ 0x0A70, 0x0A71 },
+	{ 0x0A75, 0x0A75 },
+	{ 0x0A81, 0x0A82 },
+	{ 0x0ABC, 0x0ABC },
+	{ 0x0AC1, 0x0AC8 },
+	{ 0x0ACD, 0x0ACD },
+	{ 0x0AE2, 0x0AE3 },
+	{ 0x0B01, 0x0B01 },
+	{ 0x0B3C, 0x0B3C },
+	{ 0x0B3F, 0x0B3F },
+	{ 0x0B41, 0x0B44 },
+	{ 0x0B4D, 0x0B4D },
+	{ 0x0B56, 0x0B56 },
+	{ 0x0B62, 0x0B63 },
+	{ 0x0B82, 0x0B82 },
+	{ 0x0BC0, 0x0BC0 },
+	{ 0x0BCD, 0x0BCD },
+	{ 0x0C3E, 0x0C40 },
+	{ 0x0C46, 0x0C56 },
+	{ 0x0CBC, 0x0CBC },
+	{ 0x0CCC, 0x0CCD },
+	{ 0x0D41, 0x0D44 },
+	{ 0x0D4D, 0x0D4D },
+	{ 0x0DCA, 0x0DCA },
+	{ 0x0DD2, 0x0DD6 },
+	{ 0x0E31, 0x0E31 },
+	{ 0x0E34, 0x0E3A },
+	{ 0x0E47, 0x0E4E },
+	{ 0x0EB1, 0x0EB1 },
+	{ 0x0EB4, 0x0EBC },
+	{ 0x0EC8, 0x0ECD },
+	{ 0x0F18, 0x0F19 },
+	{ 0x0F35, 0x0F35 },
+	{ 0x0F37, 0x0F37 },
+	{ 0x0F39, 0x0F39 },
+	{ 0x0F71, 0x0F7E },
+	{ 0x0F80, 0x0F84 },
+	{ 0x0F86, 0x0F87 },
+	{ 0x0F8D, 0x0FBC },
+	{ 0x0FC6, 0x0FC6 },
+	{ 0x102D, 0x1030 },
+	{ 0x1032, 0x1037 },
+	{ 0x1039, 0x103A },
+	{ 0x1058, 0x1059 },
+	{ 0x1160, 0x11FF },
+	{ 0x135D, 0x135F },
+	{ 0x1712, 0x1714 },
+	{ 0x17B4, 0x17B5 },
+	{ 0x17B7, 0x17BD },
+	{ 0x17C6, 0x17C6 },
+	{ 0x17C9, 0x17D3 },
+	{ 0x180B, 0x180F },
+	{ 0x1AB0, 0x1AFF },
+	{ 0x1DC0, 0x1DFF },
+	{ 0x200B, 0x200F },
+	{ 0x202A, 0x202E },
+	{ 0x2060, 0x2064 },
+	{ 0x20D0, 0x20FF },
+	{ 0x2CEF, 0x2CF1 },
+	{ 0x2DE0, 0x2DFF },
+	{ 0x302A, 0x302D },
+	{ 0x3099, 0x309A },
+	{ 0xA66F, 0xA672 },
+	{ 0xA674, 0xA67D },
+	{ 0xA69E, 0xA69F },
+	{ 0xA6F0, 0xA6F1 },
+	{ 0xA802, 0xA802 },
+	{ 0xA806, 0xA806 },
+	{ 0xA80B, 0xA80B },
+	{ 0xA825, 0xA826 },
+	{ 0xFB1E, 0xFB1E },
+	{ 0xFE00, 0xFE0F },
+	{ 0xFE20, 0xFE2F },
+	{ 0xFEFF, 0xFEFF },
+	{ 0xFFF9, 0xFFFB },
+	{ 0x1D167, 0x1D169 },
+	{ 0x1D173, 0x1D182 },
+	{ 0x1D185, 0x1D18B },
+	{ 0x1D1AA, 0x1D1AD },
+	{ 0x1F3FB, 0x1F3FF },
+	{ 0xE0001, 0xE0001 },
+	{ 0xE0020, 0xE007F },
+	{ 0xE0100, 0xE01EF },
+};
+
+// East Asian Wide and Fullwidth code points.
+inline constexpr codepoint_range wide_ranges[] = {
+	{ 0x1100, 0x115F },
+	{ 0x231A, 0x231B },
+	{ 0x2329, 0x232A },
+	{ 0x23E9, 0x23EC },
+	{ 0x23F0, 0x23F0 },
+	{ 0x23F3, 0x23F3 },
+	{ 0x25FD, 0x25FE },
+	{ 0x2614, 0x2615 },
+	{ 0x2648, 0x2653 },
+	{ 0x267F, 0x267F },
+	{ 0x2693, 0x2693 },
+	{ 0x26A1, 0x26A1 },
+	{ 0x26AA, 0x26AB },
+	{ 0x26BD, 0x26BE },
+	{ 0x26C4, 0x26C5 },
+	{ 0x26CE, 0x26CE },
+	{ 0x26D4, 0x26D4 },
+	{ 0x26EA, 0x26EA },
+	{ 0x26F2, 0x26F3 },
+	{ 0x26F5, 0x26F5 },
+	{ 0x26FA, 0x26FA },
+	{ 0x26FD, 0x26FD },
+	{ 0x2705, 0x2705 },
+	{ 0x270A, 0x270B },
+	{ 0x2728, 0x2728 },
+	{ 0x274C, 0x274C },
+	{ 0x274E, 0x274E },
+	{ 0x2753, 0x2755 },
+	{ 0x2757, 0x2757 },
+	{ 0x2795, 0x2797 },
+	{ 0x27B0, 0x27B0 },
+	{ 0x27BF, 0x27BF },
+	{ 0x2B1B, 0x2B1C },
+	{ 0x2B50, 0x2B50 },
+	{ 0x2B55, 0x2B55 },
+	{ 0x2E80, 0x3029 },
+	{ 0x302E, 0x303E },
+	{ 0x3041, 0x3098 },
+	{ 0x309B, 0x4DBF },
+	{ 0x4E00, 0xA4CF },
+	{ 0xA960, 0xA97F },
+	{ 0xAC00, 0xD7A3 },
+	{ 0xF900, 0xFAFF },
+	{ 0xFE10, 0xFE19 },
+	{ 0xFE30, 0xFE6F },
+	{ 0xFF00, 0xFF60 },
+	{ 0xFFE0, 0xFFE6 },
+	{ 0x16FE0, 0x16FE4 },
+	{ 0x17000, 0x18AFF },
+	{ 0x1B000, 0x1B2FF },
+	{ 0x1F004, 0x1F004 },
+	{ 0x1F0CF, 0x1F0CF },
+	{ 0x1F18E, 0x1F18E },
+	{ 0x1F191, 0x1F19A },
+	{ 0x1F200, 0x1F202 },
+	{ 0x1F210, 0x1F23B },
+	{ 0x1F240, 0x1F248 },
+	{ 0x1F250, 0x1F251 },
+	{ 0x1F260, 0x1F265 },
+	{ 0x1F300, 0x1F320 },
+	{ 0x1F32D, 0x1F335 },
+	{ 0x1F337, 0x1F37C },
+	{ 0x1F37E, 0x1F393 },
+	{ 0x1F3A0, 0x1F3CA },
+	{ 0x1F3CF, 0x1F3D3 },
+	{ 0x1F3E0, 0x1F3F0 },
+	{ 0x1F3F4, 0x1F3F4 },
+	{ 0x1F3F8, 0x1F3FA },
+	{ 0x1F400, 0x1F43E },
+	{ 0x1F440, 0x1F440 },
+	{ 0x1F442, 0x1F4FC },
+	{ 0x1F4FF, 0x1F53D },
+	{ 0x1F54B, 0x1F54E },
+	{ 0x1F550, 0x1F567 },
+	{ 0x1F57A, 0x1F57A },
+	{ 0x1F595, 0x1F596 },
+	{ 0x1F5A4, 0x1F5A4 },
+	{ 0x1F5FB, 0x1F64F },
+	{ 0x1F680, 0x1F6C5 },
+	{ 0x1F6CC, 0x1F6CC },
+	{ 0x1F6D0, 0x1F6D2 },
+	{ 0x1F6D5, 0x1F6D7 },
+	{ 0x1F6EB, 0x1F6EC },
+	{ 0x1F6F4, 0x1F6FC },
+	{ 0x1F7E0, 0x1F7EB },
+	{ 0x1F90C, 0x1F93A },
+	{ 0x1F93C, 0x1F945 },
+	{ 0x1F947, 0x1F9FF },
+	{ 0x1FA70, 0x1FAFF },
+	{ 0x20000, 0x2FFFD },
+	{ 0x30000, 0x3FFFD },
+};
+
+template <size_t N>
+constexpr bool in_ranges(const codepoint_range (&ranges)[N], char32_t c) {
+	if (c < ranges[0].first || c > ranges[N - 1].last) {
+		return false;
+	}
+
+	// The first range which ends at or after c.
+	size_t first = 0;
+	size_t count = N;
+	while (count > 0) {
+		size_t half = count / 2;
+		if (ranges[first + half].last < c) {
+			first += half + 1;
+			count -= half + 1;
+		} else {
+			count = half;
+		}
+	}
+	return c >= ranges[first].first;
+}
+
+// The columns taken by a code point.
+constexpr size_t codepoint_width(char32_t c) {
+	if (c < 0x80) {
+		return 1;
+	}
+	// C1 controls.
+	if (c < 0xA0) {
+		return 0;
+	}
+	if (in_ranges(zero_width_ranges, c)) {
+		return 0;
+	}
+	if (in_ranges(wide_ranges, c)) {
+		return 2;
+	}
+	return 1;
+}
+
+template <class CharT>
+constexpr std::uint32_t code_unit(CharT c) {
+	return std::uint32_t(std::make_unsigned_t<CharT>(c));
+}
+
+// Decodes the code point at pos and moves pos after it.
+// Invalid sequences decode one code unit, as U+FFFD.
+template <class CharT>
+char32_t decode_codepoint(std::basic_string_view<CharT> str, size_t& pos) {
+	constexpr char32_t invalid = 0xFFFD;
+	std::uint32_t c = code_unit(str[pos]);
+
+	if constexpr (sizeof(CharT) == 1) {
+		size_t len = 0;
+		std::uint32_t ret = 0;
+		if (c < 0x80) {
+			++pos;
+			return c;
+		} else if ((c & 0xE0) == 0xC0) {
+			len = 2;
+			ret = c & 0x1F;
+		} else if ((c & 0xF0) == 0xE0) {
+			len = 3;
+			ret = c & 0x0F;
+		} else if ((c & 0xF8) == 0xF0) {
+			len = 4;
+			ret = c & 0x07;
+		} else {
+			++pos;
+			return invalid;
+		}
+
+		if (pos + len > str.size()) {
+			++pos;
+			return invalid;
+		}
+		for (size_t i = 1; i < len; ++i) {
+			std::uint32_t next = code_unit(str[pos + i]);
+			if ((next & 0xC0) != 0x80) {
+				++pos;
+				return invalid;
+			}
+			ret = (ret << 6) | (next & 0x3F);
+		}
+		pos += len;
+		return char32_t(ret);
+
+	} else if constexpr (sizeof(CharT) == 2) {
+		++pos;
+		if (c < 0xD800 || c > 0xDFFF) {
+			return char32_t(c);
+		}
+		// A high surrogate, followed by a low one.
+		if (c <= 0xDBFF && pos < str.size()) {
+			std::uint32_t low = code_unit(str[pos]);
+			if (low >= 0xDC00 && low <= 0xDFFF) {
+				++pos;
+				return char32_t(
+						0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00));
+			}
+		}
+		return invalid;
+
+	} else {
+		++pos;
+		return char32_t(c);
+	}
+}
+
+// Returns the number of leading ascii code units. Checks 8 bytes at a time.
+template <class CharT>
+size_t ascii_prefix(const CharT* data, size_t size) {
+	constexpr size_t per_word = sizeof(std::uint64_t) / sizeof(CharT);
+	// Every bit above 0x7F, in every code unit of a word.
+	constexpr std::uint64_t mask = []() {
+		std::uint64_t unit_mask = ~std::uint64_t(0x7F)
+				& (~std::uint64_t(0) >> (64 - 8 * sizeof(CharT)));
+		std::uint64_t ret = 0;
+		for (size_t i = 0; i < per_word; ++i) {
+			ret |= unit_mask << (i * 8 * sizeof(CharT));
+		}
+		return ret;
+	}();
+
+	size_t i = 0;
+	for (; i + per_word <= size; i += per_word) {
+		std::uint64_t word;
+		std::memcpy(&word, data + i, sizeof(word));
+		if ((word & mask) != 0) {
+			break;
+		}
+	}
+
+	for (; i < size && code_unit(data[i]) < 0x80; ++i) {
+	}
+	return i;
+}
+
+// Returns the number of code units of the longest prefix of str which fits
+// in max_width columns. Zero width code points which follow the prefix are
+// included, combining marks stay with their base.
+template <class CharT>
+size_t width_prefix(std::basic_string_view<CharT> str, size_t max_width) {
+	size_t width = 0;
+	size_t pos = 0;
+	while (pos < str.size()) {
+		size_t ascii = ascii_prefix(str.data() + pos, str.size() - pos);
+		if (width + ascii > max_width) {
+			return pos + (max_width - width);
+		}
+		width += ascii;
+		pos += ascii;
+		if (pos >= str.size()) {
+			break;
+		}
+
+		size_t next = pos;
+		size_t w = codepoint_width(decode_codepoint(str, next));
+		if (width + w > max_width) {
+			break;
+		}
+		width += w;
+		pos = next;
+	}
+	return pos;
+}
+} // namespace detail
+
+// The number of terminal columns str takes.
+template <class CharT>
+size_t display_width(std::basic_string_view<CharT> str) {
+	size_t ret = 0;
+	size_t pos = 0;
+	while (pos < str.size()) {
+		size_t ascii
+				= detail::ascii_prefix(str.data() + pos, str.size() - pos);
+		ret += ascii;
+		pos += ascii;
+		if (pos >= str.size()) {
+			break;
+		}
+
+		ret += detail::codepoint_width(detail::decode_codepoint(str, pos));
+	}
+	return ret;
+}
+
+template <class CharT>
+size_t display_width(const std::basic_string<CharT>& str) {
+	return display_width(std::basic_string_view<CharT>{ str });
+}
+} // namespace fea
@@ -31,18 +31,32 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
-#include <deque>
+#include <fea_getopt/compiled_options.hpp>
+#include <fea_getopt/display_width.hpp>
+#include <fea_getopt/instrument.hpp>
+#include <fea_getopt/option_store.hpp>
+#include <fea_getopt/option_values.hpp>
+#include <fea_getopt/output_sink.hpp>
+#include <fea_getopt/parse_buffer.hpp>
+#include <fea_getopt/prefix_trie.hpp>
+#include <fea_getopt/response_file.hpp>
+#include <fea_getopt/suggest.hpp>
 #include <fea_state_machines/fsm.hpp>
 #include <fea_utils/string.hpp>
 #include <functional>
-#include <map>
+#include <list>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
-#include <unordered_map>
 #include <vector>
 
 
@@ -79,75 +93,452 @@ constexpr auto get_print() {
 }
 
 
-enum class user_option_e : std::uint8_t {
-	flag,
-	required_arg,
-	optional_arg,
-	default_arg,
-	multi_arg,
-	raw_arg,
+template <class Func, class CharT>
+inline constexpr bool is_view_func_v = std::is_invocable_r_v<bool, Func,
+		std::basic_string_view<CharT>>;
+
+template <class Func, class CharT>
+inline constexpr bool is_multi_view_func_v = std::is_invocable_r_v<bool,
+		Func, const std::vector<std::basic_string_view<CharT>>&>;
+
+// Wraps callbacks which own their argument. The string is only created once
+// we know the option is valid, right before calling the user.
+template <class CharT>
+std::function<bool(std::basic_string_view<CharT>)> to_view_func(
+		std::function<bool(std::basic_string<CharT>&&)>&& func) {
+	return [f = std::move(func)](std::basic_string_view<CharT> arg) {
+		return f(std::basic_string<CharT>{ arg });
+	};
+}
+
+template <class CharT>
+std::function<bool(const std::vector<std::basic_string_view<CharT>>&)>
+to_multi_view_func(
+		std::function<bool(std::vector<std::basic_string<CharT>>&&)>&& func) {
+	return [f = std::move(func)](
+				   const std::vector<std::basic_string_view<CharT>>& args) {
+		std::vector<std::basic_string<CharT>> out;
+		out.reserve(args.size());
+		for (std::basic_string_view<CharT> arg : args) {
+			out.push_back(std::basic_string<CharT>{ arg });
+		}
+		return f(std::move(out));
+	};
+}
+
+template <class CharT>
+constexpr bool starts_with_dash(std::basic_string_view<CharT> str) {
+	return !str.empty() && str.front() == CharT('-');
+}
+
+// Calls func with every word of str, words are separated by spaces.
+// Stops and returns false when func does.
+template <class CharT, class Func>
+bool for_each_word(std::basic_string_view<CharT> str, Func&& func) {
+	while (!str.empty()) {
+		size_t space_pos = str.find(CharT(' '));
+		if (space_pos != 0 && !func(str.substr(0, space_pos))) {
+			return false;
+		}
+
+		if (space_pos == std::basic_string_view<CharT>::npos) {
+			break;
+		}
+		str.remove_prefix(space_pos + 1);
+	}
+	return true;
+}
+
+// What an argument looks like, before looking up options.
+enum class arg_kind : std::uint8_t {
+	help,
+	shortarg,
+	longarg,
+	concat,
+	raw,
 	count,
 };
 
-template <class CharT = char>
-struct user_option {
-	using string = std::basic_string<CharT, std::char_traits<CharT>,
-			std::allocator<CharT>>;
+template <class CharT>
+constexpr arg_kind classify_arg(std::basic_string_view<CharT> arg) {
+	// help
+	if (arg == FEA_ML("-h") || arg == FEA_ML("--help") || arg == FEA_ML("/?")
+			|| arg == FEA_ML("/help") || arg == FEA_ML("/h")) {
+		return arg_kind::help;
+	}
+
+	// A single short arg, ex : '-d'
+	if (starts_with_dash(arg) && arg.size() == 2) {
+		return arg_kind::shortarg;
+	}
+
+	// A long arg, ex '--something'
+	if (arg.substr(0, 2) == FEA_ML("--")) {
+		return arg_kind::longarg;
+	}
+
+	// Concatenated short args, ex '-abdsc'
+	if (starts_with_dash(arg)) {
+		return arg_kind::concat;
+	}
+
+	// Everything else failed, check raw args. ex '"some arg"'
+	return arg_kind::raw;
+}
+
+// Removes the leading dashes.
+template <class CharT>
+constexpr std::basic_string_view<CharT> strip_dashes(
+		std::basic_string_view<CharT> arg) {
+	size_t new_beg = arg.find_first_not_of(CharT('-'));
+	arg.remove_prefix(
+			new_beg == std::basic_string_view<CharT>::npos ? arg.size()
+														   : new_beg);
+	return arg;
+}
 
-	user_option() = default;
-
-	user_option(string&& longopt, CharT shortopt, user_option_e t,
-			std::function<bool()> func, string&& help)
-			: long_name(longopt)
-			, short_name(shortopt)
-			, opt_type(t)
-			, flag_func(std::move(func))
-			, description(std::move(help)) {
-	}
-	user_option(string&& longopt, CharT shortopt, user_option_e t,
-			std::function<bool(string&&)> func, string&& help)
-			: long_name(longopt)
-			, short_name(shortopt)
-			, opt_type(t)
-			, one_arg_func(std::move(func))
-			, description(std::move(help)) {
-	}
-	user_option(string&& longopt, CharT shortopt, user_option_e t,
-			std::function<bool(string&&)> func, string&& help,
-			string&& default_val)
-			: long_name(longopt)
-			, short_name(shortopt)
-			, opt_type(t)
-			, one_arg_func(std::move(func))
-			, description(std::move(help))
-			, default_val(std::move(default_val)) {
-	}
-	user_option(string&& longopt, CharT shortopt, user_option_e t,
-			std::function<bool(std::vector<string>&&)> func, string&& help)
-			: long_name(longopt)
-			, short_name(shortopt)
-			, opt_type(t)
-			, multi_arg_func(std::move(func))
-			, description(std::move(help)) {
-	}
-
-
-	string long_name;
-	CharT short_name;
-	user_option_e opt_type = user_option_e::count;
-
-	std::function<bool()> flag_func;
-	std::function<bool(string&&)> one_arg_func;
-	std::function<bool(std::vector<string>&&)> multi_arg_func;
-
-	string description;
-	string default_val;
-
-	bool has_been_parsed = false;
+// What the help printer needs, apart from the options.
+template <class CharT>
+struct help_info {
+	std::basic_string_view<CharT> arg0;
+	std::basic_string_view<CharT> intro;
+	std::basic_string_view<CharT> outro;
+	size_t output_width = 120;
 };
+
+// Where print_help prints arg0, in the help text. Must match print_help.
+template <class CharT>
+size_t help_arg0_pos(const help_info<CharT>& info) {
+	// Intro, '\n', then '\nUsage: '
+	size_t ret = info.intro.empty() ? 0 : info.intro.size() + 1;
+	return ret + 8;
+}
+
+// Pads str with spaces, or cuts it, so it takes width columns.
+template <class CharT>
+void resize_to_width(std::basic_string<CharT>& str, size_t width) {
+	size_t str_width = display_width(str);
+	if (str_width > width) {
+		str.resize(width_prefix(std::basic_string_view<CharT>{ str }, width));
+		str_width = display_width(str);
+	}
+	str.append(width - str_width, FEA_CH(' '));
+}
+
+// The first string is printed as-is.
+// Tries to find '\n'. If it does, splits the incoming string and prints at
+// indentation.
+// If there is no '\n', simply prints str and returns.
+// Lines wider than output_width are split at their last word which fits.
+// Widths are measured in terminal columns, without copying the strings.
+template <class CharT, class PrintFunc>
+void print_description(const PrintFunc& print,
+		std::basic_string_view<CharT> desc, size_t indendation,
+		size_t output_width) {
+	using string = std::basic_string<CharT>;
+	using string_view = std::basic_string_view<CharT>;
+
+	if (desc.empty())
+		return;
+
+	// At least 1 column, if the indentation is wider than the output.
+	const size_t max_width
+			= output_width > indendation ? output_width - indendation : 1;
+	const string indent_str(indendation, FEA_CH(' '));
+	const string_view new_line = FEA_ML("\n");
+
+	bool first_line = true;
+	auto print_line = [&](string_view line) {
+		// Print the indentation for every line after the first.
+		if (!first_line) {
+			print(string_view{ indent_str });
+		}
+		first_line = false;
+		print(line);
+		print(new_line);
+	};
+
+	// Split the string if it contains \n, so substrings start on a new line
+	// with the appropriate indentation.
+	while (true) {
+		size_t nl_pos = desc.find(FEA_CH('\n'));
+		string_view line = desc.substr(0, nl_pos);
+
+		// If the line is wider than the max output, split it at the last
+		// word possible, so it's pretty.
+		while (display_width(line) > max_width) {
+			size_t fit = width_prefix(line, max_width);
+			size_t space_pos = line.substr(0, fit).find_last_of(FEA_CH(' '));
+
+			if (space_pos == string_view::npos || space_pos == 0) {
+				// A single word wider than the output, cut it.
+				fit = std::max(fit, size_t(1));
+				print_line(line.substr(0, fit));
+				line.remove_prefix(fit);
+			} else {
+				print_line(line.substr(0, space_pos));
+				// Don't forget to ignore the space for the next sentence.
+				line.remove_prefix(space_pos + 1);
+			}
+		}
+		print_line(line);
+
+		if (nl_pos == string_view::npos) {
+			break;
+		}
+		desc.remove_prefix(nl_pos + 1);
+	}
+}
+
+// Prints the whole help, shared by all parsers.
+// for_each_raw and for_each_opt must call their argument with every option.
+// Options are anything that has the same members as option_view.
+// for_each_sub calls its argument with the name and help of every
+// subcommand.
+template <class CharT, class PrintFunc, class RawForEach, class OptForEach,
+		class SubForEach>
+void print_help(const PrintFunc& print, const help_info<CharT>& info,
+		const RawForEach& for_each_raw, const OptForEach& for_each_opt,
+		const SubForEach& for_each_sub) {
+	using string = std::basic_string<CharT>;
+	using string_view = std::basic_string_view<CharT>;
+
+	constexpr size_t indent = 1;
+	constexpr size_t shortopt_width = 4;
+	constexpr size_t shortopt_total_width = indent + shortopt_width;
+	constexpr size_t longopt_space = 2;
+	constexpr size_t longopt_width_max = 30;
+	constexpr size_t rawopt_help_indent = 4;
+	const string opt_str = FEA_ML(" <optional>");
+	const string req_str = FEA_ML(" <value>");
+	const string multi_str = FEA_ML(" <multiple>");
+	const string default_beg = FEA_ML(" <=");
+	const string default_end = FEA_ML(">");
+
+	if (!info.intro.empty()) {
+		print(string{ info.intro } + FEA_ML("\n"));
+	}
+
+	// Usage
+	size_t raw_count = 0;
+	{
+		string out_str;
+		for_each_raw([&](const auto& raw_opt) {
+			out_str += FEA_ML(" \"");
+			out_str += raw_opt.long_name;
+			out_str += FEA_ML("\"");
+			++raw_count;
+		});
+
+		out_str += FEA_ML(" [options]");
+
+		size_t sub_count = 0;
+		for_each_sub([&](string_view, string_view) { ++sub_count; });
+		if (sub_count != 0) {
+			out_str += FEA_ML(" <command> [<args>]");
+		}
+
+		print(FEA_ML("\nUsage: ") + string{ info.arg0 } + out_str
+				+ FEA_ML("\n\n"));
+	}
+
+	// Raw Options
+	if (raw_count != 0) {
+		// Find the biggest raw option name size.
+		// The raw option's name is printed in quotes.
+		size_t max_name_width = 0;
+		for_each_raw([&](const auto& raw_opt) {
+			size_t name_width = display_width(raw_opt.long_name) + 2
+					+ rawopt_help_indent;
+			max_name_width = std::max(max_name_width, name_width);
+		});
+
+		// Print section header.
+		print(FEA_ML("Arguments:\n"));
+
+		// Now, print the raw option help.
+		for_each_raw([&](const auto& raw_opt) {
+			// Print indentation.
+			print(string(indent, FEA_CH(' ')));
+
+			// Print the help, and use max_name_width so each help line is
+			// properly aligned.
+			string out = FEA_ML("\"");
+			out += raw_opt.long_name;
+			out += FEA_ML("\"");
+			resize_to_width(out, max_name_width);
+			print(out);
+
+			// Print the help message. This will split the message if it is too
+			// wide, or if the user used '\n' in his message.
+			print_description<CharT>(print, raw_opt.description,
+					indent + max_name_width, info.output_width);
+		});
+		print(FEA_ML("\n"));
+	}
+
+	// Subcommands, laid out like raw options.
+	{
+		size_t max_name_width = 0;
+		for_each_sub([&](string_view name, string_view) {
+			max_name_width = std::max(max_name_width,
+					display_width(name) + rawopt_help_indent);
+		});
+
+		if (max_name_width != 0) {
+			print(FEA_ML("Commands:\n"));
+			for_each_sub([&](string_view name, string_view help) {
+				print(string(indent, FEA_CH(' ')));
+				string out{ name };
+				resize_to_width(out, max_name_width);
+				print(out);
+				print_description<CharT>(print, help, indent + max_name_width,
+						info.output_width);
+			});
+			print(FEA_ML("\n"));
+		}
+	}
+
+	// All Other Options
+	{
+		print(FEA_ML("Options:\n"));
+
+		// First, compute the maximum width of long options.
+		size_t longopt_width = 0;
+		for_each_opt([&](const auto& opt) {
+			size_t size = longopt_space;
+			if (!opt.long_name.empty()) {
+				size += 2 + display_width(opt.long_name);
+			}
+			if (opt.opt_type == user_option_e::optional_arg) {
+				size += opt_str.size();
+			} else if (opt.opt_type == user_option_e::required_arg) {
+				size += req_str.size();
+			} else if (opt.opt_type == user_option_e::default_arg) {
+				size += default_beg.size() + display_width(opt.default_val)
+						+ default_end.size();
+			} else if (opt.opt_type == user_option_e::multi_arg) {
+				size += multi_str.size();
+			}
+
+			longopt_width = std::max(longopt_width, size);
+		});
+
+		// Cap it to longopt_width_max though. If it is bigger than this, we'll
+		// print it on a new line.
+		if (longopt_width > longopt_width_max) {
+			longopt_width = longopt_width_max;
+		}
+
+		// Print the options.
+		for_each_opt([&](const auto& opt) {
+			// Print indentation.
+			print(string(indent, FEA_CH(' ')));
+
+			// If the option has a shortarg, print that.
+			if (opt.short_name != FEA_CH('\0')) {
+				string shortopt_str;
+				shortopt_str += FEA_ML("-");
+				shortopt_str += opt.short_name;
+				if (!opt.long_name.empty()) {
+					shortopt_str += FEA_ML(",");
+				}
+				string out = shortopt_str;
+				resize_to_width(out, shortopt_width);
+				print(out);
+			} else {
+				print(string(shortopt_width, FEA_CH(' ')));
+			}
+
+			// Build the longopt string.
+			// Short only options have no long column, their value follows
+			// the short name.
+			string longopt_str;
+			if (!opt.long_name.empty()) {
+				longopt_str += FEA_ML("--");
+				longopt_str += opt.long_name;
+			}
+
+			// Add the specific "instructions" for each type of arg.
+			if (opt.opt_type == user_option_e::optional_arg) {
+				longopt_str += opt_str;
+			} else if (opt.opt_type == user_option_e::required_arg) {
+				longopt_str += req_str;
+			} else if (opt.opt_type == user_option_e::default_arg) {
+				longopt_str += default_beg;
+				longopt_str += opt.default_val;
+				longopt_str += default_end;
+			} else if (opt.opt_type == user_option_e::multi_arg) {
+				longopt_str += multi_str;
+			}
+			if (opt.long_name.empty() && !longopt_str.empty()) {
+				longopt_str.erase(0, 1);
+			}
+
+			// Print the longopt string.
+			string out = longopt_str;
+			resize_to_width(out, longopt_width);
+			print(out);
+
+			// If it was bigger than the max width, the description will be
+			// printed on the next line, indented up to the right position.
+			if (display_width(longopt_str) >= longopt_width) {
+				print(FEA_ML("\n"));
+				print(string(
+						longopt_width + shortopt_total_width, FEA_CH(' ')));
+			}
+
+			// Print the help message, indents appropriately and splits into
+			// multiple strings if the message is too wide.
+			print_description<CharT>(print, opt.description,
+					longopt_width + shortopt_total_width, info.output_width);
+		});
+
+		if (longopt_width == 0) // No options, width is --help only.
+			longopt_width = 2 + 4 + longopt_space;
+
+		// Print the help command help.
+		string short_help = FEA_ML("-h,");
+		short_help.resize(shortopt_width, FEA_CH(' '));
+
+		string long_help = FEA_ML("--help");
+		long_help.resize(longopt_width, FEA_CH(' '));
+
+		print(string(indent, FEA_CH(' ')) + short_help + long_help
+				+ FEA_ML("Print this help\n"));
+
+		// Print user outro.
+		if (!info.outro.empty()) {
+			print(FEA_ML("\n") + string{ info.outro } + FEA_ML("\n"));
+		}
+	}
+}
+
+// Without subcommands.
+template <class CharT, class PrintFunc, class RawForEach, class OptForEach>
+void print_help(const PrintFunc& print, const help_info<CharT>& info,
+		const RawForEach& for_each_raw, const OptForEach& for_each_opt) {
+	print_help(print, info, for_each_raw, for_each_opt, [](const auto&) {});
+}
 } // namespace detail
 
 
+// How get_opt walks the arguments.
+// loop : The default. A table driven loop, its stack depth doesn't depend on
+//        the number of arguments.
+// fsm : The fea::fsm state machine. Its stack grows with every argument.
+//       Kept as a reference implementation.
+enum class get_opt_engine : std::uint8_t {
+	loop,
+	fsm,
+	count,
+};
+
+template <class CharT, class PrintfT>
+struct get_opt_context;
+template <class CharT, class PrintfT>
+struct get_opt;
+
 // get_opt supports all char types.
 // Uses printf if you provide char.
 // Uses wprintf if you provide wchar_t.
@@ -155,32 +546,50 @@ struct user_option {
 // By default, will convert char16_t and char32_t into utf8 and will print
 // with printf. You can customize the print function. If it is customized,
 // it will be used as-is. Must be a compatible signature with printf.
+
+// All callbacks which recieve arguments can either take owning strings, or
+// string_views. Views point directly into argv and are only valid during the
+// callback. Use them to parse without copying your arguments.
+
+// get_opt_spec holds the options, the help and the settings. Once frozen, it
+// isn't modified by parsing and can be shared by many get_opt_context, one
+// per thread. Your callbacks are then called from all those threads.
 template <class CharT = char,
 		class PrintfT = decltype(detail::get_print<CharT>())>
-struct get_opt {
+struct get_opt_spec {
 	using string = std::basic_string<CharT, std::char_traits<CharT>,
 			std::allocator<CharT>>;
+	using string_view = std::basic_string_view<CharT>;
 
 	static constexpr CharT null_char = FEA_CH('\0');
 
-	get_opt();
+	get_opt_spec();
 
 	// Construct using a custom print function. The function signature must
-	// match printf.
-	get_opt(PrintfT printf_func);
+	// match printf. It can also be an output sink, see output_sink.hpp.
+	// Parsing calls it once, with all the output of the parse.
+	get_opt_spec(PrintfT printf_func);
 
 	// An option that uses "raw args". Raw args do not have '--' or '-' in
 	// front of them. They are often file names or strings. These will be
 	// parsed in the order of appearance. ex : 'my_tool a/raw/arg.txt'
-	// Quotes will be added to the name.
+	// Quotes will be added to the name when printing help.
 	void add_raw_option(
 			string&& name, std::function<bool(string&&)>&& func, string&& help);
+	template <class Func,
+			class = std::enable_if_t<detail::is_view_func_v<Func, CharT>>>
+	void add_raw_option(string&& name, Func&& func, string&& help);
 
 	// An option that doesn't need any argument. AKA a flag.
 	// ex : '--flag'
 	void add_flag_option(string&& long_name, std::function<bool()>&& func,
 			string&& help, CharT short_name = null_char);
 
+	// A flag which may be repeated, your callback is called every time.
+	// ex : '-vvv', '-v --verbose'
+	void add_counter_option(string&& long_name, std::function<bool()>&& func,
+			string&& help, CharT short_name = null_char);
+
 	// An option that can accept a single argument or not.
 	// If no user argument is provided, your callback is called with your
 	// default argument.
@@ -188,18 +597,31 @@ struct get_opt {
 	void add_default_arg_option(string&& long_name,
 			std::function<bool(string&&)>&& func, string&& help,
 			string&& default_value, CharT short_name = null_char);
+	template <class Func,
+			class = std::enable_if_t<detail::is_view_func_v<Func, CharT>>>
+	void add_default_arg_option(string&& long_name, Func&& func,
+			string&& help, string&& default_value,
+			CharT short_name = null_char);
 
 	// An option that can accept a single argument or not.
 	// ex : '--optional arg' or '--optional'
 	void add_optional_arg_option(string&& long_name,
 			std::function<bool(string&&)>&& func, string&& help,
 			CharT short_name = null_char);
+	template <class Func,
+			class = std::enable_if_t<detail::is_view_func_v<Func, CharT>>>
+	void add_optional_arg_option(string&& long_name, Func&& func,
+			string&& help, CharT short_name = null_char);
 
 	// An option that requires a single argument to be set.
 	// ex : '--required arg'
 	void add_required_arg_option(string&& long_name,
 			std::function<bool(string&&)>&& func, string&& help,
 			CharT short_name = null_char);
+	template <class Func,
+			class = std::enable_if_t<detail::is_view_func_v<Func, CharT>>>
+	void add_required_arg_option(string&& long_name, Func&& func,
+			string&& help, CharT short_name = null_char);
 
 	// An option that accepts multiple arguments.
 	// Can be enclosed in quotes.
@@ -208,10 +630,39 @@ struct get_opt {
 	void add_multi_arg_option(string&& long_name,
 			std::function<bool(std::vector<string>&&)>&& func, string&& help,
 			CharT short_name = null_char);
+	// The views are valid during the callback only.
+	template <class Func,
+			class = std::enable_if_t<
+					detail::is_multi_view_func_v<Func, CharT>>>
+	void add_multi_arg_option(string&& long_name, Func&& func,
+			string&& help, CharT short_name = null_char);
+
+	// A multi option which streams its values, your callback is called once
+	// per value. Values aren't gathered, memory use doesn't grow with the
+	// number of values. When feeding, values are parsed as they come.
+	// The views are valid during the callback only.
+	// ex : '--inputs a.txt b.txt c.txt'
+	template <class Func,
+			class = std::enable_if_t<detail::is_view_func_v<Func, CharT>>>
+	void add_streaming_multi_arg_option(string&& long_name, Func&& func,
+			string&& help, CharT short_name = null_char);
+
+	// An option with a typed argument, parsed without allocating. T can be
+	// an integer, a floating point, bool, fea::byte_size or a
+	// std::chrono::duration. See option_values.hpp for the value formats.
+	// Bool options can be used as flags, '--opt' is the same as
+	// '--opt true'. Other options require an argument.
+	// ex : '--threads 8', '--buffer 4G', '--timeout 250ms'
+	template <class T, class Func>
+	void add_option(string&& long_name, Func&& func, string&& help,
+			CharT short_name = null_char);
 
 	// Add behavior that requires the first argument (argv[0]).
 	// The first argument is always the execution path.
 	void add_arg0_callback(std::function<bool(string&&)>&& func);
+	template <class Func,
+			class = std::enable_if_t<detail::is_view_func_v<Func, CharT>>>
+	void add_arg0_callback(Func&& func);
 
 	// Add help callback, which will be called whenever the user passes in a
 	// help option. It is called after help has been printed, to make sure we
@@ -232,16 +683,39 @@ struct get_opt {
 	// Use this to change the width of the console window.
 	void console_width(size_t character_width);
 
-	// Parse the arguments, execute your callbacks, returns success bool
-	// (and prints help if there was an error).
-	bool parse_options(size_t argc, CharT const* const* argv);
+	// Compiles the options into a flat lookup index, which is used when
+	// parsing. Adding options afterwards invalidates the index.
+	// get_opt freezes the options if needed, contexts require a frozen spec.
+	void freeze();
+
+	// Was freeze called since the last option was added?
+	bool frozen() const;
+
+	// Expands '@path' arguments into the arguments of the file at path.
+	// Response files can include other response files.
+	// See response_file.hpp for the file format.
+	void allow_response_files();
+
+	// Long options can be abbreviated to a unique prefix, ex '--verb' for
+	// '--verbose'. Exact names always match first, ambiguous prefixes are
+	// errors which list the candidates.
+	void allow_abbreviations();
+
+	// Adds a subcommand, ex 'build' in 'tool build --jobs 8'. Parsing stops
+	// at the first positional argument which names a subcommand, the
+	// arguments after it are the subcommand's. See get_opt_context::subcommand.
+	// get_opt::add_subcommand also builds and parses the subcommand.
+	void add_subcommand(string&& name, string&& help);
 
 	// Generic print.
 	void print(const string& message) const;
 
-	// No need to call this. It is called every time you parse options (assuming
-	// you need to parse them more than once).
-	void reset();
+	// Returns the help, as it is printed. arg0 is printed in the usage line.
+	// Uses the help rendered when freezing, if the spec is frozen.
+	string help_string(string_view arg0 = {}) const;
+
+	// The bytes used to store the options.
+	option_memory memory_usage() const;
 
 private:
 	static_assert(
@@ -250,282 +724,1520 @@ private:
 			"getopt : unknown character type, getopt only supports char, "
 			"wchar_t, char16_t and char32_t");
 
-	void add_option(detail::user_option<CharT>&& o);
+	friend struct get_opt_context<CharT, PrintfT>;
+	friend struct get_opt<CharT, PrintfT>;
 
-	enum class state {
-		arg0,
-		choose_parsing,
-		parse_longarg,
-		parse_shortarg,
-		parse_concat,
-		parse_raw,
-		end,
-		count
-	};
-	enum class transition {
-		parse_next,
-		exit,
-		error,
-		help,
-		do_longarg,
-		do_shortarg,
-		do_concat,
-		do_raw,
-		count
+	void insert_option(string_view long_name, CharT short_name,
+			detail::option_hot<CharT>&& o, string_view help,
+			string_view default_val = {}, string_view value_desc = {});
+
+	// Renders the whole help into out, with an empty arg0.
+	// Returns where arg0 goes.
+	size_t render_help(string& out) const;
+
+
+	// Hot data, like callbacks, in arrays indexed by the name lookup index.
+	// Help strings are stored apart. See option_store.hpp.
+	detail::option_store<CharT> _opts;
+	bool _frozen = false;
+
+	std::function<bool(string_view)> _arg0_func;
+	std::function<void()> _help_func;
+
+	PrintfT _print_func;
+
+	string _help_intro;
+	string _help_outro;
+
+	size_t _output_width = 120;
+	bool _no_arg_is_help = true;
+	bool _allow_response_files = false;
+	bool _allow_abbreviations = false;
+	// Built when freezing, if abbreviations are allowed.
+	detail::prefix_trie<CharT> _prefixes;
+	// Names by length, for "Did you mean" suggestions. Built when freezing.
+	detail::suggestion_index<CharT> _suggestions;
+
+	// Subcommand names, looked up like long options. Help is in the same
+	// order.
+	compiled_options<CharT> _subcommands;
+	std::vector<string> _subcommand_help;
+	detail::suggestion_index<CharT> _subcommand_suggestions;
+
+	// The help, rendered when freezing. arg0 is inserted at _help_arg0_pos.
+	string _help_text;
+	size_t _help_arg0_pos = 0;
+};
+
+// The parsing state of one command line. Contexts are cheap, they only point
+// to their spec. Use one context per thread to parse concurrently with a
+// single frozen spec.
+// The spec must outlive the context, and mustn't be modified while parsing.
+template <class CharT = char,
+		class PrintfT = decltype(detail::get_print<CharT>())>
+struct get_opt_context {
+	using spec_t = get_opt_spec<CharT, PrintfT>;
+	using string = typename spec_t::string;
+	using string_view = typename spec_t::string_view;
+
+	// Parsing throws if the spec isn't frozen.
+	// The parsing strings and containers are allocated from resource, for
+	// example a per-request std::pmr::monotonic_buffer_resource. The
+	// resource must outlive the context.
+	explicit get_opt_context(const spec_t& spec,
+			std::pmr::memory_resource* resource
+			= std::pmr::get_default_resource());
+
+	// Selects the parsing engine, the loop engine is used by default.
+	void parse_engine(get_opt_engine engine);
+
+	// Parse the arguments, execute your callbacks, returns success bool
+	// (and prints help if there was an error).
+	// argv isn't copied, it must outlive the call.
+	bool parse_options(size_t argc, CharT const* const* argv);
+
+	// Incremental parsing, for interpreters and consoles.
+	// Tokens are pushed one at a time and parsed as soon as possible, your
+	// callbacks are called from feed and finish. The first token is arg0.
+	// Tokens are copied. Returns false once parsing has failed, the
+	// following tokens are ignored.
+	// Response files aren't expanded when feeding tokens.
+	bool feed(string_view token);
+
+	// Parses the remaining tokens and returns success, like parse_options.
+	// The next call to feed starts a new command line.
+	bool finish();
+
+	// No need to call this. It is called every time you parse options (assuming
+	// you need to parse them more than once).
+	void reset();
+
+	// Reserves the parse state, parse_options doesn't allocate afterwards.
+	// Use a parse_buffer as resource to keep the state off the heap. Only
+	// the multi option values and the joined output are reserved on the
+	// heap, since callbacks take them as std::vector and std::string.
+	// Multi options take at most max_multi_values values, output is printed
+	// in pieces of max_output characters and response files are refused.
+	// Call it once the spec is frozen, adding options allocates again.
+	// Callbacks which take std::string allocate their copy. Instrumented
+	// builds reserve the whole trace ring here.
+	void heap_free(size_t max_multi_values = 64, size_t max_output = 1024);
+
+	// The subcommand parsing stopped at, or npos. Its arguments start at
+	// subcommand_arg(), in argv or the fed tokens. Subcommands inside
+	// response files aren't recognized.
+	size_t subcommand() const;
+	size_t subcommand_arg() const;
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+	// The timings and allocations of every parse, see instrument.hpp.
+	// Kept between parses.
+	instrumentation& instrument();
+	const instrumentation& instrument() const;
+#endif
+
+private:
+	template <class, class>
+	friend struct get_opt;
+
+	enum class state {
+		arg0,
+		choose_parsing,
+		parse_longarg,
+		parse_shortarg,
+		parse_concat,
+		parse_raw,
+		end,
+		count
+	};
+	enum class transition {
+		parse_next,
+		exit,
+		error,
+		help,
+		do_longarg,
+		do_shortarg,
+		do_concat,
+		do_raw,
+		// Only used when feeding tokens. The loop engine stops, and enters
+		// the same state once more input is available.
+		need_input,
+		count
 	};
 
-	using fsm_t = fsm<transition, state, void(get_opt*)>;
-	using state_t = fsm_state<transition, state, void(get_opt*)>;
+	using fsm_t = fsm<transition, state, void(get_opt_context*)>;
+	using state_t = fsm_state<transition, state, void(get_opt_context*)>;
+
+	// Checks the spec and resets, before a new command line.
+	void start();
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+	// Names the instrumented callbacks, when the options changed.
+	void name_callbacks();
+
+	using phase_timer_t = detail::phase_timer;
+#else
+	using phase_timer_t = detail::no_phase_timer;
+#endif
+	// Times a phase until the returned timer is destroyed. Callback ids are
+	// the options, then the raw options, arg0 and help.
+	// Does nothing when instrumentation is compiled out.
+	phase_timer_t time_phase(parse_phase phase,
+			size_t callback_id = compiled_options<CharT>::npos);
+	size_t raw_callback_id(size_t raw_idx) const;
+	size_t arg0_callback_id() const;
+	size_t help_callback_id() const;
+	// The pmr resource used for parsing.
+	std::pmr::memory_resource* parse_resource(
+			std::pmr::memory_resource* resource);
+
+	std::unique_ptr<fsm_t> make_machine() const;
+	void parse_fsm();
+
+	// Calls a handler and triggers the transition it returns.
+	template <transition (get_opt_context::*Handler)()>
+	void fsm_enter(fsm_t& m);
+	void fsm_trigger(fsm_t& m, transition t);
+
+	void parse_loop();
+
+	// Handlers return the transition to take next.
+	transition on_arg0_enter();
+	transition on_parse_next_enter();
+	transition on_parse_longopt();
+	// Parses the values of a streaming multi option, resumes when feeding.
+	transition on_stream_values();
+	transition on_parse_shortopt();
+	transition on_parse_concat();
+	transition on_parse_raw();
+	transition on_print_error();
+	void on_print_help();
+
+	// Output is buffered and written once per parse, by flush_output.
+	// The messages are appended one after the other.
+	template <class... Messages>
+	void print(const Messages&... messages);
+	// The message must outlive the parse, it isn't copied.
+	void print_ref(string_view message);
+	// Flushes instead of growing the buffers, when heap-free.
+	void print_bounded(string_view message);
+	void flush_output();
+
+	bool args_empty() const;
+	string_view arg_at(size_t idx) const;
+	string_view front_arg() const;
+	void pop_arg();
+	// Pops without expanding response files.
+	void advance_arg();
+	// Replaces '@path' arguments with the content of the file.
+	void expand_response_files();
+	// Is the next argument a value for the current option?
+	bool has_value_arg() const;
+	// Is the next argument a bool value?
+	bool is_bool_arg() const;
+	// The next value, attached to a short option or the next argument.
+	string_view value_arg() const;
+	void pop_value();
+	// Does the short option take the rest of its bundle as value?
+	// ex : '8' in '-j8'
+	bool takes_attached(size_t opt_idx, string_view rest) const;
+	// Calls an option which takes one argument. Prints typed value errors.
+	bool call_one_arg(size_t opt_idx, string_view arg);
+	// Returns false if the values are full, when heap-free.
+	bool push_multi_arg(string_view arg);
+
+	// The long name of an option, or its short name if it has none.
+	string_view option_name(size_t opt_idx) const;
+	// Prints the options an abbreviation could be.
+	void print_ambiguous(string_view name,
+			typename detail::prefix_trie<CharT>::range matches);
+	// Prints the names nearest to an unknown name. Returns false if none
+	// are near.
+	bool print_suggestions(const compiled_options<CharT>& index,
+			const detail::suggestion_index<CharT>& suggestions,
+			string_view name);
+
+	// Fed tokens may still come.
+	bool waiting_for_input() const;
+	// Are the arguments needed to parse the option available? The option's
+	// values start at value_idx.
+	bool has_lookahead(
+			const detail::option_hot<CharT>& opt, size_t value_idx) const;
+
+	const spec_t* _spec = nullptr;
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+	// Allocated, so the containers' resource doesn't move with the context.
+	std::unique_ptr<instrumentation> _instrument;
+#endif
+
+	get_opt_engine _engine = get_opt_engine::loop;
+	// Only created when used.
+	std::unique_ptr<fsm_t> _machine;
+
+	// Indexed like the spec's options. An option was parsed if its stamp is
+	// the current epoch, resetting only increments the epoch.
+	std::pmr::vector<std::uint32_t> _parsed;
+	std::uint32_t _epoch = 0;
+
+	// State machine eval things :
+	// The arguments are never copied, we walk argv with a cursor.
+	CharT const* const* _argv = nullptr;
+	size_t _argc = 0;
+	size_t _arg_idx = 0;
+
+	// Opened response files are kept until the next parse, callbacks may
+	// hold views into them. The stack are the files being read.
+	std::pmr::list<detail::response_file<CharT>> _response_files;
+	std::pmr::vector<detail::response_file<CharT>*> _response_stack;
+	// A response file couldn't be read, stop parsing.
+	bool _args_failed = false;
+
+	// Fed tokens, one after the other. Tokens are stored as offsets, the
+	// buffer grows while feeding.
+	std::pmr::basic_string<CharT> _fed_chars;
+	std::pmr::vector<std::pair<size_t, size_t>> _fed_tokens;
+	bool _feeding = false;
+	// finish was called.
+	bool _fed_all = false;
+	// A multi option gathers values, only the next option can resume
+	// parsing.
+	bool _wait_for_option = false;
+
+	// Where the loop engine resumes.
+	state _loop_state = state::arg0;
+
+	// Short options still to be parsed, ex 'bc' after parsing '-a' in '-abc'.
+	string_view _concat_args;
+	// A value in the same argument as its option, ex '8' in '-vj8' or 'a' in
+	// '--out=a'. Null if none, it may be empty, ex '--out='.
+	string_view _attached_value;
+	// Suggestions were printed for an unknown option, they replace the help.
+	bool _suggested = false;
+	// A short option resolved to its option index, waiting to be parsed.
+	size_t _pending_opt = compiled_options<CharT>::npos;
+	// Reused between multi options and parses. Callbacks take a
+	// std::vector, it uses the default allocator.
+	std::vector<string_view> _multi_args;
+	// The streaming multi option whose values are being parsed.
+	size_t _streaming_opt = compiled_options<CharT>::npos;
+	// The next raw option to parse.
+	size_t _raw_idx = 0;
+	// The subcommand parsing stopped at.
+	size_t _subcommand = compiled_options<CharT>::npos;
+
+	// Output waiting to be flushed. Pieces are in _out_buf, or are external
+	// text which outlives the parse, like the spec's help.
+	struct out_piece {
+		const CharT* ext;
+		size_t offset;
+		size_t size;
+	};
+	std::pmr::basic_string<CharT> _out_buf;
+	std::pmr::vector<out_piece> _out_pieces;
+	// Reused when flushing.
+	std::pmr::vector<string_view> _out_views;
+	// Print functions take a std::basic_string, output is joined in it.
+	string _out_joined;
+
+	// Buffers are reserved and never grow.
+	bool _heap_free = false;
+
+	bool _success = true;
+};
+
+// A spec and its context, for single threaded use.
+// Options are frozen when parsing starts.
+template <class CharT = char,
+		class PrintfT = decltype(detail::get_print<CharT>())>
+struct get_opt : get_opt_spec<CharT, PrintfT> {
+	using spec_t = get_opt_spec<CharT, PrintfT>;
+	using context_t = get_opt_context<CharT, PrintfT>;
+	using string = typename spec_t::string;
+	using string_view = typename spec_t::string_view;
+
+	get_opt();
+
+	// Construct using a custom print function. The function signature must
+	// match printf.
+	get_opt(PrintfT printf_func);
+
+	// Parsing allocates from resource, see get_opt_context.
+	explicit get_opt(std::pmr::memory_resource* resource);
+	get_opt(PrintfT printf_func, std::pmr::memory_resource* resource);
+
+	// See get_opt_spec. Rendering the help is timed when instrumented.
+	void freeze();
+
+	// See get_opt_context.
+	void parse_engine(get_opt_engine engine);
+	bool parse_options(size_t argc, CharT const* const* argv);
+	bool feed(string_view token);
+	bool finish();
+	void reset();
+	// Freezes the spec first.
+	void heap_free(size_t max_multi_values = 64, size_t max_output = 1024);
+
+	// Adds a subcommand, ex 'build' in 'tool build --jobs 8'. factory adds
+	// the subcommand's options to an empty get_opt, it is only called the
+	// first time the subcommand is parsed. The arguments after the
+	// subcommand's name are parsed by its get_opt as-is, with 'tool build'
+	// as arg0, response files included. Its help is its own. Subcommands
+	// can have subcommands.
+	void add_subcommand(string&& name,
+			std::function<void(get_opt&)>&& factory, string&& help);
+
+	// The subcommand of the last command line, empty if none.
+	string_view subcommand() const;
+
+	// A subcommand's options, built if needed. Throws if name isn't a
+	// subcommand.
+	get_opt& subcommand_options(string_view name);
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+	instrumentation& instrument();
+	const instrumentation& instrument() const;
+#endif
+
+private:
+	// Points the context to this spec, which may have moved.
+	context_t& context();
+
+	// Calls the subcommand's factory the first time.
+	get_opt& build_subcommand(size_t sub_idx);
+	// Builds the subcommand, and its arg0 from the command line's.
+	get_opt& start_subcommand(size_t sub_idx, string_view arg0);
+
+	context_t _context;
+	std::pmr::memory_resource* _resource;
+
+	// Indexed like the spec's subcommands. Built on first use.
+	struct subcommand_entry {
+		std::function<void(get_opt&)> factory;
+		std::unique_ptr<get_opt> opts;
+	};
+	std::vector<subcommand_entry> _subcommand_opts;
+	// Parses the fed tokens which follow a subcommand.
+	get_opt* _fed_subcommand = nullptr;
+	// The subcommand's arguments, after its arg0.
+	string _subcommand_arg0;
+	std::vector<CharT const*> _subcommand_argv;
+};
+
+template <class CharT, class PrintfT>
+get_opt_spec<CharT, PrintfT>::get_opt_spec()
+		: get_opt_spec(detail::get_print<CharT>()) {
+}
+
+template <class CharT, class PrintfT>
+get_opt_spec<CharT, PrintfT>::get_opt_spec(PrintfT printf_func)
+		: _print_func(printf_func) {
+}
+
+template <class CharT, class PrintfT>
+get_opt_context<CharT, PrintfT>::get_opt_context(
+		const spec_t& spec, std::pmr::memory_resource* resource)
+		: _spec(&spec)
+#if defined(FEA_GETOPT_INSTRUMENT)
+		, _instrument(std::make_unique<instrumentation>(resource))
+#endif
+		, _parsed(parse_resource(resource))
+		, _response_files(parse_resource(resource))
+		, _response_stack(parse_resource(resource))
+		, _fed_chars(parse_resource(resource))
+		, _fed_tokens(parse_resource(resource))
+		, _out_buf(parse_resource(resource))
+		, _out_pieces(parse_resource(resource))
+		, _out_views(parse_resource(resource)) {
+}
+
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::reset() {
+	if (_machine) {
+		_machine->reset();
+	}
+
+	_argv = nullptr;
+	_argc = 0;
+	_arg_idx = 0;
+	_response_files.clear();
+	_response_stack.clear();
+	_args_failed = false;
+
+	// Keeps capacity, for the next command line.
+	_fed_chars.clear();
+	_fed_tokens.clear();
+	_feeding = false;
+	_fed_all = false;
+	_wait_for_option = false;
+	_loop_state = state::arg0;
+	_concat_args = {};
+	_attached_value = {};
+	_suggested = false;
+	_pending_opt = compiled_options<CharT>::npos;
+	_multi_args.clear();
+	_streaming_opt = compiled_options<CharT>::npos;
+
+	_raw_idx = 0;
+	_subcommand = compiled_options<CharT>::npos;
+	// Only resized when the options change, new stamps are never parsed.
+	_parsed.resize(_spec->_opts.opts.size(), 0);
+	++_epoch;
+	if (_epoch == 0) {
+		// Wrapped around, old stamps could match.
+		std::fill(_parsed.begin(), _parsed.end(), 0);
+		_epoch = 1;
+	}
+
+	// Left by a callback which threw.
+	_out_buf.clear();
+	_out_pieces.clear();
+
+	_success = true;
+}
+
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::start() {
+	if (!_spec->_frozen) {
+		throw std::invalid_argument{
+			"get_opt_context::start : The spec must be frozen before "
+			"parsing."
+		};
+	}
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+	name_callbacks();
+#endif
+
+	reset();
+}
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::name_callbacks() {
+	// Callbacks are reported by name.
+	if (_instrument->callback_count() != help_callback_id() + 1) {
+		std::vector<std::string> names;
+		names.reserve(help_callback_id() + 1);
+		auto add_name = [&](string_view name) {
+			detail::append_utf8(&name, 1, names.emplace_back());
+		};
+		for (size_t i = 0; i < _spec->_opts.opts.size(); ++i) {
+			add_name(_spec->_opts.view(i).long_name);
+		}
+		for (size_t i = 0; i < _spec->_opts.raw_opts.size(); ++i) {
+			add_name(_spec->_opts.raw_view(i).long_name);
+		}
+		names.emplace_back("arg0");
+		names.emplace_back("help");
+		_instrument->name_callbacks(std::move(names));
+	}
+}
+#endif
+
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::heap_free(
+		size_t max_multi_values, size_t max_output) {
+	if (!_spec->_frozen) {
+		throw std::invalid_argument{
+			"get_opt_context::heap_free : The spec must be frozen first."
+		};
+	}
+	if (max_output == 0) {
+		throw std::invalid_argument{
+			"get_opt_context::heap_free : Output needs some space."
+		};
+	}
+
+	// Enough for any message, they are flushed when full.
+	constexpr size_t max_pieces = 16;
+
+	_heap_free = true;
+	// In case the fsm engine is selected later.
+	if (!_machine) {
+		_machine = make_machine();
+	}
+	_parsed.reserve(_spec->_opts.opts.size());
+	_multi_args.reserve(max_multi_values);
+	_out_buf.reserve(max_output);
+	_out_pieces.reserve(max_pieces);
+	_out_views.reserve(max_pieces);
+	_out_joined.reserve(max_output);
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+	name_callbacks();
+	_instrument->reserve_trace();
+#endif
+}
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+template <class CharT, class PrintfT>
+instrumentation& get_opt_context<CharT, PrintfT>::instrument() {
+	return *_instrument;
+}
+
+template <class CharT, class PrintfT>
+const instrumentation& get_opt_context<CharT, PrintfT>::instrument() const {
+	return *_instrument;
+}
+#endif
+
+template <class CharT, class PrintfT>
+auto get_opt_context<CharT, PrintfT>::time_phase(parse_phase phase,
+		[[maybe_unused]] size_t callback_id) -> phase_timer_t {
+#if defined(FEA_GETOPT_INSTRUMENT)
+	std::uint32_t id = callback_id < instrumentation::no_callback
+			? std::uint32_t(callback_id)
+			: instrumentation::no_callback;
+	return phase_timer_t{ _instrument.get(), phase, id };
+#else
+	(void)phase;
+	return phase_timer_t{};
+#endif
+}
+
+template <class CharT, class PrintfT>
+size_t get_opt_context<CharT, PrintfT>::raw_callback_id(size_t raw_idx) const {
+	return _spec->_opts.opts.size() + raw_idx;
+}
+
+template <class CharT, class PrintfT>
+size_t get_opt_context<CharT, PrintfT>::arg0_callback_id() const {
+	return raw_callback_id(_spec->_opts.raw_opts.size());
+}
+
+template <class CharT, class PrintfT>
+size_t get_opt_context<CharT, PrintfT>::help_callback_id() const {
+	return arg0_callback_id() + 1;
+}
+
+template <class CharT, class PrintfT>
+std::pmr::memory_resource* get_opt_context<CharT, PrintfT>::parse_resource(
+		std::pmr::memory_resource* resource) {
+#if defined(FEA_GETOPT_INSTRUMENT)
+	(void)resource;
+	return _instrument->resource();
+#else
+	return resource;
+#endif
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_raw_option(
+		string&& name, std::function<bool(string&&)>&& func, string&& help) {
+	add_raw_option(std::move(name), detail::to_view_func(std::move(func)),
+			std::move(help));
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_raw_option(
+		string&& name, Func&& func, string&& help) {
+	using namespace detail;
+
+	for (size_t i = 0; i < _opts.raw_opts.size(); ++i) {
+		if (_opts.raw_view(i).long_name == name) {
+			throw std::invalid_argument{
+				"get_opt::add_raw_option : Raw option already exists."
+			};
+		}
+	}
+
+	option_hot<CharT> o;
+	o.func = one_arg_func_t<CharT>{ std::forward<Func>(func) };
+	o.opt_type = user_option_e::raw_arg;
+	_opts.add_raw(name, std::move(o), help);
+	_frozen = false;
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_flag_option(string&& long_name,
+		std::function<bool()>&& func, string&& help,
+		CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	option_hot<CharT> o;
+	o.func = flag_func_t{ std::move(func) };
+	o.opt_type = user_option_e::flag;
+	insert_option(long_name, short_name, std::move(o), help);
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_counter_option(string&& long_name,
+		std::function<bool()>&& func, string&& help,
+		CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	option_hot<CharT> o;
+	o.func = flag_func_t{ std::move(func) };
+	o.opt_type = user_option_e::counter;
+	insert_option(long_name, short_name, std::move(o), help);
+}
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_required_arg_option(string&& long_name,
+		std::function<bool(string&&)>&& func, string&& help,
+		CharT short_name /*= '\0'*/) {
+	add_required_arg_option(std::move(long_name),
+			detail::to_view_func(std::move(func)), std::move(help),
+			short_name);
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_required_arg_option(string&& long_name,
+		Func&& func, string&& help, CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	option_hot<CharT> o;
+	o.func = one_arg_func_t<CharT>{ std::forward<Func>(func) };
+	o.opt_type = user_option_e::required_arg;
+	insert_option(long_name, short_name, std::move(o), help);
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_optional_arg_option(string&& long_name,
+		std::function<bool(string&&)>&& func, string&& help,
+		CharT short_name /*= '\0'*/) {
+	add_optional_arg_option(std::move(long_name),
+			detail::to_view_func(std::move(func)), std::move(help),
+			short_name);
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_optional_arg_option(string&& long_name,
+		Func&& func, string&& help, CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	option_hot<CharT> o;
+	o.func = one_arg_func_t<CharT>{ std::forward<Func>(func) };
+	o.opt_type = user_option_e::optional_arg;
+	insert_option(long_name, short_name, std::move(o), help);
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_default_arg_option(string&& long_name,
+		std::function<bool(string&&)>&& func, string&& help,
+		string&& default_value, CharT short_name /*= '\0'*/) {
+	add_default_arg_option(std::move(long_name),
+			detail::to_view_func(std::move(func)), std::move(help),
+			std::move(default_value), short_name);
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_default_arg_option(string&& long_name,
+		Func&& func, string&& help, string&& default_value,
+		CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	option_hot<CharT> o;
+	o.func = one_arg_func_t<CharT>{ std::forward<Func>(func) };
+	o.opt_type = user_option_e::default_arg;
+	insert_option(long_name, short_name, std::move(o), help, default_value);
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_multi_arg_option(string&& long_name,
+		std::function<bool(std::vector<string>&&)>&& func, string&& help,
+		CharT short_name /*= '\0'*/) {
+	add_multi_arg_option(std::move(long_name),
+			detail::to_multi_view_func(std::move(func)), std::move(help),
+			short_name);
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_multi_arg_option(string&& long_name,
+		Func&& func, string&& help, CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	option_hot<CharT> o;
+	o.func = multi_arg_func_t<CharT>{ std::forward<Func>(func) };
+	o.opt_type = user_option_e::multi_arg;
+	insert_option(long_name, short_name, std::move(o), help);
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_streaming_multi_arg_option(
+		string&& long_name, Func&& func, string&& help,
+		CharT short_name /*= '\0'*/) {
+	using namespace detail;
+
+	// Streaming, the callback takes one value.
+	option_hot<CharT> o;
+	o.func = one_arg_func_t<CharT>{ std::forward<Func>(func) };
+	o.opt_type = user_option_e::multi_arg;
+	insert_option(long_name, short_name, std::move(o), help);
+}
+
+template <class CharT, class PrintfT>
+template <class T, class Func>
+void get_opt_spec<CharT, PrintfT>::add_option(string&& long_name, Func&& func,
+		string&& help, CharT short_name /*= '\0'*/) {
+	using namespace detail;
+	static_assert(is_typed_value_v<T>,
+			"get_opt::add_option : unsupported value type");
+	static_assert(std::is_invocable_r_v<bool, Func, T>,
+			"get_opt::add_option : callback must accept T and return bool");
+
+	option_hot<CharT> o;
+	o.opt_type = user_option_e::required_arg;
+	string_view default_val;
+
+	if constexpr (std::is_same_v<T, bool>) {
+		o.opt_type = user_option_e::default_arg;
+		default_val = FEA_ML("true");
+		o.is_bool = true;
+	}
+
+	auto typed_func = [f = std::forward<Func>(func)](string_view arg) {
+		T val{};
+		value_status ret = parse_value(arg, val);
+		if (ret != value_status::ok) {
+			return ret;
+		}
+		return std::invoke(f, val) ? value_status::ok : value_status::rejected;
+	};
+	o.func = typed_func_t<CharT>{ std::move(typed_func) };
+
+	std::string desc = describe_value<T>();
+	insert_option(long_name, short_name, std::move(o), help, default_val,
+			string(desc.begin(), desc.end()));
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::insert_option(string_view long_name,
+		CharT short_name, detail::option_hot<CharT>&& o, string_view help,
+		string_view default_val, string_view value_desc) {
+	// Options without a long name are short only.
+	if (long_name.empty() && short_name == FEA_CH('\0')) {
+		throw std::invalid_argument{
+			"get_opt::add_option : Options need a long or a short name."
+		};
+	}
+
+	if (short_name != FEA_CH('\0')
+			&& _opts.index.find_short(short_name)
+					!= compiled_options<CharT>::npos) {
+		throw std::invalid_argument{
+			"get_opt::add_option : Short option already exists."
+		};
+	}
+
+	if (_opts.index.find_long(long_name) != compiled_options<CharT>::npos) {
+		throw std::invalid_argument{
+			"get_opt::add_option : Long option already exists."
+		};
+	}
+
+	// '--name=value' splits at the first '='.
+	if (long_name.find(FEA_CH('=')) != string_view::npos) {
+		throw std::invalid_argument{
+			"get_opt::add_option : Long options can't contain '='."
+		};
+	}
+
+	_opts.add(long_name, short_name, std::move(o), help, default_val,
+			value_desc);
+	_frozen = false;
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_arg0_callback(
+		std::function<bool(string&&)>&& func) {
+	_arg0_func = detail::to_view_func(std::move(func));
+}
+
+template <class CharT, class PrintfT>
+template <class Func, class>
+void get_opt_spec<CharT, PrintfT>::add_arg0_callback(Func&& func) {
+	_arg0_func = std::forward<Func>(func);
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_help_callback(
+		std::function<void()>&& func) {
+	_help_func = std::move(func);
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_help_intro(const string& message) {
+	_help_intro = message;
+	_frozen = false;
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_help_outro(const string& message) {
+	_help_outro = message;
+	_frozen = false;
+}
+
+template <class CharT, class PrintfT>
+void fea::get_opt_spec<CharT, PrintfT>::no_options_is_ok() {
+	_no_arg_is_help = false;
+}
+
+template <class CharT, class PrintfT>
+void fea::get_opt_spec<CharT, PrintfT>::console_width(size_t output_width) {
+	_output_width = output_width;
+	_frozen = false;
+}
+
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::freeze() {
+	if (_frozen) {
+		return;
+	}
+
+	// The lookup index is kept up to date when adding options.
+	_help_text.clear();
+	_help_arg0_pos = render_help(_help_text);
+
+	if (_allow_abbreviations) {
+		_prefixes.build(_opts.index);
+	}
+	_suggestions.build(_opts.index);
+	_subcommand_suggestions.build(_subcommands);
+
+	_frozen = true;
+}
+
+template <class CharT, class PrintfT>
+bool get_opt_spec<CharT, PrintfT>::frozen() const {
+	return _frozen;
+}
+
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::parse_engine(get_opt_engine engine) {
+	assert(engine != get_opt_engine::count);
+	_engine = engine;
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::allow_response_files() {
+	_allow_response_files = true;
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::allow_abbreviations() {
+	_allow_abbreviations = true;
+	_frozen = false;
+}
+
+template <class CharT, class PrintfT>
+void get_opt_spec<CharT, PrintfT>::add_subcommand(
+		string&& name, string&& help) {
+	if (name.empty() || name[0] == FEA_CH('-')) {
+		throw std::invalid_argument{
+			"get_opt::add_subcommand : Subcommands can't be empty or start "
+			"with '-'."
+		};
+	}
+
+	if (_subcommands.find_long(name) != compiled_options<CharT>::npos) {
+		throw std::invalid_argument{
+			"get_opt::add_subcommand : Subcommand already exists."
+		};
+	}
+
+	_subcommands.insert(name);
+	_subcommand_help.push_back(std::move(help));
+	_frozen = false;
+}
+
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::parse_options(
+		size_t argc, CharT const* const* argv) {
+	start();
+
+	_argv = argv;
+	_argc = argv == nullptr ? 0 : argc;
+
+	if (_engine == get_opt_engine::fsm) {
+		parse_fsm();
+	} else {
+		parse_loop();
+	}
+
+	flush_output();
+	return _success;
+}
+
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::feed(string_view token) {
+	if (!_feeding) {
+		start();
+		_feeding = true;
+	}
 
-	std::unique_ptr<fsm_t> make_machine() const;
+	if (_loop_state == state::end) {
+		// Parsing failed, ignore the rest of the command line.
+		return _success;
+	}
 
-	void on_arg0_enter(fsm_t&);
-	void on_parse_next_enter(fsm_t&);
-	void on_parse_longopt(fsm_t&);
-	void on_parse_shortopt(fsm_t&);
-	void on_parse_concat(fsm_t&);
-	void on_parse_raw(fsm_t&);
-	void on_print_error(fsm_t&);
-	void on_print_help(fsm_t&);
+	{
+		auto timer = time_phase(parse_phase::tokenize);
 
-	std::unique_ptr<fsm_t> _machine = make_machine();
+		// A value waiting for the next tokens, ex '--inputs=a'. It moves
+		// with the buffer.
+		size_t attached_pos = _attached_value.data() != nullptr
+				? size_t(_attached_value.data() - _fed_chars.data())
+				: 0;
 
-	std::unordered_map<CharT, string> _short_opt_to_long_opt;
-	std::map<string, detail::user_option<CharT>> _long_opt_to_user_opt;
-	std::vector<detail::user_option<CharT>> _raw_opts;
+		_fed_tokens.push_back({ _fed_chars.size(), token.size() });
+		_fed_chars.append(token);
+		++_argc;
 
-	std::function<bool(string&&)> _arg0_func;
-	std::function<void()> _help_func;
+		if (_attached_value.data() != nullptr) {
+			_attached_value = string_view{ _fed_chars.data() + attached_pos,
+				_attached_value.size() };
+		}
+	}
 
-	std::vector<string> _all_args;
-	PrintfT _print_func;
+	// Values of a multi option, nothing to do yet.
+	if (_wait_for_option && !detail::starts_with_dash(token)) {
+		return true;
+	}
+	_wait_for_option = false;
 
-	string _help_intro;
-	string _help_outro;
+	parse_loop();
+	flush_output();
+	return _success;
+}
 
-	size_t _output_width = 120;
-	bool _no_arg_is_help = true;
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::finish() {
+	if (!_feeding) {
+		start();
+	}
 
-	// State machine eval things :
-	std::deque<string> _parser_args;
-	bool _success = true;
-};
+	_feeding = true;
+	_fed_all = true;
+	_wait_for_option = false;
+	parse_loop();
+	flush_output();
+
+	_feeding = false;
+	return _success;
+}
 
 template <class CharT, class PrintfT>
-get_opt<CharT, PrintfT>::get_opt()
-		: get_opt(detail::get_print<CharT>()) {
+void get_opt_spec<CharT, PrintfT>::print(const string& message) const {
+	if constexpr (detail::is_output_sink_v<PrintfT, CharT>) {
+		string_view view = message;
+		_print_func.write(&view, 1);
+	} else if constexpr (std::is_invocable_v<const PrintfT&, const string&>) {
+		_print_func(message);
+	} else {
+		_print_func(message.c_str());
+	}
 }
 
 template <class CharT, class PrintfT>
-get_opt<CharT, PrintfT>::get_opt(PrintfT printf_func)
-		: _print_func(printf_func) {
+auto get_opt_spec<CharT, PrintfT>::help_string(string_view arg0) const
+		-> string {
+	string ret;
+	size_t arg0_pos = _help_arg0_pos;
+	if (_frozen) {
+		ret = _help_text;
+	} else {
+		arg0_pos = render_help(ret);
+	}
+
+	ret.insert(arg0_pos, arg0);
+	return ret;
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::reset() {
-	_machine->reset();
+option_memory get_opt_spec<CharT, PrintfT>::memory_usage() const {
+	option_memory ret = _opts.memory_usage();
+	ret.index += _prefixes.memory_usage();
+	ret.index += _suggestions.memory_usage();
+	ret.index += _subcommands.memory_usage()
+			+ _subcommand_suggestions.memory_usage();
+	return ret;
+}
+
+template <class CharT, class PrintfT>
+size_t get_opt_spec<CharT, PrintfT>::render_help(string& out) const {
+	detail::help_info<CharT> info;
+	info.intro = _help_intro;
+	info.outro = _help_outro;
+	info.output_width = _output_width;
+
+	// Options are printed sorted by name.
+	std::vector<std::uint32_t> sorted(_opts.opts.size());
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		sorted[i] = std::uint32_t(i);
+	}
+	std::sort(sorted.begin(), sorted.end(),
+			[this](std::uint32_t lhs, std::uint32_t rhs) {
+				return _opts.index.long_name(lhs) < _opts.index.long_name(rhs);
+			});
+
+	detail::print_help(
+			[&](string_view message) { out += message; }, info,
+			[this](const auto& func) {
+				for (size_t i = 0; i < _opts.raw_opts.size(); ++i) {
+					func(_opts.raw_view(i));
+				}
+			},
+			[&](const auto& func) {
+				for (std::uint32_t idx : sorted) {
+					func(_opts.view(idx));
+				}
+			},
+			[this](const auto& func) {
+				for (size_t i = 0; i < _subcommand_help.size(); ++i) {
+					func(_subcommands.long_name(i), string_view{
+							_subcommand_help[i] });
+				}
+			});
 
-	_all_args.clear();
-	_parser_args.clear();
+	return detail::help_arg0_pos(info);
+}
 
-	for (auto& r : _raw_opts) {
-		r.has_been_parsed = false;
+template <class CharT, class PrintfT>
+template <class... Messages>
+void get_opt_context<CharT, PrintfT>::print(const Messages&... messages) {
+	if (_heap_free) {
+		(print_bounded(string_view{ messages }), ...);
+		return;
 	}
 
-	for (auto& p : _long_opt_to_user_opt) {
-		p.second.has_been_parsed = false;
+	size_t size = (string_view{ messages }.size() + ...);
+
+	// Merge with the previous piece when it is in the buffer.
+	if (!_out_pieces.empty() && _out_pieces.back().ext == nullptr) {
+		_out_pieces.back().size += size;
+	} else {
+		_out_pieces.push_back({ nullptr, _out_buf.size(), size });
 	}
+	(_out_buf.append(string_view{ messages }), ...);
+}
 
-	_success = true;
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::print_ref(string_view message) {
+	if (message.empty()) {
+		return;
+	}
+	if (_heap_free && _out_pieces.size() == _out_pieces.capacity()) {
+		flush_output();
+	}
+	_out_pieces.push_back({ message.data(), 0, message.size() });
 }
 
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::print_bounded(string_view message) {
+	if (_out_buf.size() + message.size() > _out_buf.capacity()
+			|| _out_pieces.size() == _out_pieces.capacity()) {
+		flush_output();
+	}
+
+	// Longer than the whole buffer, copied in chunks.
+	while (!message.empty()) {
+		if (_out_buf.size() == _out_buf.capacity()
+				|| _out_pieces.size() == _out_pieces.capacity()) {
+			flush_output();
+		}
+
+		size_t size = (std::min)(
+				message.size(), _out_buf.capacity() - _out_buf.size());
+		if (!_out_pieces.empty() && _out_pieces.back().ext == nullptr) {
+			_out_pieces.back().size += size;
+		} else {
+			_out_pieces.push_back({ nullptr, _out_buf.size(), size });
+		}
+		_out_buf.append(message.substr(0, size));
+		message.remove_prefix(size);
+	}
+}
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_raw_option(
-		string&& name, std::function<bool(string&&)>&& func, string&& help) {
-	using namespace detail;
+void get_opt_context<CharT, PrintfT>::flush_output() {
+	if (_out_pieces.empty()) {
+		return;
+	}
 
-	auto it = std::find_if(_raw_opts.begin(), _raw_opts.end(),
-			[&](const user_option<CharT>& r) { return r.long_name == name; });
+	_out_views.clear();
+	for (const out_piece& p : _out_pieces) {
+		const CharT* data
+				= p.ext != nullptr ? p.ext : _out_buf.data() + p.offset;
+		_out_views.push_back(string_view{ data, p.size });
+	}
 
-	if (it != _raw_opts.end()) {
-		throw std::invalid_argument{
-			"get_opt::add_raw_option : Raw option already exists."
-		};
+	if constexpr (detail::is_output_sink_v<PrintfT, CharT>) {
+		_spec->_print_func.write(_out_views.data(), _out_views.size());
+	} else if (_heap_free) {
+		// Printed in pieces, the joined string doesn't grow.
+		_out_joined.clear();
+		for (string_view v : _out_views) {
+			while (!v.empty()) {
+				size_t size = (std::min)(
+						v.size(), _out_joined.capacity() - _out_joined.size());
+				_out_joined.append(v.substr(0, size));
+				v.remove_prefix(size);
+
+				if (_out_joined.size() == _out_joined.capacity()) {
+					_spec->print(_out_joined);
+					_out_joined.clear();
+				}
+			}
+		}
+		if (!_out_joined.empty()) {
+			_spec->print(_out_joined);
+		}
+	} else {
+		_out_joined.clear();
+		for (string_view v : _out_views) {
+			_out_joined += v;
+		}
+		_spec->print(_out_joined);
 	}
 
-	_raw_opts.push_back(user_option<CharT>{
-			std::move(FEA_ML("\"") + name + FEA_ML("\"")),
-			FEA_CH('\0'),
-			user_option_e::raw_arg,
-			std::move(func),
-			std::move(help),
-	});
+	_out_pieces.clear();
+	_out_buf.clear();
 }
 
-
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_flag_option(string&& long_name,
-		std::function<bool()>&& func, string&& help,
-		CharT short_name /*= '\0'*/) {
-	using namespace detail;
-
-	add_option(user_option<CharT>{
-			std::move(long_name),
-			short_name,
-			user_option_e::flag,
-			std::move(func),
-			std::move(help),
-	});
+bool get_opt_context<CharT, PrintfT>::args_empty() const {
+	return _args_failed || (_response_stack.empty() && _arg_idx >= _argc);
 }
+
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_required_arg_option(string&& long_name,
-		std::function<bool(string&&)>&& func, string&& help,
-		CharT short_name /*= '\0'*/) {
-	using namespace detail;
+auto get_opt_context<CharT, PrintfT>::arg_at(size_t idx) const -> string_view {
+	assert(idx < _argc);
+	if (_feeding) {
+		const std::pair<size_t, size_t>& tok = _fed_tokens[idx];
+		return string_view{ _fed_chars.data() + tok.first, tok.second };
+	}
+	return string_view{ _argv[idx] };
+}
 
-	add_option(user_option<CharT>{
-			std::move(long_name),
-			short_name,
-			user_option_e::required_arg,
-			std::move(func),
-			std::move(help),
-	});
+template <class CharT, class PrintfT>
+auto get_opt_context<CharT, PrintfT>::front_arg() const -> string_view {
+	assert(!args_empty());
+	if (!_response_stack.empty()) {
+		return _response_stack.back()->front;
+	}
+	return arg_at(_arg_idx);
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_optional_arg_option(string&& long_name,
-		std::function<bool(string&&)>&& func, string&& help,
-		CharT short_name /*= '\0'*/) {
-	using namespace detail;
+void get_opt_context<CharT, PrintfT>::pop_arg() {
+	advance_arg();
 
-	add_option(user_option<CharT>{
-			std::move(long_name),
-			short_name,
-			user_option_e::optional_arg,
-			std::move(func),
-			std::move(help),
-	});
+	if (_spec->_allow_response_files && !_feeding) {
+		expand_response_files();
+	}
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_default_arg_option(string&& long_name,
-		std::function<bool(string&&)>&& func, string&& help,
-		string&& default_value, CharT short_name /*= '\0'*/) {
-	using namespace detail;
+void get_opt_context<CharT, PrintfT>::advance_arg() {
+	assert(!args_empty());
+
+	if (_response_stack.empty()) {
+		++_arg_idx;
+		return;
+	}
 
-	add_option(user_option<CharT>{
-			std::move(long_name),
-			short_name,
-			user_option_e::default_arg,
-			std::move(func),
-			std::move(help),
-			std::move(default_value),
-	});
+	// Finished files go back to the file or argv which included them.
+	_response_stack.back()->pop();
+	while (!_response_stack.empty() && !_response_stack.back()->has_front) {
+		_response_stack.pop_back();
+	}
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_multi_arg_option(string&& long_name,
-		std::function<bool(std::vector<string>&&)>&& func, string&& help,
-		CharT short_name /*= '\0'*/) {
-	using namespace detail;
+void get_opt_context<CharT, PrintfT>::expand_response_files() {
+	// Guards against files which include themselves.
+	constexpr size_t max_depth = 64;
 
-	add_option(user_option<CharT>{
-			std::move(long_name),
-			short_name,
-			user_option_e::multi_arg,
-			std::move(func),
-			std::move(help),
-	});
-}
+	while (!args_empty()) {
+		string_view arg = front_arg();
+		if (arg.size() < 2 || arg.front() != FEA_CH('@')) {
+			return;
+		}
 
+		if (_heap_free) {
+			print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
+			print(FEA_ML("Response files aren't read in heap-free mode.\n"));
+			_args_failed = true;
+			return;
+		}
 
-template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_option(detail::user_option<CharT>&& o) {
-	using namespace detail;
+		// Files which end with '@path' are already popped when the included
+		// file is read, the depth is stored instead.
+		size_t depth = _response_stack.empty()
+				? 1
+				: _response_stack.back()->depth + 1;
+		if (depth > max_depth) {
+			print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
+			print(FEA_ML("Response files are nested too deeply.\n"));
+			_args_failed = true;
+			return;
+		}
 
-	if (o.short_name != FEA_CH('\0')) {
-		if (_short_opt_to_long_opt.count(o.short_name) > 0) {
-			throw std::invalid_argument{
-				"get_opt::add_option : Short option already exists."
-			};
+		auto timer = time_phase(parse_phase::tokenize);
+		detail::response_file<CharT>& file = _response_files.emplace_back();
+		file.depth = depth;
+		if (!file.open(arg.substr(1))) {
+			print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
+			print(FEA_ML("Couldn't read response file.\n"));
+			_response_files.pop_back();
+			_args_failed = true;
+			return;
+		}
+
+		advance_arg();
+
+		if (file.has_front) {
+			_response_stack.push_back(&file);
 		}
-		_short_opt_to_long_opt.insert({ o.short_name, o.long_name });
 	}
+}
 
-	if (_long_opt_to_user_opt.count(o.long_name) > 0) {
-		throw std::invalid_argument{
-			"get_opt::add_option : Long option already exists."
-		};
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::has_value_arg() const {
+	if (_attached_value.data() != nullptr) {
+		return true;
+	}
+
+	// The option is in the middle of concatenated short options, values can
+	// only follow the last one.
+	if (!_concat_args.empty()) {
+		return false;
 	}
+	return !args_empty() && !detail::starts_with_dash(front_arg());
+}
 
-	string name = o.long_name;
-	_long_opt_to_user_opt.insert({ std::move(name), std::move(o) });
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::is_bool_arg() const {
+	bool val = false;
+	return detail::parse_value(value_arg(), val) == detail::value_status::ok;
 }
 
+template <class CharT, class PrintfT>
+auto get_opt_context<CharT, PrintfT>::value_arg() const -> string_view {
+	if (_attached_value.data() != nullptr) {
+		return _attached_value;
+	}
+	return front_arg();
+}
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_arg0_callback(
-		std::function<bool(string&&)>&& func) {
-	_arg0_func = std::move(func);
+void get_opt_context<CharT, PrintfT>::pop_value() {
+	if (_attached_value.data() != nullptr) {
+		_attached_value = {};
+		return;
+	}
+	pop_arg();
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_help_callback(std::function<void()>&& func) {
-	_help_func = std::move(func);
+bool get_opt_context<CharT, PrintfT>::takes_attached(
+		size_t opt_idx, string_view rest) const {
+	using namespace detail;
+
+	if (rest.empty()) {
+		return false;
+	}
+
+	const option_hot<CharT>& opt = _spec->_opts.opts[opt_idx];
+	switch (opt.opt_type) {
+	case user_option_e::required_arg:
+	case user_option_e::multi_arg: {
+		return true;
+	} break;
+	case user_option_e::optional_arg:
+	case user_option_e::default_arg: {
+		// Bool options are flags in bundles, unless a bool follows.
+		bool val = false;
+		return !opt.is_bool || parse_value(rest, val) == value_status::ok;
+	} break;
+	default: {
+		return false;
+	} break;
+	}
 }
 
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::call_one_arg(
+		size_t opt_idx, string_view arg) {
+	using namespace detail;
+
+	const option_hot<CharT>& opt = _spec->_opts.opts[opt_idx];
+	if (const auto* func = std::get_if<one_arg_func_t<CharT>>(&opt.func)) {
+		auto timer = time_phase(parse_phase::callback, opt_idx);
+		return (*func)(arg);
+	}
+
+	// Typed errors describe the expected values.
+	string_view value_desc = _spec->_opts.strings.get(
+			_spec->_opts.cold[opt_idx].value_desc);
+
+	value_status status = value_status::ok;
+	{
+		auto timer = time_phase(parse_phase::callback, opt_idx);
+		status = std::get<typed_func_t<CharT>>(opt.func)(arg);
+	}
+
+	switch (status) {
+	case value_status::ok: {
+		return true;
+	} break;
+	case value_status::invalid: {
+		print(FEA_ML("'"), arg, FEA_ML("' isn't "), value_desc, FEA_ML(".\n"));
+	} break;
+	case value_status::out_of_range: {
+		print(FEA_ML("'"), arg, FEA_ML("' is out of range, expected "),
+				value_desc, FEA_ML(".\n"));
+	} break;
+	default: {
+	} break;
+	}
+	return false;
+}
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_help_intro(const string& message) {
-	_help_intro = message;
+auto get_opt_context<CharT, PrintfT>::option_name(size_t opt_idx) const
+		-> string_view {
+	string_view ret = _spec->_opts.index.long_name(opt_idx);
+	if (ret.empty()) {
+		return string_view{ &_spec->_opts.cold[opt_idx].short_name, 1 };
+	}
+	return ret;
 }
 
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::print_ambiguous(string_view name,
+		typename detail::prefix_trie<CharT>::range matches) {
+	// Large tables can have many candidates.
+	constexpr size_t max_candidates = 8;
+
+	print(FEA_ML("Could not parse : '"), name, FEA_ML("'\n"));
+	print(FEA_ML("Ambiguous option, could be :"));
+	size_t last = (std::min)(matches.last, matches.first + max_candidates);
+	for (size_t i = matches.first; i < last; ++i) {
+		size_t opt_idx = _spec->_prefixes.option(i);
+		print(i == matches.first ? FEA_ML(" '") : FEA_ML(", '"),
+				_spec->_opts.index.long_name(opt_idx), FEA_ML("'"));
+	}
+	if (matches.size() > max_candidates) {
+		print(FEA_ML(", ..."));
+	}
+	print(FEA_ML(".\n"));
+}
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::add_help_outro(const string& message) {
-	_help_outro = message;
+bool get_opt_context<CharT, PrintfT>::print_suggestions(
+		const compiled_options<CharT>& index,
+		const detail::suggestion_index<CharT>& suggestions,
+		string_view name) {
+	auto found = suggestions.find(index, name);
+	if (found.empty()) {
+		return false;
+	}
+
+	print(FEA_ML("Did you mean :"));
+	for (const auto& s : found) {
+		print(&s == found.begin() ? FEA_ML(" '") : FEA_ML(", '"),
+				index.long_name(s.opt_idx), FEA_ML("'"));
+	}
+	print(FEA_ML("?\n"));
+	return true;
 }
 
 template <class CharT, class PrintfT>
-void fea::get_opt<CharT, PrintfT>::no_options_is_ok() {
-	_no_arg_is_help = false;
+bool get_opt_context<CharT, PrintfT>::push_multi_arg(string_view arg) {
+	if (_heap_free && _multi_args.size() == _multi_args.capacity()) {
+		return false;
+	}
+	_multi_args.push_back(arg);
+	return true;
 }
 
 template <class CharT, class PrintfT>
-void fea::get_opt<CharT, PrintfT>::console_width(size_t output_width) {
-	_output_width = output_width;
+size_t get_opt_context<CharT, PrintfT>::subcommand() const {
+	return _subcommand;
 }
 
+template <class CharT, class PrintfT>
+size_t get_opt_context<CharT, PrintfT>::subcommand_arg() const {
+	return _arg_idx;
+}
 
 template <class CharT, class PrintfT>
-bool get_opt<CharT, PrintfT>::parse_options(
-		size_t argc, CharT const* const* argv) {
-	reset();
+bool get_opt_context<CharT, PrintfT>::waiting_for_input() const {
+	return _feeding && !_fed_all;
+}
 
-	_all_args.reserve(argc);
-	//_parsing_args.reserve(argc);
+template <class CharT, class PrintfT>
+bool get_opt_context<CharT, PrintfT>::has_lookahead(
+		const detail::option_hot<CharT>& opt, size_t value_idx) const {
+	using namespace detail;
 
-	for (size_t i = 0; i < argc; ++i) {
-		_all_args.push_back({ argv[i] });
-		_parser_args.push_back({ argv[i] });
+	// Values can only follow the last concatenated option.
+	if (!waiting_for_input() || !_concat_args.empty()) {
+		return true;
 	}
 
-	while (!_machine->finished()) {
-		_machine->update(this);
-	}
+	bool attached = _attached_value.data() != nullptr;
+	switch (opt.opt_type) {
+	case user_option_e::required_arg:
+	case user_option_e::optional_arg:
+	case user_option_e::default_arg: {
+		return attached || value_idx < _argc;
+	} break;
+	case user_option_e::multi_arg: {
+		// The first value is attached, or the next argument.
+		string_view first = _attached_value;
+		if (!attached) {
+			if (value_idx >= _argc) {
+				return false;
+			}
 
-	return _success;
-}
+			// Not a value.
+			first = arg_at(value_idx);
+			if (starts_with_dash(first)) {
+				return true;
+			}
+			++value_idx;
+		}
 
-template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::print(const string& message) const {
-	_print_func(message.c_str());
+		// Streamed values are parsed as they come, values in quotes are
+		// all there.
+		if (std::holds_alternative<one_arg_func_t<CharT>>(opt.func)
+				|| first.find(FEA_CH(' ')) != string_view::npos) {
+			return true;
+		}
+
+		// Values stop at the next option.
+		for (size_t i = value_idx; i < _argc; ++i) {
+			if (starts_with_dash(arg_at(i))) {
+				return true;
+			}
+		}
+		return false;
+	} break;
+	default: {
+		return true;
+	} break;
+	}
 }
 
 template <class CharT, class PrintfT>
-std::unique_ptr<typename get_opt<CharT, PrintfT>::fsm_t>
-get_opt<CharT, PrintfT>::make_machine() const {
+std::unique_ptr<typename get_opt_context<CharT, PrintfT>::fsm_t>
+get_opt_context<CharT, PrintfT>::make_machine() const {
 	std::unique_ptr<fsm_t> ret = std::make_unique<fsm_t>();
 
 	// arg0
@@ -538,7 +2250,7 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		arg0_state.template add_transition<transition::help, state::end>();
 
 		arg0_state.template add_event<fsm_event::on_enter>(
-				&get_opt::on_arg0_enter);
+				&get_opt_context::fsm_enter<&get_opt_context::on_arg0_enter>);
 		ret->template add_state<state::arg0>(std::move(arg0_state));
 	}
 
@@ -558,7 +2270,8 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		choose_state.template add_transition<transition::error, state::end>();
 
 		choose_state.template add_event<fsm_event::on_enter>(
-				&get_opt::on_parse_next_enter);
+				&get_opt_context::fsm_enter<
+						&get_opt_context::on_parse_next_enter>);
 		ret->template add_state<state::choose_parsing>(std::move(choose_state));
 	}
 
@@ -569,7 +2282,7 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		raw_state.template add_transition<transition::parse_next,
 				state::choose_parsing>();
 		raw_state.template add_event<fsm_event::on_enter>(
-				&get_opt::on_parse_raw);
+				&get_opt_context::fsm_enter<&get_opt_context::on_parse_raw>);
 		ret->template add_state<state::parse_raw>(std::move(raw_state));
 	}
 
@@ -580,7 +2293,8 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		long_state.template add_transition<transition::parse_next,
 				state::choose_parsing>();
 		long_state.template add_event<fsm_event::on_enter>(
-				&get_opt::on_parse_longopt);
+				&get_opt_context::fsm_enter<
+						&get_opt_context::on_parse_longopt>);
 		ret->template add_state<state::parse_longarg>(std::move(long_state));
 	}
 
@@ -591,7 +2305,8 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		short_state.template add_transition<transition::do_longarg,
 				state::parse_longarg>();
 		short_state.template add_event<fsm_event::on_enter>(
-				&get_opt::on_parse_shortopt);
+				&get_opt_context::fsm_enter<
+						&get_opt_context::on_parse_shortopt>);
 		ret->template add_state<state::parse_shortarg>(std::move(short_state));
 	}
 
@@ -602,7 +2317,7 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		concat_state.template add_transition<transition::do_longarg,
 				state::parse_longarg>();
 		concat_state.template add_event<fsm_event::on_enter>(
-				&get_opt::on_parse_concat);
+				&get_opt_context::fsm_enter<&get_opt_context::on_parse_concat>);
 		ret->template add_state<state::parse_concat>(std::move(concat_state));
 	}
 
@@ -612,10 +2327,13 @@ get_opt<CharT, PrintfT>::make_machine() const {
 		end_state.template add_transition<transition::help, state::end>();
 
 		end_state.template add_event<fsm_event::on_enter_from,
-				transition::error>(&get_opt::on_print_error);
+				transition::error>(
+				&get_opt_context::fsm_enter<&get_opt_context::on_print_error>);
 		end_state
 				.template add_event<fsm_event::on_enter_from, transition::help>(
-						&get_opt::on_print_help);
+						[](get_opt_context* self, fsm_t&) {
+							self->on_print_help();
+						});
 
 		ret->template add_state<state::end>(std::move(end_state));
 		ret->template set_finish_state<state::end>();
@@ -625,532 +2343,870 @@ get_opt<CharT, PrintfT>::make_machine() const {
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_arg0_enter(fsm_t& m) {
-	if (_parser_args.empty()) {
-		return m.template trigger<transition::error>(this);
+void get_opt_context<CharT, PrintfT>::parse_fsm() {
+	if (!_machine) {
+		_machine = make_machine();
+	}
+
+	while (!_machine->finished()) {
+		_machine->update(this);
+	}
+}
+
+template <class CharT, class PrintfT>
+template <typename get_opt_context<CharT, PrintfT>::transition (
+		get_opt_context<CharT, PrintfT>::*Handler)()>
+void get_opt_context<CharT, PrintfT>::fsm_enter(fsm_t& m) {
+	fsm_trigger(m, (this->*Handler)());
+}
+
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::fsm_trigger(fsm_t& m, transition t) {
+	switch (t) {
+	case transition::parse_next: {
+		m.template trigger<transition::parse_next>(this);
+	} break;
+	case transition::exit: {
+		m.template trigger<transition::exit>(this);
+	} break;
+	case transition::error: {
+		m.template trigger<transition::error>(this);
+	} break;
+	case transition::help: {
+		m.template trigger<transition::help>(this);
+	} break;
+	case transition::do_longarg: {
+		m.template trigger<transition::do_longarg>(this);
+	} break;
+	case transition::do_shortarg: {
+		m.template trigger<transition::do_shortarg>(this);
+	} break;
+	case transition::do_concat: {
+		m.template trigger<transition::do_concat>(this);
+	} break;
+	case transition::do_raw: {
+		m.template trigger<transition::do_raw>(this);
+	} break;
+	default: {
+		assert(false);
+	} break;
+	}
+}
+
+template <class CharT, class PrintfT>
+void get_opt_context<CharT, PrintfT>::parse_loop() {
+	// Same transitions as make_machine.
+	using table_t = std::array<std::array<state, size_t(transition::count)>,
+			size_t(state::count)>;
+	static constexpr table_t transitions = []() {
+		table_t ret{};
+		for (auto& row : ret) {
+			for (state& s : row) {
+				s = state::count;
+			}
+		}
+
+		auto add = [&](state from, transition t, state to) {
+			ret[size_t(from)][size_t(t)] = to;
+		};
+
+		add(state::arg0, transition::parse_next, state::choose_parsing);
+		add(state::arg0, transition::exit, state::end);
+		add(state::arg0, transition::error, state::end);
+		add(state::arg0, transition::help, state::end);
+
+		add(state::choose_parsing, transition::do_concat, state::parse_concat);
+		add(state::choose_parsing, transition::do_longarg,
+				state::parse_longarg);
+		add(state::choose_parsing, transition::do_shortarg,
+				state::parse_shortarg);
+		add(state::choose_parsing, transition::do_raw, state::parse_raw);
+		add(state::choose_parsing, transition::help, state::end);
+		add(state::choose_parsing, transition::exit, state::end);
+		add(state::choose_parsing, transition::error, state::end);
+
+		add(state::parse_raw, transition::error, state::end);
+		add(state::parse_raw, transition::parse_next, state::choose_parsing);
+
+		add(state::parse_longarg, transition::error, state::end);
+		add(state::parse_longarg, transition::parse_next,
+				state::choose_parsing);
+
+		add(state::parse_shortarg, transition::error, state::end);
+		add(state::parse_shortarg, transition::do_longarg,
+				state::parse_longarg);
+
+		add(state::parse_concat, transition::error, state::end);
+		add(state::parse_concat, transition::do_longarg, state::parse_longarg);
+
+		add(state::end, transition::help, state::end);
+		return ret;
+	}();
+
+	// Resumes where the last call stopped. A state which needs more input
+	// is entered again once it is fed.
+	while (_loop_state != state::end) {
+		transition t = transition::count;
+
+		switch (_loop_state) {
+		case state::arg0: {
+			t = on_arg0_enter();
+		} break;
+		case state::choose_parsing: {
+			t = on_parse_next_enter();
+		} break;
+		case state::parse_longarg: {
+			t = on_parse_longopt();
+		} break;
+		case state::parse_shortarg: {
+			t = on_parse_shortopt();
+		} break;
+		case state::parse_concat: {
+			t = on_parse_concat();
+		} break;
+		case state::parse_raw: {
+			t = on_parse_raw();
+		} break;
+		default: {
+			assert(false);
+			return;
+		} break;
+		}
+
+		if (t == transition::need_input) {
+			return;
+		}
+
+		_loop_state = transitions[size_t(_loop_state)][size_t(t)];
+		assert(_loop_state != state::count);
+
+		if (_loop_state == state::end) {
+			if (t == transition::error) {
+				t = on_print_error();
+			}
+			if (t == transition::help) {
+				on_print_help();
+			}
+		}
+	}
+}
+
+template <class CharT, class PrintfT>
+auto get_opt_context<CharT, PrintfT>::on_arg0_enter() -> transition {
+	if (args_empty()) {
+		return waiting_for_input() ? transition::need_input
+								   : transition::error;
 	}
 
 	bool success = true;
-	if (_arg0_func) {
-		success = std::invoke(_arg0_func, std::move(_parser_args.front()));
+	if (_spec->_arg0_func) {
+		auto timer = time_phase(parse_phase::callback, arg0_callback_id());
+		success = std::invoke(_spec->_arg0_func, front_arg());
 	}
 
-	_parser_args.pop_front();
+	pop_arg();
 
-	if (!success) {
-		return m.template trigger<transition::error>(this);
+	if (!success || _args_failed) {
+		return transition::error;
 	}
 
-	if (_parser_args.empty()) {
-		if (_no_arg_is_help) {
-			return m.template trigger<transition::help>(this);
+	if (args_empty() && !waiting_for_input()) {
+		if (_spec->_no_arg_is_help) {
+			return transition::help;
 		} else {
-			return m.template trigger<transition::exit>(this);
+			return transition::exit;
 		}
 	}
 
-	return m.template trigger<transition::parse_next>(this);
+	return transition::parse_next;
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_parse_next_enter(fsm_t& m) {
+auto get_opt_context<CharT, PrintfT>::on_parse_next_enter() -> transition {
+	auto timer = time_phase(parse_phase::classify);
 
-	if (_parser_args.empty()) {
-		return m.template trigger<transition::exit>(this);
+	// Finish the concatenated short args first, ex 'bc' in '-abc'
+	if (!_concat_args.empty()) {
+		return transition::do_concat;
 	}
 
-	string& first = _parser_args.front();
+	// The remaining arguments are the subcommand's.
+	if (_subcommand != compiled_options<CharT>::npos) {
+		return transition::exit;
+	}
 
-	// help
-	if (first == FEA_ML("-h") || first == FEA_ML("--help")
-			|| first == FEA_ML("/?") || first == FEA_ML("/help")
-			|| first == FEA_ML("/h")) {
-		return m.template trigger<transition::help>(this);
+	if (args_empty()) {
+		if (waiting_for_input()) {
+			return transition::need_input;
+		}
+		if (_args_failed) {
+			return transition::error;
+		}
+
+		// When feeding, arg0 doesn't know if more tokens are coming.
+		if (_feeding && _argc == 1 && _spec->_no_arg_is_help) {
+			return transition::help;
+		}
+		return transition::exit;
+	}
+
+	switch (detail::classify_arg(front_arg())) {
+	case detail::arg_kind::help: {
+		return transition::help;
+	} break;
+	case detail::arg_kind::shortarg: {
+		return transition::do_shortarg;
+	} break;
+	case detail::arg_kind::longarg: {
+		return transition::do_longarg;
+	} break;
+	case detail::arg_kind::concat: {
+		return transition::do_concat;
+	} break;
+	default: {
+		return transition::do_raw;
+	} break;
 	}
+}
 
-	// A single short arg, ex : '-d'
-	if (fea::starts_with(first, FEA_ML("-")) && first.size() == 2) {
-		return m.template trigger<transition::do_shortarg>(this);
-	}
+template <class CharT, class PrintfT>
+auto get_opt_context<CharT, PrintfT>::on_parse_longopt() -> transition {
+	using namespace detail;
 
-	// A long arg, ex '--something'
-	if (fea::starts_with(first, FEA_ML("--"))) {
-		return m.template trigger<transition::do_longarg>(this);
+	// Waiting for the values of a streaming multi option.
+	if (_streaming_opt != compiled_options<CharT>::npos) {
+		return on_stream_values();
 	}
 
-	// Concatenated short args, ex '-abdsc'
-	if (fea::starts_with(first, FEA_ML("-"))) {
-		return m.template trigger<transition::do_concat>(this);
-	}
+	// Comes from a short option, already resolved.
+	size_t opt_idx = _pending_opt;
+	bool from_short = opt_idx != compiled_options<CharT>::npos;
+
+	if (!from_short) {
+		// '--name=value' is split in place, the value is a view of the same
+		// argument.
+		string_view full_arg = front_arg();
+		string_view arg = detail::strip_dashes(full_arg);
+		size_t eq_pos = arg.find(FEA_CH('='));
+		string_view name = arg.substr(0, eq_pos);
+
+		// '---' or '--=x'.
+		if (name.empty()) {
+			pop_arg();
+			print(FEA_ML("Could not parse : '"), full_arg, FEA_ML("'\n"));
+			print(FEA_ML("Option doesn't exist.\n"));
+			return transition::error;
+		}
 
-	// Everything else failed, check raw args. ex '"some arg"'
-	return m.template trigger<transition::do_raw>(this);
-}
+		typename prefix_trie<CharT>::range matches;
+		{
+			auto timer = time_phase(parse_phase::lookup);
+			opt_idx = _spec->_opts.index.find_long(name);
+			if (opt_idx == compiled_options<CharT>::npos
+					&& _spec->_allow_abbreviations) {
+				matches = _spec->_prefixes.find(_spec->_opts.index, name);
+				if (matches.size() == 1) {
+					opt_idx = _spec->_prefixes.option(matches.first);
+				}
+			}
+		}
 
-template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_parse_longopt(fsm_t& m) {
-	using namespace detail;
-	string opt_str = _parser_args.front();
-	_parser_args.pop_front();
+		if (matches.size() > 1) {
+			pop_arg();
+			print_ambiguous(name, matches);
+			return transition::error;
+		}
+		if (opt_idx == compiled_options<CharT>::npos) {
+			pop_arg();
+			print(FEA_ML("Could not parse : '"), name, FEA_ML("'\n"));
+			print(FEA_ML("Option doesn't exist.\n"));
+			_suggested = print_suggestions(
+					_spec->_opts.index, _spec->_suggestions, name);
+			return transition::error;
+		}
+
+		if (eq_pos != string_view::npos) {
+			_attached_value = arg.substr(eq_pos + 1);
+		}
+	}
 
-	size_t new_beg = opt_str.find_first_not_of(FEA_ML("-"));
-	opt_str = opt_str.substr(new_beg);
+	// For messages.
+	string_view opt_str = option_name(opt_idx);
+	const option_hot<CharT>& user_opt = _spec->_opts.opts[opt_idx];
 
-	if (_long_opt_to_user_opt.count(opt_str) == 0) {
-		print(FEA_ML("Could not parse : '") + opt_str + FEA_ML("'\n"));
-		print(FEA_ML("Option doesn't exist.\n"));
-		return m.template trigger<transition::error>(this);
+	// When feeding, wait for the option's values before consuming anything.
+	size_t value_idx = from_short ? _arg_idx : _arg_idx + 1;
+	if (!has_lookahead(user_opt, value_idx)) {
+		_wait_for_option = user_opt.opt_type == user_option_e::multi_arg
+				&& (value_idx < _argc || _attached_value.data() != nullptr);
+		return transition::need_input;
 	}
 
-	user_option<CharT>& user_opt = _long_opt_to_user_opt.at(opt_str);
+	if (from_short) {
+		_pending_opt = compiled_options<CharT>::npos;
+	} else {
+		pop_arg();
+	}
 
-	if (user_opt.has_been_parsed) {
-		print(FEA_ML("'") + opt_str + FEA_ML("' already parsed.\n"));
-		return m.template trigger<transition::error>(this);
+	// Counters may repeat.
+	if (user_opt.opt_type != user_option_e::counter) {
+		if (_parsed[opt_idx] == _epoch) {
+			print(FEA_ML("'"), opt_str, FEA_ML("' already parsed.\n"));
+			return transition::error;
+		}
+		_parsed[opt_idx] = _epoch;
 	}
-	user_opt.has_been_parsed = true;
 
 	// Raw args are stored elsewhere.
 	assert(user_opt.opt_type != user_option_e::raw_arg);
 
+	bool attached = _attached_value.data() != nullptr;
+	if (attached
+			&& (user_opt.opt_type == user_option_e::flag
+					|| user_opt.opt_type == user_option_e::counter)) {
+		print(FEA_ML("Could not parse : '"), opt_str, FEA_ML("'\n"));
+		print(FEA_ML("Option doesn't take an argument.\n"));
+		return transition::error;
+	}
+
 	bool success = false;
 	// Set this now for later.
-	string default_val = user_opt.default_val;
+	string_view default_val
+			= _spec->_opts.strings.get(_spec->_opts.cold[opt_idx].default_val);
 
 	switch (user_opt.opt_type) {
-	case user_option_e::flag: {
+	case user_option_e::flag:
+	case user_option_e::counter: {
 		// A simple flag, call user func.
-		success = user_opt.flag_func();
+		auto timer = time_phase(parse_phase::callback, opt_idx);
+		success = std::get<flag_func_t>(user_opt.func)();
 	} break;
 	case user_option_e::required_arg: {
 		// An option that requires one argument.
 
-		if (_parser_args.empty()
-				|| fea::starts_with(_parser_args.front(), FEA_ML("-"))) {
-			print(FEA_ML("Could not parse : '") + opt_str + FEA_ML("'\n"));
+		if (!has_value_arg()) {
+			print(FEA_ML("Could not parse : '"), opt_str, FEA_ML("'\n"));
 			print(FEA_ML("Option requires an argument, none was provided.\n"));
-			return m.template trigger<transition::error>(this);
+			return transition::error;
 		}
 
-		string arg = _parser_args.front();
-		_parser_args.pop_front();
+		string_view arg = value_arg();
+		pop_value();
 
-		success = user_opt.one_arg_func(std::move(arg));
+		success = call_one_arg(opt_idx, arg);
 	} break;
 	case user_option_e::optional_arg: {
-		default_val = FEA_ML(""); // Reset the default val to nothing.
+		default_val = {}; // Reset the default val to nothing.
 		// Parsing is the same as default.
 	}
 		[[fallthrough]];
 	case user_option_e::default_arg: {
-		if (_parser_args.empty()
-				|| fea::starts_with(_parser_args.front(), FEA_ML("-"))) {
-			success = user_opt.one_arg_func(std::move(default_val));
+		// Attached values are always the option's, ex '--opt=value'.
+		if (!attached
+				&& (!has_value_arg()
+						|| (user_opt.is_bool && !is_bool_arg()))) {
+			success = call_one_arg(opt_idx, default_val);
 		} else {
-			string arg = _parser_args.front();
-			_parser_args.pop_front();
+			string_view arg = value_arg();
+			pop_value();
 
-			success = user_opt.one_arg_func(std::move(arg));
+			success = call_one_arg(opt_idx, arg);
 		}
 	} break;
 	case user_option_e::multi_arg: {
 
 		// Needs at least 1 arg.
-		if (_parser_args.empty()
-				|| fea::starts_with(_parser_args.front(), FEA_ML("-"))) {
-			print(FEA_ML("Could not parse : '") + opt_str + FEA_ML("'\n"));
+		if (!has_value_arg()) {
+			print(FEA_ML("Could not parse : '"), opt_str, FEA_ML("'\n"));
 			print(FEA_ML("Option requires at minimum 1 argument, none was "
 						 "provided.\n"));
-			return m.template trigger<transition::error>(this);
+			return transition::error;
 		}
 
-		std::vector<string> args;
+		string_view arg = value_arg();
+		pop_value();
+		bool quoted = arg.find(FEA_CH(' ')) != string_view::npos;
+
+		if (const auto* stream_func
+				= std::get_if<one_arg_func_t<CharT>>(&user_opt.func)) {
+			// Values in quotes are all there, otherwise stream them up till
+			// the end or the next '-'
+			bool streamed = false;
+			{
+				auto timer = time_phase(parse_phase::callback, opt_idx);
+				if (quoted) {
+					success = for_each_word(arg, *stream_func);
+				} else {
+					streamed = (*stream_func)(arg);
+				}
+			}
+			if (streamed) {
+				_streaming_opt = opt_idx;
+				return on_stream_values();
+			}
+			break;
+		}
 
-		string arg = _parser_args.front();
-		_parser_args.pop_front();
+		_multi_args.clear();
+		bool fits = true;
 
 		// Were the args enclosed in quotes?
-		if (arg.find(FEA_CH(' ')) != string::npos) {
-			args = fea::split(arg, FEA_CH(' '));
-			success = user_opt.multi_arg_func(std::move(args));
+		if (quoted) {
+			fits = for_each_word(arg,
+					[this](string_view word) { return push_multi_arg(word); });
 		} else {
+			// Values are contiguous in argv, reserve once.
+			if (_response_stack.empty() && !_heap_free) {
+				size_t end = _arg_idx;
+				while (end < _argc && !starts_with_dash(arg_at(end))) {
+					++end;
+				}
+				_multi_args.reserve(end - _arg_idx + 1);
+			}
+
 			// Gather everything up till the end or the next '-'
-			args.push_back(std::move(arg));
+			fits = push_multi_arg(arg);
 
-			while (!_parser_args.empty()
-					&& !fea::starts_with(_parser_args.front(), FEA_ML("-"))) {
-				args.push_back(std::move(_parser_args.front()));
-				_parser_args.pop_front();
+			while (fits && has_value_arg()) {
+				fits = push_multi_arg(value_arg());
+				pop_value();
 			}
+		}
 
-			success = user_opt.multi_arg_func(std::move(args));
+		if (!fits) {
+			print(FEA_ML("Could not parse : '"), opt_str, FEA_ML("'\n"));
+			print(FEA_ML("Option has too many arguments.\n"));
+			return transition::error;
 		}
+
+		const auto& multi_func
+				= std::get<multi_arg_func_t<CharT>>(user_opt.func);
+		auto timer = time_phase(parse_phase::callback, opt_idx);
+		success = multi_func(_multi_args);
 	} break;
 	default: {
 		assert(false);
 		print(FEA_ML(
 				"Something went horribly wrong, please report this bug <3\n"));
-		return m.template trigger<transition::error>(this);
+		return transition::error;
 	} break;
 	}
 
 	if (!success) {
-		print(FEA_ML("'") + _parser_args.front()
-				+ FEA_ML("' problem parsing argument.\n"));
-		return m.template trigger<transition::error>(this);
+		print(FEA_ML("'"), opt_str, FEA_ML("' problem parsing argument.\n"));
+		return transition::error;
 	}
 
-	return m.template trigger<transition::parse_next>(this);
+	return transition::parse_next;
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_parse_shortopt(fsm_t& m) {
-	assert(_parser_args.front().size() == 2);
+auto get_opt_context<CharT, PrintfT>::on_stream_values() -> transition {
+	using namespace detail;
+	assert(_streaming_opt != compiled_options<CharT>::npos);
+
+	const one_arg_func_t<CharT>& func = std::get<one_arg_func_t<CharT>>(
+			_spec->_opts.opts[_streaming_opt].func);
+
+	while (has_value_arg()) {
+		string_view arg = value_arg();
+		pop_value();
+
+		bool success = false;
+		{
+			auto timer = time_phase(parse_phase::callback, _streaming_opt);
+			success = func(arg);
+		}
+		if (!success) {
+			print(FEA_ML("'"), option_name(_streaming_opt),
+					FEA_ML("' problem parsing argument.\n"));
+			_streaming_opt = compiled_options<CharT>::npos;
+			return transition::error;
+		}
+	}
+
+	// More values may be fed.
+	if (args_empty() && waiting_for_input()) {
+		return transition::need_input;
+	}
+
+	_streaming_opt = compiled_options<CharT>::npos;
+	return transition::parse_next;
+}
 
-	string arg = _parser_args.front();
-	_parser_args.pop_front();
+template <class CharT, class PrintfT>
+auto get_opt_context<CharT, PrintfT>::on_parse_shortopt() -> transition {
+	assert(front_arg().size() == 2);
 
-	size_t new_beg = arg.find_first_not_of(FEA_ML("-"));
-	arg = arg.substr(new_beg);
+	string_view arg = detail::strip_dashes(front_arg());
+	pop_arg();
 
-	assert(arg.size() == 1);
+	if (arg.size() != 1) {
+		// '--'
+		print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
+		print(FEA_ML("Option not recognized.\n"));
+		return transition::error;
+	}
 
 	CharT short_opt = arg[0];
 
-	if (_short_opt_to_long_opt.count(short_opt) == 0) {
-		print(FEA_ML("Could not parse : '") + arg + FEA_ML("'\n"));
+	size_t opt_idx = compiled_options<CharT>::npos;
+	{
+		auto timer = time_phase(parse_phase::lookup);
+		opt_idx = _spec->_opts.index.find_short(short_opt);
+	}
+	if (opt_idx == compiled_options<CharT>::npos) {
+		print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
 		print(FEA_ML("Option not recognized.\n"));
-		return m.template trigger<transition::error>(this);
+		return transition::error;
 	}
 
-	_parser_args.push_front(
-			FEA_ML("--") + _short_opt_to_long_opt.at(short_opt));
-	return m.template trigger<transition::do_longarg>(this);
+	_pending_opt = opt_idx;
+	return transition::do_longarg;
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_parse_concat(fsm_t& m) {
-	string arg = _parser_args.front();
-	_parser_args.pop_front();
+auto get_opt_context<CharT, PrintfT>::on_parse_concat() -> transition {
+	if (_concat_args.empty()) {
+		// New concatenated options, make sure they all exist before calling
+		// anything. The bundle ends at the first option which takes the rest
+		// as value, ex '-vj8'.
+		string_view arg = detail::strip_dashes(front_arg());
+		pop_arg();
+
+		if (arg.empty()) {
+			// '-'
+			print(FEA_ML("Could not parse : '-'\n"));
+			print(FEA_ML("Option not recognized.\n"));
+			return transition::error;
+		}
 
-	size_t new_beg = arg.find_first_not_of(FEA_ML("-"));
-	arg = arg.substr(new_beg);
+		auto timer = time_phase(parse_phase::lookup);
+		for (size_t i = 0; i < arg.size(); ++i) {
+			size_t opt_idx = _spec->_opts.index.find_short(arg[i]);
+			if (opt_idx == compiled_options<CharT>::npos) {
+				print(FEA_ML("Could not parse : '"), arg.substr(i, 1),
+						FEA_ML("'\n"));
+				print(FEA_ML("Option not recognized.\n"));
+				return transition::error;
+			}
 
-	std::vector<string> long_args;
-	for (CharT short_opt : arg) {
-		if (_short_opt_to_long_opt.count(short_opt) == 0) {
-			print(FEA_ML("Could not parse : '") + string{ short_opt }
-					+ FEA_ML("'\n"));
-			print(FEA_ML("Option not recognized.\n"));
-			return m.template trigger<transition::error>(this);
+			if (takes_attached(opt_idx, arg.substr(i + 1))) {
+				break;
+			}
 		}
 
-		long_args.push_back(
-				FEA_ML("--") + _short_opt_to_long_opt.at(short_opt));
+		_concat_args = arg;
 	}
 
-	_parser_args.insert(
-			_parser_args.begin(), long_args.begin(), long_args.end());
-	return m.template trigger<transition::do_longarg>(this);
+	// Parse them one at a time, in place.
+	CharT short_opt = _concat_args.front();
+	_concat_args.remove_prefix(1);
+
+	auto timer = time_phase(parse_phase::lookup);
+	_pending_opt = _spec->_opts.index.find_short(short_opt);
+
+	// The rest is the option's value.
+	if (takes_attached(_pending_opt, _concat_args)) {
+		_attached_value = _concat_args;
+		_concat_args = {};
+	}
+	return transition::do_longarg;
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_parse_raw(fsm_t& m) {
+auto get_opt_context<CharT, PrintfT>::on_parse_raw() -> transition {
 	using namespace detail;
 
-	auto next_rawopt = std::find_if(_raw_opts.begin(), _raw_opts.end(),
-			[](const user_option<CharT>& o) { return !o.has_been_parsed; });
+	string_view arg = front_arg();
+
+	// A subcommand is the first positional argument.
+	if (_raw_idx == 0 && !_spec->_subcommands.empty()
+			&& _response_stack.empty()) {
+		size_t sub_idx;
+		{
+			auto timer = time_phase(parse_phase::lookup);
+			sub_idx = _spec->_subcommands.find_long(arg);
+		}
+
+		if (sub_idx != compiled_options<CharT>::npos) {
+			_subcommand = sub_idx;
+			// Response files after it are the subcommand's to expand.
+			advance_arg();
+			return transition::parse_next;
+		}
+
+		if (_spec->_opts.raw_opts.empty()) {
+			print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
+			print(FEA_ML("Command doesn't exist.\n"));
+			_suggested = print_suggestions(
+					_spec->_subcommands, _spec->_subcommand_suggestions, arg);
+			return transition::error;
+		}
+	}
 
 	// We've parsed all raw options, user provided options are curropted.
-	if (next_rawopt == _raw_opts.end()) {
-		print(FEA_ML("Could not parse : '") + _parser_args.front()
-				+ FEA_ML("'\n"));
+	if (_raw_idx >= _spec->_opts.raw_opts.size()) {
+		print(FEA_ML("Could not parse : '"), arg, FEA_ML("'\n"));
 		print(FEA_ML("All arguments have previously been parsed.\n"));
-		return m.template trigger<transition::error>(this);
+		return transition::error;
 	}
 
-	bool success = next_rawopt->one_arg_func(std::move(_parser_args.front()));
-	next_rawopt->has_been_parsed = true;
+	// Raw options are parsed in order.
+	bool success = false;
+	{
+		auto timer = time_phase(
+				parse_phase::callback, raw_callback_id(_raw_idx));
+		success = std::get<one_arg_func_t<CharT>>(
+				_spec->_opts.raw_opts[_raw_idx].func)(arg);
+	}
+	++_raw_idx;
 
 	if (!success) {
-		print(FEA_ML("'") + _parser_args.front()
-				+ FEA_ML("' problem parsing argument.\n"));
-		return m.template trigger<transition::error>(this);
+		print(FEA_ML("'"), arg, FEA_ML("' problem parsing argument.\n"));
+		return transition::error;
 	}
 
-	_parser_args.pop_front();
+	pop_arg();
 
-	return m.template trigger<transition::parse_next>(this);
+	return transition::parse_next;
 }
 
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_print_error(fsm_t& m) {
+auto get_opt_context<CharT, PrintfT>::on_print_error() -> transition {
 	// print(FEA_ML("problem parsing provided options :\n"));
 	// print(_error_message);
+	if (_suggested) {
+		// The help can be very long, point to it instead.
+		print(FEA_ML("Use '--help' to see all options.\n"));
+		return transition::help;
+	}
 	print(FEA_ML("\n\n"));
-	m.template trigger<transition::help>(this);
+	return transition::help;
 }
 
 template <class CharT, class PrintfT>
-void get_opt<CharT, PrintfT>::on_print_help(fsm_t&) {
+void get_opt_context<CharT, PrintfT>::on_print_help() {
 	_success = false;
 
-	using namespace detail;
-
-	// The first string is printed as-is.
-	// Tries to find '\n'. If it does, splits the incoming string and prints at
-	// indentation.
-	// If there is no '\n', simply prints str and returns.
-	auto print_description = [this](const string& desc, size_t indendation) {
-		if (desc.empty())
-			return;
-
-		// Split the string if it contains \n, so substrings start on a new line
-		// with the appropriate indentation.
-		std::vector<string> str_vec;
-		if (desc.find(FEA_CH('\n')) == string::npos) {
-			// There is no '\n'.
-			str_vec.push_back(desc);
-		} else {
-			// There is '\n'
-			str_vec = fea::split(desc, FEA_CH('\n'));
-		}
-
-		// Now, make sure all strings are less than output_width in *real* size.
-
-		// To do that, we must convert to utf32 to do our work. This includes
-		// getting "language" size, and splitting the strings.
-
-		// If some strings are wider than the max output, split them at the
-		// first word possible, so it's pretty. Insert the split strings
-		// in the final output vector.
-		// If no splitting is required, simply add to the vector.
-		std::vector<string> out_str_vec;
-		out_str_vec.reserve(out_str_vec.size());
-
-		for (const string& s : str_vec) {
-			// Get a utf32 string to work without brain damage.
-			std::u32string utf32 = any_to_utf32(s);
-			// Gets the actual lexical size of the string. We include the
-			// indentation width that comes before.
-			size_t real_size = utf32.size() + indendation;
-
-			// We must splitty split.
-			if (real_size > _output_width) {
-				size_t pos = 0;
-				// Find substrings and split them.
-				while (real_size - pos > _output_width) {
-					std::u32string new_str
-							= utf32.substr(pos, _output_width - indendation);
-					// Find where we can split nicely.
-					size_t space_pos = new_str.find_last_of(U' ');
-
-					// Pushback the string, split nicely at the last word.
-					out_str_vec.push_back(
-							utf32_to_any<CharT>(new_str.substr(0, space_pos)));
-
-					// Don't forget to ignore the space for the next sentence.
-					pos += space_pos + 1;
-				}
-				// We still have 1 leftover split at the end.
-				std::u32string new_str
-						= utf32.substr(pos, _output_width - indendation);
-				out_str_vec.push_back(utf32_to_any<CharT>(new_str));
-
-			} else {
-				out_str_vec.push_back(s);
-			}
-		}
-
-
-		// Finally, print everything at the right indentation.
-		for (size_t i = 0; i < out_str_vec.size(); ++i) {
-			const string& substr = out_str_vec[i];
-			print(substr + FEA_ML("\n"));
-
-			// Print the indentation for the next string if there is one.
-			if (i + 1 < out_str_vec.size()) {
-				print(string(indendation, FEA_CH(' ')));
-			}
-		}
-	};
-
-	constexpr size_t indent = 1;
-	constexpr size_t shortopt_width = 4;
-	constexpr size_t shortopt_total_width = indent + shortopt_width;
-	constexpr size_t longopt_space = 2;
-	constexpr size_t longopt_width_max = 30;
-	constexpr size_t rawopt_help_indent = 4;
-	const string opt_str = FEA_ML(" <optional>");
-	const string req_str = FEA_ML(" <value>");
-	const string multi_str = FEA_ML(" <multiple>");
-	const string default_beg = FEA_ML(" <=");
-	const string default_end = FEA_ML(">");
+	if (_suggested) {
+		// Help wasn't asked for, nor printed.
+		flush_output();
+		return;
+	}
 
-	if (!_help_intro.empty()) {
-		print(_help_intro + FEA_ML("\n"));
+	string_view arg0;
+	if (_argc > 0) {
+		arg0 = arg_at(0);
 	}
 
-	// Usage
 	{
-		string out_str;
-		for (const user_option<CharT>& raw_opt : _raw_opts) {
-			out_str += FEA_ML(" ");
-			out_str += raw_opt.long_name;
-		}
+		// The cached help isn't copied, arg0 is inserted between its pieces.
+		auto timer = time_phase(parse_phase::help);
+		string_view help = _spec->_help_text;
+		print_ref(help.substr(0, _spec->_help_arg0_pos));
+		print(arg0);
+		print_ref(help.substr(_spec->_help_arg0_pos));
+		flush_output();
+	}
 
-		print(FEA_ML("\nUsage: ") + _all_args.front() + out_str
-				+ FEA_ML(" [options]\n\n"));
+	// Finally, if the user had passed in a callback to be notified when
+	// help was called, call that.
+	if (_spec->_help_func) {
+		auto timer = time_phase(parse_phase::callback, help_callback_id());
+		_spec->_help_func();
 	}
+}
 
-	// Raw Options
-	if (!_raw_opts.empty()) {
-		// Find the biggest raw option name size.
-		// The raw option's name is stored in its long_opt string.
-		size_t max_name_width = 0;
-		for (const user_option<CharT> raw_opt : _raw_opts) {
-			size_t name_width = raw_opt.long_name.size() + rawopt_help_indent;
-			max_name_width = std::max(max_name_width, name_width);
-		}
 
-		// Print section header.
-		print(FEA_ML("Arguments:\n"));
+template <class CharT, class PrintfT>
+get_opt<CharT, PrintfT>::get_opt()
+		: get_opt(detail::get_print<CharT>()) {
+}
 
-		// Now, print the raw option help.
-		for (const user_option<CharT> raw_opt : _raw_opts) {
-			// Print indentation.
-			print(string(indent, FEA_CH(' ')));
+template <class CharT, class PrintfT>
+get_opt<CharT, PrintfT>::get_opt(PrintfT printf_func)
+		: get_opt(printf_func, std::pmr::get_default_resource()) {
+}
 
-			// Print the help, and use max_name_width so each help line is
-			// properly aligned.
-			string out = raw_opt.long_name;
-			out.resize(max_name_width, FEA_CH(' '));
-			print(out);
+template <class CharT, class PrintfT>
+get_opt<CharT, PrintfT>::get_opt(std::pmr::memory_resource* resource)
+		: get_opt(detail::get_print<CharT>(), resource) {
+}
 
-			// Print the help message. This will split the message if it is too
-			// wide, or if the user used '\n' in his message.
-			print_description(raw_opt.description, indent + max_name_width);
-		}
-		print(FEA_ML("\n"));
+template <class CharT, class PrintfT>
+get_opt<CharT, PrintfT>::get_opt(
+		PrintfT printf_func, std::pmr::memory_resource* resource)
+		: spec_t(printf_func)
+		, _context(*this, resource)
+		, _resource(resource) {
+}
+
+template <class CharT, class PrintfT>
+void get_opt<CharT, PrintfT>::freeze() {
+	if (this->frozen()) {
+		return;
 	}
 
-	// All Other Options
-	{
-		print(FEA_ML("Options:\n"));
+	auto timer = _context.time_phase(parse_phase::help);
+	spec_t::freeze();
+}
 
-		// First, compute the maximum width of long options.
-		size_t longopt_width = 0;
-		for (const std::pair<string, user_option<CharT>>& opt_p :
-				_long_opt_to_user_opt) {
-			const string& long_opt_str = opt_p.first;
-			const user_option<CharT>& opt = opt_p.second;
+template <class CharT, class PrintfT>
+void get_opt<CharT, PrintfT>::parse_engine(get_opt_engine engine) {
+	context().parse_engine(engine);
+}
 
-			size_t size = 2 + long_opt_str.size() + longopt_space;
-			if (opt.opt_type == user_option_e::optional_arg) {
-				size += opt_str.size();
-			} else if (opt.opt_type == user_option_e::required_arg) {
-				size += req_str.size();
-			} else if (opt.opt_type == user_option_e::default_arg) {
-				size += default_beg.size() + opt.default_val.size()
-						+ default_end.size();
-			} else if (opt.opt_type == user_option_e::multi_arg) {
-				size += multi_str.size();
-			}
+template <class CharT, class PrintfT>
+bool get_opt<CharT, PrintfT>::parse_options(
+		size_t argc, CharT const* const* argv) {
+	this->freeze();
+	_fed_subcommand = nullptr;
+	if (!context().parse_options(argc, argv)) {
+		return false;
+	}
 
-			longopt_width = std::max(longopt_width, size);
-		}
+	size_t sub_idx = _context.subcommand();
+	if (sub_idx == compiled_options<CharT>::npos) {
+		return true;
+	}
 
-		// Cap it to longopt_width_max though. If it is bigger than this, we'll
-		// print it on a new line.
-		if (longopt_width > longopt_width_max) {
-			longopt_width = longopt_width_max;
-		}
+	get_opt& sub = start_subcommand(sub_idx, argv[0]);
+	_subcommand_argv.assign(1, _subcommand_arg0.c_str());
+	_subcommand_argv.insert(_subcommand_argv.end(),
+			argv + _context.subcommand_arg(), argv + argc);
+	return sub.parse_options(_subcommand_argv.size(), _subcommand_argv.data());
+}
 
-		// Print the options.
-		for (const std::pair<string, user_option<CharT>>& opt_p :
-				_long_opt_to_user_opt) {
-			const string& long_opt_str = opt_p.first;
-			const user_option<CharT>& opt = opt_p.second;
+template <class CharT, class PrintfT>
+bool get_opt<CharT, PrintfT>::feed(string_view token) {
+	this->freeze();
+	if (_fed_subcommand != nullptr) {
+		return _fed_subcommand->feed(token);
+	}
 
-			// Print indentation.
-			print(string(indent, FEA_CH(' ')));
+	if (!context().feed(token)) {
+		return false;
+	}
 
-			// If the option has a shortarg, print that.
-			if (opt.short_name != FEA_CH('\0')) {
-				string shortopt_str;
-				shortopt_str += FEA_ML("-");
-				shortopt_str += opt.short_name;
-				shortopt_str += FEA_ML(",");
-				string out = shortopt_str;
-				out.resize(shortopt_width, FEA_CH(' '));
-				print(out);
-			} else {
-				print(string(shortopt_width, FEA_CH(' ')));
-			}
+	// Parsing stops at the subcommand, it is the last token.
+	size_t sub_idx = _context.subcommand();
+	if (sub_idx == compiled_options<CharT>::npos) {
+		return true;
+	}
+	_fed_subcommand = &start_subcommand(sub_idx, _context.arg_at(0));
+	return _fed_subcommand->feed(_subcommand_arg0);
+}
 
-			// Build the longopt string.
-			string longopt_str;
-			longopt_str += FEA_ML("--");
-			longopt_str += long_opt_str;
+template <class CharT, class PrintfT>
+bool get_opt<CharT, PrintfT>::finish() {
+	this->freeze();
+	if (_fed_subcommand != nullptr) {
+		// The next token starts a new command line. Parsing already
+		// stopped at the subcommand.
+		get_opt* sub = _fed_subcommand;
+		_fed_subcommand = nullptr;
+		context().finish();
+		return sub->finish();
+	}
+	return context().finish();
+}
 
-			// Add the specific "instructions" for each type of arg.
-			if (opt.opt_type == user_option_e::optional_arg) {
-				longopt_str += opt_str;
-			} else if (opt.opt_type == user_option_e::required_arg) {
-				longopt_str += req_str;
-			} else if (opt.opt_type == user_option_e::default_arg) {
-				longopt_str += default_beg;
-				longopt_str += opt.default_val;
-				longopt_str += default_end;
-			} else if (opt.opt_type == user_option_e::multi_arg) {
-				longopt_str += multi_str;
-			}
+template <class CharT, class PrintfT>
+void get_opt<CharT, PrintfT>::reset() {
+	this->freeze();
+	_fed_subcommand = nullptr;
+	context().reset();
+}
 
-			// Print the longopt string.
-			string out = longopt_str;
-			out.resize(longopt_width, FEA_CH(' '));
-			print(out);
+template <class CharT, class PrintfT>
+void get_opt<CharT, PrintfT>::add_subcommand(string&& name,
+		std::function<void(get_opt&)>&& factory, string&& help) {
+	spec_t::add_subcommand(std::move(name), std::move(help));
+	_subcommand_opts.resize(this->_subcommands.size());
+	_subcommand_opts.back().factory = std::move(factory);
+}
 
-			// If it was bigger than the max width, the description will be
-			// printed on the next line, indented up to the right position.
-			if (longopt_str.size() >= longopt_width) {
-				print(FEA_ML("\n"));
-				print(string(
-						longopt_width + shortopt_total_width, FEA_CH(' ')));
-			}
+template <class CharT, class PrintfT>
+auto get_opt<CharT, PrintfT>::subcommand() const -> string_view {
+	size_t sub_idx = _context.subcommand();
+	if (sub_idx == compiled_options<CharT>::npos) {
+		return {};
+	}
+	return this->_subcommands.long_name(sub_idx);
+}
 
-			// Print the help message, indents appropriately and splits into
-			// multiple strings if the message is too wide.
-			print_description(
-					opt.description, longopt_width + shortopt_total_width);
-		}
+template <class CharT, class PrintfT>
+auto get_opt<CharT, PrintfT>::subcommand_options(string_view name)
+		-> get_opt& {
+	size_t sub_idx = this->_subcommands.find_long(name);
+	if (sub_idx == compiled_options<CharT>::npos) {
+		throw std::invalid_argument{
+			"get_opt::subcommand_options : Subcommand doesn't exist."
+		};
+	}
 
-		if (longopt_width == 0) // No options, width is --help only.
-			longopt_width = 2 + 4 + longopt_space;
+	return build_subcommand(sub_idx);
+}
 
-		// Print the help command help.
-		string short_help = FEA_ML("-h,");
-		short_help.resize(shortopt_width, FEA_CH(' '));
+template <class CharT, class PrintfT>
+auto get_opt<CharT, PrintfT>::build_subcommand(size_t sub_idx) -> get_opt& {
+	_subcommand_opts.resize(this->_subcommands.size());
+	subcommand_entry& entry = _subcommand_opts[sub_idx];
+
+	if (!entry.opts) {
+		// Settings are inherited, the factory can change them.
+		auto opts = std::make_unique<get_opt>(this->_print_func, _resource);
+		opts->console_width(this->_output_width);
+		if (!this->_no_arg_is_help) {
+			opts->no_options_is_ok();
+		}
+		if (this->_allow_response_files) {
+			opts->allow_response_files();
+		}
+		opts->parse_engine(_context._engine);
+		if (entry.factory) {
+			entry.factory(*opts);
+		}
+		entry.opts = std::move(opts);
+	}
+	return *entry.opts;
+}
 
-		string long_help = FEA_ML("--help");
-		long_help.resize(longopt_width, FEA_CH(' '));
+template <class CharT, class PrintfT>
+auto get_opt<CharT, PrintfT>::start_subcommand(size_t sub_idx,
+		string_view arg0) -> get_opt& {
+	// ex : 'tool build'
+	_subcommand_arg0.assign(arg0);
+	_subcommand_arg0 += FEA_CH(' ');
+	_subcommand_arg0 += this->_subcommands.long_name(sub_idx);
+	return build_subcommand(sub_idx);
+}
 
-		print(string(indent, FEA_CH(' ')) + short_help + long_help
-				+ FEA_ML("Print this help\n"));
+#if defined(FEA_GETOPT_INSTRUMENT)
+template <class CharT, class PrintfT>
+instrumentation& get_opt<CharT, PrintfT>::instrument() {
+	return _context.instrument();
+}
 
-		// Print user outro.
-		if (!_help_outro.empty()) {
-			print(FEA_ML("\n") + _help_outro + FEA_ML("\n"));
-		}
+template <class CharT, class PrintfT>
+const instrumentation& get_opt<CharT, PrintfT>::instrument() const {
+	return _context.instrument();
+}
+#endif
 
-		// Finally, if the user had passed in a callback to be notified when
-		// help was called, call that.
-		if (_help_func) {
-			_help_func();
-		}
-	}
-} // namespace fea
+template <class CharT, class PrintfT>
+void get_opt<CharT, PrintfT>::heap_free(
+		size_t max_multi_values, size_t max_output) {
+	this->freeze();
+	context().heap_free(max_multi_values, max_output);
+}
 
+template <class CharT, class PrintfT>
+auto get_opt<CharT, PrintfT>::context() -> context_t& {
+	_context._spec = this;
+	return _context;
+}
 
 } // namespace fea
@@ -0,0 +1,508 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+Parse instrumentation, compiled in when FEA_GETOPT_INSTRUMENT is defined.
+Otherwise, get_opt has no instrumentation and the hooks compile to
+nothing.
+
+Each get_opt_context records, over all its parses :
+- A latency histogram per parse phase. Phases are tokenizing (fed tokens
+  and response files), classifying arguments, looking up options, calling
+  callbacks and rendering or printing help.
+- A latency histogram per callback, keyed by option name.
+- The allocations made while parsing.
+- The last trace events, which can be exported as Chrome trace-event JSON
+  and opened in chrome://tracing or Perfetto.
+
+ex :
+#define FEA_GETOPT_INSTRUMENT
+#include <fea_getopt/fea_getopt.hpp>
+
+fea::get_opt<char> opt;
+// ...
+opt.parse_options(argc, argv);
+printf("%s", opt.instrument().report().c_str());
+*/
+
+namespace fea {
+enum class parse_phase : std::uint8_t {
+	tokenize,
+	classify,
+	lookup,
+	callback,
+	help,
+	count,
+};
+
+inline constexpr std::string_view parse_phase_names[] = {
+	"tokenize",
+	"classify",
+	"lookup",
+	"callback",
+	"help",
+};
+
+// Durations, in power of 2 buckets of nanoseconds. Constant size, for
+// long-running processes.
+struct latency_histogram {
+	using duration = std::chrono::nanoseconds;
+
+	void record(duration d);
+
+	std::uint64_t count() const;
+	duration total() const;
+	duration min() const;
+	duration max() const;
+	duration mean() const;
+
+	// The upper bound of the bucket which holds the percentile p, in
+	// [0, 100]. Capped to max().
+	duration percentile(double p) const;
+
+	void clear();
+
+private:
+	std::array<std::uint64_t, 64> _buckets{};
+	std::uint64_t _count = 0;
+	std::int64_t _total = 0;
+	std::int64_t _min = (std::numeric_limits<std::int64_t>::max)();
+	std::int64_t _max = 0;
+};
+
+// A timed phase, for the Chrome trace.
+struct trace_event {
+	// Since the instrumentation was created.
+	std::int64_t start_ns = 0;
+	std::int64_t duration_ns = 0;
+	// The callback id, or instrumentation::no_callback.
+	std::uint32_t callback = 0;
+	parse_phase phase = parse_phase::count;
+};
+
+struct instrumentation {
+	using clock = std::chrono::steady_clock;
+
+	static constexpr std::uint32_t no_callback
+			= (std::numeric_limits<std::uint32_t>::max)();
+
+	// Parsing allocations are counted, then forwarded to upstream.
+	explicit instrumentation(std::pmr::memory_resource* upstream
+			= std::pmr::get_default_resource());
+
+	instrumentation(const instrumentation&) = delete;
+	instrumentation& operator=(const instrumentation&) = delete;
+
+	const latency_histogram& phase(parse_phase p) const;
+
+	// Callbacks are options, raw options, arg0 and the help callback.
+	size_t callback_count() const;
+	std::string_view callback_name(size_t id) const;
+	const latency_histogram& callback(size_t id) const;
+
+	// Allocations made by the parse strings and containers.
+	std::uint64_t allocations() const;
+	std::uint64_t allocated_bytes() const;
+
+	// The last trace events are kept, the oldest are dropped. 0 disables
+	// tracing. Defaults to 65536 events. Releases the ring, see reserve_trace.
+	void trace_capacity(size_t event_count);
+	// Allocates the whole ring now, recording doesn't allocate afterwards.
+	void reserve_trace();
+	// The kept events, oldest first.
+	std::vector<trace_event> trace_events() const;
+	// Chrome trace-event JSON, with complete events ("ph":"X").
+	std::string chrome_trace(int pid = 1, int tid = 1) const;
+
+	// A human readable summary of the phases, callbacks and allocations.
+	std::string report() const;
+
+	// Clears the histograms, counts and events. Keeps the callback names.
+	void clear();
+
+	// Used by get_opt_context.
+	void record(parse_phase p, std::uint32_t callback, clock::time_point beg,
+			clock::time_point end);
+	void name_callbacks(std::vector<std::string>&& names);
+	std::pmr::memory_resource* resource();
+
+private:
+	struct counting_resource : std::pmr::memory_resource {
+		explicit counting_resource(std::pmr::memory_resource* up)
+				: upstream(up) {
+		}
+
+		std::pmr::memory_resource* upstream;
+		std::uint64_t allocations = 0;
+		std::uint64_t bytes = 0;
+
+	private:
+		void* do_allocate(size_t bytes_, size_t alignment) override {
+			++allocations;
+			bytes += bytes_;
+			return upstream->allocate(bytes_, alignment);
+		}
+		void do_deallocate(void* p, size_t bytes_, size_t alignment) override {
+			upstream->deallocate(p, bytes_, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const
+				noexcept override {
+			return this == &other;
+		}
+	};
+
+	clock::time_point _epoch = clock::now();
+	counting_resource _resource;
+
+	std::array<latency_histogram, size_t(parse_phase::count)> _phases;
+	std::vector<std::string> _callback_names;
+	std::vector<latency_histogram> _callbacks;
+
+	// Ring buffer, _trace_next is where the next event goes.
+	std::vector<trace_event> _trace;
+	size_t _trace_capacity = 65536;
+	size_t _trace_next = 0;
+};
+
+namespace detail {
+// Records a phase when destroyed.
+struct phase_timer {
+	phase_timer(instrumentation* instr, parse_phase p,
+			std::uint32_t callback = instrumentation::no_callback)
+			: _instr(instr)
+			, _phase(p)
+			, _callback(callback)
+			, _beg(instrumentation::clock::now()) {
+	}
+	~phase_timer() {
+		_instr->record(_phase, _callback, _beg, instrumentation::clock::now());
+	}
+
+	phase_timer(const phase_timer&) = delete;
+	phase_timer& operator=(const phase_timer&) = delete;
+
+private:
+	instrumentation* _instr;
+	parse_phase _phase;
+	std::uint32_t _callback;
+	instrumentation::clock::time_point _beg;
+};
+
+// What the hooks return when instrumentation is compiled out. The
+// destructor keeps unused timers quiet, it is optimized away.
+struct no_phase_timer {
+	~no_phase_timer() {
+	}
+};
+
+inline size_t bit_width(std::uint64_t v) {
+	size_t ret = 0;
+	while (v != 0) {
+		v >>= 1;
+		++ret;
+	}
+	return ret;
+}
+
+inline void append_json_string(std::string& out, std::string_view str) {
+	out += '"';
+	for (char c : str) {
+		switch (c) {
+		case '"': {
+			out += "\\\"";
+		} break;
+		case '\\': {
+			out += "\\\\";
+		} break;
+		default: {
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char buf[8];
+				std::snprintf(buf, sizeof(buf), "\\u%04x", unsigned(c));
+				out += buf;
+			} else {
+				out += c;
+			}
+		} break;
+		}
+	}
+	out += '"';
+}
+
+// Nanoseconds, as microseconds with 3 decimals.
+inline void append_us(std::string& out, std::int64_t ns) {
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%lld.%03lld", (long long)(ns / 1000),
+			(long long)(ns % 1000));
+	out += buf;
+}
+
+inline void append_histogram_row(std::string& out, std::string_view name,
+		const latency_histogram& h) {
+	char buf[160];
+	std::snprintf(buf, sizeof(buf),
+			"  %-24.*s %10llu %12lld %10lld %10lld %10lld %10lld\n",
+			int(name.size()), name.data(), (unsigned long long)h.count(),
+			(long long)h.total().count(), (long long)h.mean().count(),
+			(long long)h.percentile(50.0).count(),
+			(long long)h.percentile(99.0).count(),
+			(long long)h.max().count());
+	out += buf;
+}
+} // namespace detail
+
+
+inline void latency_histogram::record(duration d) {
+	std::int64_t ns = d.count() < 0 ? 0 : d.count();
+	size_t bucket = detail::bit_width(std::uint64_t(ns));
+	++_buckets[bucket < _buckets.size() ? bucket : _buckets.size() - 1];
+	++_count;
+	_total += ns;
+	_min = ns < _min ? ns : _min;
+	_max = ns > _max ? ns : _max;
+}
+
+inline std::uint64_t latency_histogram::count() const {
+	return _count;
+}
+
+inline auto latency_histogram::total() const -> duration {
+	return duration{ _total };
+}
+
+inline auto latency_histogram::min() const -> duration {
+	return duration{ _count == 0 ? 0 : _min };
+}
+
+inline auto latency_histogram::max() const -> duration {
+	return duration{ _max };
+}
+
+inline auto latency_histogram::mean() const -> duration {
+	return duration{ _count == 0 ? 0 : _total / std::int64_t(_count) };
+}
+
+inline auto latency_histogram::percentile(double p) const -> duration {
+	if (_count == 0) {
+		return duration{ 0 };
+	}
+
+	// The rank of the percentile, at least the first value.
+	double rank = p / 100.0 * double(_count);
+	std::uint64_t target = rank < 1.0 ? 1 : std::uint64_t(rank + 0.5);
+
+	std::uint64_t seen = 0;
+	for (size_t i = 0; i < _buckets.size(); ++i) {
+		seen += _buckets[i];
+		if (seen >= target) {
+			// Bucket i holds values of bit width i.
+			std::int64_t upper = i == 0 ? 0 : std::int64_t((1ull << i) - 1);
+			return duration{ upper < _max ? upper : _max };
+		}
+	}
+	return duration{ _max };
+}
+
+inline void latency_histogram::clear() {
+	*this = latency_histogram{};
+}
+
+
+inline instrumentation::instrumentation(std::pmr::memory_resource* upstream)
+		: _resource(upstream) {
+}
+
+inline const latency_histogram& instrumentation::phase(parse_phase p) const {
+	return _phases[size_t(p)];
+}
+
+inline size_t instrumentation::callback_count() const {
+	return _callbacks.size();
+}
+
+inline std::string_view instrumentation::callback_name(size_t id) const {
+	return _callback_names[id];
+}
+
+inline const latency_histogram& instrumentation::callback(size_t id) const {
+	return _callbacks[id];
+}
+
+inline std::uint64_t instrumentation::allocations() const {
+	return _resource.allocations;
+}
+
+inline std::uint64_t instrumentation::allocated_bytes() const {
+	return _resource.bytes;
+}
+
+inline void instrumentation::trace_capacity(size_t event_count) {
+	_trace_capacity = event_count;
+	_trace.clear();
+	_trace.shrink_to_fit();
+	_trace_next = 0;
+}
+
+inline void instrumentation::reserve_trace() {
+	_trace.reserve(_trace_capacity);
+}
+
+inline std::vector<trace_event> instrumentation::trace_events() const {
+	// Once full, the oldest event is the next to be overwritten.
+	std::vector<trace_event> ret;
+	ret.reserve(_trace.size());
+	ret.insert(ret.end(), _trace.begin() + _trace_next, _trace.end());
+	ret.insert(ret.end(), _trace.begin(), _trace.begin() + _trace_next);
+	return ret;
+}
+
+inline std::string instrumentation::chrome_trace(int pid, int tid) const {
+	std::string ret = "{\"traceEvents\":[";
+
+	bool first = true;
+	for (const trace_event& e : trace_events()) {
+		ret += first ? "\n" : ",\n";
+		first = false;
+
+		ret += "{\"name\":";
+		if (e.callback != no_callback && e.callback < _callback_names.size()) {
+			detail::append_json_string(ret, _callback_names[e.callback]);
+		} else {
+			detail::append_json_string(ret, parse_phase_names[size_t(e.phase)]);
+		}
+		ret += ",\"cat\":";
+		detail::append_json_string(ret, parse_phase_names[size_t(e.phase)]);
+		ret += ",\"ph\":\"X\",\"ts\":";
+		detail::append_us(ret, e.start_ns);
+		ret += ",\"dur\":";
+		detail::append_us(ret, e.duration_ns);
+		ret += ",\"pid\":" + std::to_string(pid);
+		ret += ",\"tid\":" + std::to_string(tid) + "}";
+	}
+
+	ret += "\n],\"displayTimeUnit\":\"ns\"}\n";
+	return ret;
+}
+
+inline std::string instrumentation::report() const {
+	std::string ret;
+	char header[160];
+	std::snprintf(header, sizeof(header),
+			"  %-24s %10s %12s %10s %10s %10s %10s\n", "name", "count",
+			"total ns", "mean ns", "p50 ns", "p99 ns", "max ns");
+
+	ret += "Phases :\n";
+	ret += header;
+	for (size_t i = 0; i < _phases.size(); ++i) {
+		detail::append_histogram_row(ret, parse_phase_names[i], _phases[i]);
+	}
+
+	ret += "Callbacks :\n";
+	ret += header;
+	for (size_t i = 0; i < _callbacks.size(); ++i) {
+		if (_callbacks[i].count() != 0) {
+			detail::append_histogram_row(
+					ret, _callback_names[i], _callbacks[i]);
+		}
+	}
+
+	ret += "Allocations : " + std::to_string(_resource.allocations) + ", "
+			+ std::to_string(_resource.bytes) + " bytes\n";
+	return ret;
+}
+
+inline void instrumentation::clear() {
+	for (latency_histogram& h : _phases) {
+		h.clear();
+	}
+	for (latency_histogram& h : _callbacks) {
+		h.clear();
+	}
+	_resource.allocations = 0;
+	_resource.bytes = 0;
+	_trace.clear();
+	_trace_next = 0;
+}
+
+inline void instrumentation::record(parse_phase p, std::uint32_t callback,
+		clock::time_point beg, clock::time_point end) {
+	clock::duration d = end - beg;
+	_phases[size_t(p)].record(d);
+	if (callback < _callbacks.size()) {
+		_callbacks[callback].record(d);
+	}
+
+	if (_trace_capacity == 0) {
+		return;
+	}
+
+	trace_event e;
+	e.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			beg - _epoch)
+						 .count();
+	e.duration_ns
+			= std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+	e.callback = callback;
+	e.phase = p;
+
+	if (_trace.size() < _trace_capacity) {
+		_trace.push_back(e);
+		_trace_next = _trace.size() == _trace_capacity ? 0 : _trace.size();
+	} else {
+		_trace[_trace_next] = e;
+		_trace_next = _trace_next + 1 == _trace.size() ? 0 : _trace_next + 1;
+	}
+}
+
+inline void instrumentation::name_callbacks(std::vector<std::string>&& names) {
+	_callbacks.assign(names.size(), latency_histogram{});
+	_callback_names = std::move(names);
+}
+
+inline std::pmr::memory_resource* instrumentation::resource() {
+	return &_resource;
+}
+} // namespace fea
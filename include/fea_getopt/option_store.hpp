@@ -0,0 +1,346 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <fea_getopt/compiled_options.hpp>
+#include <fea_getopt/option_values.hpp>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/*
+The option storage of get_opt_spec, split in hot and cold data.
+
+Hot data is what parsing reads : the option type, its flags and its single
+callback slot. It is stored in contiguous arrays, in insertion order.
+Names are interned by the compiled_options index, the index of an option is
+its name id.
+
+Cold data is only read when printing help and errors : descriptions,
+default values and value descriptions. Those strings are interned in a
+single arena, identical strings are stored once.
+*/
+
+namespace fea {
+// The bytes allocated by the option storage, see get_opt_spec.
+// Doesn't include what your callbacks allocate.
+struct option_memory {
+	// Option types, flags and callbacks.
+	size_t hot = 0;
+	// Descriptions, default values and value descriptions.
+	size_t cold = 0;
+	// Interned names and lookup tables.
+	size_t index = 0;
+
+	size_t total() const {
+		return hot + cold + index;
+	}
+};
+
+namespace detail {
+enum class user_option_e : std::uint8_t {
+	flag,
+	// A flag which may repeat.
+	counter,
+	required_arg,
+	optional_arg,
+	default_arg,
+	multi_arg,
+	raw_arg,
+	count,
+};
+
+// Strings, one after the other in a single buffer. Identical strings are
+// interned once and share their id.
+template <class CharT>
+struct string_arena {
+	using string_view = std::basic_string_view<CharT>;
+
+	// The id of the empty string.
+	static constexpr std::uint32_t empty_id = 0;
+
+	// Copies str in the arena, unless it is already there. Returns its id.
+	std::uint32_t intern(string_view str);
+
+	// The interned string. Views are invalidated by intern.
+	string_view get(std::uint32_t id) const;
+
+	// The number of unique strings, including the empty string.
+	size_t size() const;
+
+	void clear();
+
+	size_t memory_usage() const;
+
+private:
+	static constexpr std::uint32_t empty_slot
+			= (std::numeric_limits<std::uint32_t>::max)();
+
+	void rehash(size_t slot_count);
+
+	std::vector<CharT> _chars;
+	// Where each string starts in _chars, plus one past the last string.
+	std::vector<std::uint32_t> _offsets{ 0, 0 };
+	// String ids, power of 2 sized, at most half full.
+	std::vector<std::uint32_t> _slots;
+};
+
+// Callbacks recieve views into argv. Callbacks which were registered with
+// owning strings are wrapped (see to_view_func).
+using flag_func_t = std::function<bool()>;
+template <class CharT>
+using one_arg_func_t = std::function<bool(std::basic_string_view<CharT>)>;
+template <class CharT>
+using multi_arg_func_t = std::function<bool(
+		const std::vector<std::basic_string_view<CharT>>&)>;
+// Typed options parse their value before calling the user.
+template <class CharT>
+using typed_func_t
+		= std::function<value_status(std::basic_string_view<CharT>)>;
+
+// An option only ever has one callback.
+// Multi options which stream their values hold a one_arg_func_t, it is
+// called once per value.
+template <class CharT>
+using option_callback = std::variant<flag_func_t, one_arg_func_t<CharT>,
+		multi_arg_func_t<CharT>, typed_func_t<CharT>>;
+
+// What parsing reads.
+template <class CharT>
+struct option_hot {
+	option_callback<CharT> func;
+	user_option_e opt_type = user_option_e::count;
+	// Bool options only take bool values, other arguments are left to the
+	// next options. ex : '--verbose file.txt'
+	bool is_bool = false;
+};
+
+// What help and errors read. Ids point into the string arena.
+template <class CharT>
+struct option_cold {
+	// Raw options only, long names are interned by the index.
+	std::uint32_t name = 0;
+	std::uint32_t description = 0;
+	std::uint32_t default_val = 0;
+	// Describes the values of typed options, for errors.
+	std::uint32_t value_desc = 0;
+	CharT short_name = CharT('\0');
+};
+
+// An option, as the help printer sees it. Valid until the next add.
+template <class CharT>
+struct option_view {
+	std::basic_string_view<CharT> long_name;
+	CharT short_name = CharT('\0');
+	user_option_e opt_type = user_option_e::count;
+	std::basic_string_view<CharT> default_val;
+	std::basic_string_view<CharT> description;
+};
+
+template <class CharT>
+struct option_store {
+	using string_view = std::basic_string_view<CharT>;
+
+	// Adds an option, returns its index. Throws on duplicate names.
+	size_t add(string_view long_name, CharT short_name,
+			option_hot<CharT>&& hot, string_view description,
+			string_view default_val = {}, string_view value_desc = {});
+
+	// Raw options are parsed in order, they aren't indexed.
+	void add_raw(string_view name, option_hot<CharT>&& hot,
+			string_view description);
+
+	option_view<CharT> view(size_t idx) const;
+	option_view<CharT> raw_view(size_t idx) const;
+
+	option_memory memory_usage() const;
+
+	// Long and short names.
+	compiled_options<CharT> index;
+
+	// Hot, in insertion order.
+	std::vector<option_hot<CharT>> opts;
+	std::vector<option_hot<CharT>> raw_opts;
+
+	// Cold, parallel to the hot arrays.
+	std::vector<option_cold<CharT>> cold;
+	std::vector<option_cold<CharT>> raw_cold;
+	string_arena<CharT> strings;
+};
+
+
+template <class CharT>
+std::uint32_t string_arena<CharT>::intern(string_view str) {
+	if (str.empty()) {
+		return empty_id;
+	}
+
+	if (_slots.size() < size() * 2 + 1) {
+		rehash(next_pow2(size() * 2 + 1));
+	}
+
+	const size_t mask = _slots.size() - 1;
+	size_t pos = size_t(word_hash(str)) & mask;
+	while (_slots[pos] != empty_slot) {
+		if (get(_slots[pos]) == str) {
+			return _slots[pos];
+		}
+		pos = (pos + 1) & mask;
+	}
+
+	if (_chars.size() + str.size() >= empty_slot) {
+		throw std::length_error{ "string_arena::intern : Too many strings." };
+	}
+
+	std::uint32_t ret = std::uint32_t(size());
+	_chars.insert(_chars.end(), str.begin(), str.end());
+	_offsets.push_back(std::uint32_t(_chars.size()));
+	_slots[pos] = ret;
+	return ret;
+}
+
+template <class CharT>
+auto string_arena<CharT>::get(std::uint32_t id) const -> string_view {
+	assert(id < size());
+	std::uint32_t beg = _offsets[id];
+	return string_view{ _chars.data() + beg, _offsets[id + 1] - beg };
+}
+
+template <class CharT>
+size_t string_arena<CharT>::size() const {
+	return _offsets.size() - 1;
+}
+
+template <class CharT>
+void string_arena<CharT>::clear() {
+	_chars.clear();
+	_offsets.assign(2, 0);
+	_slots.clear();
+}
+
+template <class CharT>
+size_t string_arena<CharT>::memory_usage() const {
+	return _chars.capacity() * sizeof(CharT)
+			+ (_offsets.capacity() + _slots.capacity())
+			* sizeof(std::uint32_t);
+}
+
+template <class CharT>
+void string_arena<CharT>::rehash(size_t slot_count) {
+	_slots.assign(slot_count, empty_slot);
+	const size_t mask = _slots.size() - 1;
+
+	// The empty string is never looked up.
+	for (std::uint32_t id = 1; id < size(); ++id) {
+		size_t pos = size_t(word_hash(get(id))) & mask;
+		while (_slots[pos] != empty_slot) {
+			pos = (pos + 1) & mask;
+		}
+		_slots[pos] = id;
+	}
+}
+
+
+template <class CharT>
+size_t option_store<CharT>::add(string_view long_name, CharT short_name,
+		option_hot<CharT>&& hot, string_view description,
+		string_view default_val, string_view value_desc) {
+	size_t ret = index.insert(long_name, short_name);
+
+	option_cold<CharT> c;
+	c.description = strings.intern(description);
+	c.default_val = strings.intern(default_val);
+	c.value_desc = strings.intern(value_desc);
+	c.short_name = short_name;
+
+	opts.push_back(std::move(hot));
+	cold.push_back(c);
+	return ret;
+}
+
+template <class CharT>
+void option_store<CharT>::add_raw(
+		string_view name, option_hot<CharT>&& hot, string_view description) {
+	option_cold<CharT> c;
+	c.name = strings.intern(name);
+	c.description = strings.intern(description);
+
+	raw_opts.push_back(std::move(hot));
+	raw_cold.push_back(c);
+}
+
+template <class CharT>
+option_view<CharT> option_store<CharT>::view(size_t idx) const {
+	const option_cold<CharT>& c = cold[idx];
+	return option_view<CharT>{
+		index.long_name(idx),
+		c.short_name,
+		opts[idx].opt_type,
+		strings.get(c.default_val),
+		strings.get(c.description),
+	};
+}
+
+template <class CharT>
+option_view<CharT> option_store<CharT>::raw_view(size_t idx) const {
+	const option_cold<CharT>& c = raw_cold[idx];
+	return option_view<CharT>{
+		strings.get(c.name),
+		CharT('\0'),
+		raw_opts[idx].opt_type,
+		{},
+		strings.get(c.description),
+	};
+}
+
+template <class CharT>
+option_memory option_store<CharT>::memory_usage() const {
+	option_memory ret;
+	ret.hot = (opts.capacity() + raw_opts.capacity())
+			* sizeof(option_hot<CharT>);
+	ret.cold = (cold.capacity() + raw_cold.capacity())
+					* sizeof(option_cold<CharT>)
+			+ strings.memory_usage();
+	ret.index = index.memory_usage();
+	return ret;
+}
+} // namespace detail
+} // namespace fea
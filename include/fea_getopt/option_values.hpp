@@ -0,0 +1,398 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fea_utils/platform.hpp>
+#include <limits>
+#include <numeric>
+#include <ratio>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#if !defined(__cpp_lib_to_chars)
+#include <locale.h>
+#include <stdlib.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#endif
+
+/*
+Values of typed options are parsed straight from the argument views, with
+std::from_chars. They never allocate, and don't depend on the locale.
+Standard libraries without floating point from_chars (libstdc++ before 11)
+parse floating points with strtod_l, in the "C" locale.
+
+Supported types :
+- Integers, with range checks. ex : '8', '-3', '+12'
+- Floating points. ex : '0.5', '1e-3'
+- bool. 'true', 'false', '1', '0', 'yes', 'no', 'on' and 'off'
+- fea::byte_size. A count of bytes with an optional 'K', 'M', 'G' or 'T'
+  suffix, in powers of 1024. The suffix can be followed by 'B' or 'iB'.
+  ex : '4G', '512KiB', '100B'
+- std::chrono::duration. A count with an optional 'ns', 'us', 'ms', 's',
+  'min' or 'h' suffix. Counts without suffix are in the duration's unit.
+  Integer durations reject values they can't represent exactly.
+  ex : '250ms', '2h'
+*/
+
+namespace fea {
+// A count of bytes, for typed options. ex : '--buffer 4G'
+struct byte_size {
+	std::uint64_t bytes = 0;
+};
+
+namespace detail {
+enum class value_status : std::uint8_t {
+	ok,
+	invalid,
+	out_of_range,
+	// The value was fine, the user callback returned false.
+	rejected,
+	count,
+};
+
+template <class>
+struct is_duration : std::false_type {};
+template <class Rep, class Period>
+struct is_duration<std::chrono::duration<Rep, Period>> : std::true_type {};
+
+template <class T>
+inline constexpr bool is_typed_value_v = std::is_arithmetic_v<T>
+		|| std::is_same_v<T, byte_size> || is_duration<T>::value;
+
+// Values longer than this aren't numbers.
+inline constexpr size_t max_value_size = 128;
+
+// from_chars only reads char, other char types are narrowed into buf.
+// Returns false if the value can't be a number.
+template <class CharT>
+bool to_ascii(std::basic_string_view<CharT> in,
+		std::array<char, max_value_size>& buf, std::string_view& out) {
+	if constexpr (std::is_same_v<CharT, char>) {
+		out = in;
+		return true;
+	} else {
+		if (in.size() > buf.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < in.size(); ++i) {
+			if (in[i] < CharT(0) || in[i] > CharT(127)) {
+				return false;
+			}
+			buf[i] = char(in[i]);
+		}
+		out = std::string_view{ buf.data(), in.size() };
+		return true;
+	}
+}
+
+// Floating point from_chars, or strtod_l when the library lacks it.
+template <class T>
+std::from_chars_result float_from_chars(
+		const char* first, const char* last, T& out) {
+#if defined(__cpp_lib_to_chars)
+	return std::from_chars(first, last, out);
+#else
+	// strtod needs a null terminated string. It also skips spaces, reads
+	// '+' and hex, from_chars doesn't.
+	size_t size = size_t(last - first);
+	std::string_view s{ first, size };
+	if (size == 0 || size >= max_value_size || s.front() == '+'
+			|| s.find_first_of(" \t\n\v\f\rxX") != std::string_view::npos) {
+		return { first, std::errc::invalid_argument };
+	}
+	std::array<char, max_value_size> buf;
+	std::memcpy(buf.data(), first, size);
+	buf[size] = '\0';
+
+	// strtod follows the global locale, which may use ',' as decimal point.
+	// Created once, never freed.
+#if defined(FEA_WINDOWS)
+	static const _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+#else
+	static const locale_t c_locale
+			= newlocale(LC_NUMERIC_MASK, "C", locale_t(0));
+#endif
+
+	char* end = nullptr;
+	errno = 0;
+#if defined(FEA_WINDOWS)
+	if constexpr (std::is_same_v<T, float>) {
+		out = _strtof_l(buf.data(), &end, c_locale);
+	} else if constexpr (std::is_same_v<T, double>) {
+		out = _strtod_l(buf.data(), &end, c_locale);
+	} else {
+		out = _strtold_l(buf.data(), &end, c_locale);
+	}
+#else
+	if constexpr (std::is_same_v<T, float>) {
+		out = strtof_l(buf.data(), &end, c_locale);
+	} else if constexpr (std::is_same_v<T, double>) {
+		out = strtod_l(buf.data(), &end, c_locale);
+	} else {
+		out = strtold_l(buf.data(), &end, c_locale);
+	}
+#endif
+
+	if (end == buf.data()) {
+		return { first, std::errc::invalid_argument };
+	}
+	const char* ptr = first + (end - buf.data());
+	if (errno == ERANGE) {
+		return { ptr, std::errc::result_out_of_range };
+	}
+	return { ptr, std::errc{} };
+#endif
+}
+
+// Parses a whole number, the number may not end the string.
+// Returns the first unparsed character in end.
+template <class T>
+value_status parse_number(std::string_view s, T& out, const char*& end) {
+	// from_chars doesn't accept '+'.
+	if (s.size() > 1 && s.front() == '+' && s[1] != '-') {
+		s.remove_prefix(1);
+	}
+
+	const char* first = s.data();
+	const char* last = s.data() + s.size();
+	std::from_chars_result res;
+	if constexpr (std::is_floating_point_v<T>) {
+		res = float_from_chars(first, last, out);
+	} else {
+		res = std::from_chars(first, last, out, 10);
+	}
+
+	if (res.ec == std::errc::result_out_of_range) {
+		return value_status::out_of_range;
+	}
+	if (res.ec != std::errc{}) {
+		return value_status::invalid;
+	}
+
+	end = res.ptr;
+	return value_status::ok;
+}
+
+template <class T>
+value_status parse_number(std::string_view s, T& out) {
+	const char* end = nullptr;
+	value_status ret = parse_number(s, out, end);
+	if (ret != value_status::ok) {
+		return ret;
+	}
+	return end == s.data() + s.size() ? value_status::ok
+									  : value_status::invalid;
+}
+
+inline value_status parse_bool(std::string_view s, bool& out) {
+	using namespace std::string_view_literals;
+	if (s == "true"sv || s == "1"sv || s == "yes"sv || s == "on"sv) {
+		out = true;
+		return value_status::ok;
+	}
+	if (s == "false"sv || s == "0"sv || s == "no"sv || s == "off"sv) {
+		out = false;
+		return value_status::ok;
+	}
+	return value_status::invalid;
+}
+
+inline value_status parse_byte_size(std::string_view s, byte_size& out) {
+	std::uint64_t count = 0;
+	const char* end = nullptr;
+	value_status ret = parse_number(s, count, end);
+	if (ret != value_status::ok) {
+		return ret;
+	}
+
+	std::string_view suffix{ end, size_t(s.data() + s.size() - end) };
+	unsigned shift = 0;
+	if (!suffix.empty()) {
+		switch (suffix.front()) {
+		case 'k':
+		case 'K': {
+			shift = 10;
+		} break;
+		case 'm':
+		case 'M': {
+			shift = 20;
+		} break;
+		case 'g':
+		case 'G': {
+			shift = 30;
+		} break;
+		case 't':
+		case 'T': {
+			shift = 40;
+		} break;
+		default: {
+		} break;
+		}
+	}
+
+	if (shift != 0) {
+		suffix.remove_prefix(1);
+		if (!suffix.empty() && suffix.front() == 'i') {
+			suffix.remove_prefix(1);
+		}
+	}
+	if (!suffix.empty() && (suffix.front() == 'B' || suffix.front() == 'b')) {
+		suffix.remove_prefix(1);
+	}
+	if (!suffix.empty()) {
+		return value_status::invalid;
+	}
+
+	if (count > (std::numeric_limits<std::uint64_t>::max() >> shift)) {
+		return value_status::out_of_range;
+	}
+	out.bytes = count << shift;
+	return value_status::ok;
+}
+
+template <class Rep, class Period>
+value_status parse_duration(
+		std::string_view s, std::chrono::duration<Rep, Period>& out) {
+	Rep count = 0;
+	const char* end = nullptr;
+	value_status ret = parse_number(s, count, end);
+	if (ret != value_status::ok) {
+		return ret;
+	}
+
+	// The suffix, in seconds.
+	std::string_view suffix{ end, size_t(s.data() + s.size() - end) };
+	std::intmax_t num = Period::num;
+	std::intmax_t den = Period::den;
+	if (suffix == "ns") {
+		num = 1;
+		den = 1'000'000'000;
+	} else if (suffix == "us") {
+		num = 1;
+		den = 1'000'000;
+	} else if (suffix == "ms") {
+		num = 1;
+		den = 1'000;
+	} else if (suffix == "s") {
+		num = 1;
+		den = 1;
+	} else if (suffix == "min") {
+		num = 60;
+		den = 1;
+	} else if (suffix == "h") {
+		num = 3'600;
+		den = 1;
+	} else if (!suffix.empty()) {
+		return value_status::invalid;
+	}
+
+	// ticks = count * (num / den) / (Period::num / Period::den)
+	std::intmax_t mul = num * Period::den;
+	std::intmax_t div = den * Period::num;
+	std::intmax_t g = std::gcd(mul, div);
+	mul /= g;
+	div /= g;
+
+	if constexpr (std::is_floating_point_v<Rep>) {
+		out = std::chrono::duration<Rep, Period>{ count * Rep(mul)
+			/ Rep(div) };
+	} else {
+		// Integer durations can't hold fractions of their unit.
+		if (count % Rep(div) != 0) {
+			return value_status::invalid;
+		}
+		count /= Rep(div);
+
+		if (count > std::numeric_limits<Rep>::max() / Rep(mul)
+				|| count < std::numeric_limits<Rep>::min() / Rep(mul)) {
+			return value_status::out_of_range;
+		}
+		out = std::chrono::duration<Rep, Period>{ count * Rep(mul) };
+	}
+	return value_status::ok;
+}
+
+// Parses a typed value, see the supported types above.
+template <class T, class CharT>
+value_status parse_value(std::basic_string_view<CharT> str, T& out) {
+	static_assert(is_typed_value_v<T>, "getopt : unsupported value type");
+
+	std::array<char, max_value_size> buf;
+	std::string_view s;
+	if (!to_ascii(str, buf, s)) {
+		return value_status::invalid;
+	}
+
+	if constexpr (std::is_same_v<T, bool>) {
+		return parse_bool(s, out);
+	} else if constexpr (std::is_arithmetic_v<T>) {
+		return parse_number(s, out);
+	} else if constexpr (std::is_same_v<T, byte_size>) {
+		return parse_byte_size(s, out);
+	} else {
+		return parse_duration(s, out);
+	}
+}
+
+// Describes the expected values, for errors.
+template <class T>
+std::string describe_value() {
+	if constexpr (std::is_same_v<T, bool>) {
+		return "true or false";
+	} else if constexpr (std::is_floating_point_v<T>) {
+		return "a number";
+	} else if constexpr (std::is_arithmetic_v<T>) {
+		return "an integer between "
+				+ std::to_string(std::numeric_limits<T>::min()) + " and "
+				+ std::to_string(std::numeric_limits<T>::max());
+	} else if constexpr (std::is_same_v<T, byte_size>) {
+		return "a size, ex '4G' or '512KiB'";
+	} else {
+		return "a duration, ex '250ms' or '2h'";
+	}
+}
+} // namespace detail
+} // namespace fea
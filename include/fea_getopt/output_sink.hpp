@@ -0,0 +1,262 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cwchar>
+#include <fea_utils/platform.hpp>
+#include <fea_utils/string.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(FEA_WINDOWS)
+#include <io.h>
+#else
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/*
+Output sinks recieve the whole output of a parse at once, as a list of
+string pieces. Pieces point into the parser's buffers and into the cached
+help, they aren't joined before writing.
+
+Use a sink as get_opt's print function. Any type with this member works :
+void write(const std::basic_string_view<CharT>* pieces, size_t count) const;
+It may return a status, which get_opt ignores. fd_sink returns false when
+the output couldn't be written.
+
+Sinks of a spec which is shared between threads are called from all those
+threads. Each call writes the complete output of one parse.
+
+ex :
+fea::get_opt<char, fea::fd_sink<char>> opt{ fea::fd_sink<char>{ 2 } };
+*/
+
+namespace fea {
+namespace detail {
+template <class T, class CharT, class = void>
+struct is_output_sink : std::false_type {};
+template <class T, class CharT>
+struct is_output_sink<T, CharT,
+		std::void_t<decltype(std::declval<const T&>().write(
+				std::declval<const std::basic_string_view<CharT>*>(),
+				size_t{}))>> : std::true_type {};
+
+template <class T, class CharT>
+inline constexpr bool is_output_sink_v = is_output_sink<T, CharT>::value;
+
+// Transcodes the pieces to utf8, appended to out.
+template <class CharT>
+void append_utf8(const std::basic_string_view<CharT>* pieces, size_t count,
+		std::string& out) {
+	for (size_t i = 0; i < count; ++i) {
+		if constexpr (std::is_same_v<CharT, char>) {
+			out += pieces[i];
+		} else if constexpr (std::is_same_v<CharT, char32_t>) {
+			out += utf32_to_utf8(std::u32string{ pieces[i] });
+		} else {
+			out += utf32_to_utf8(
+					any_to_utf32(std::basic_string<CharT>{ pieces[i] }));
+		}
+	}
+}
+
+// Writes everything, retries on partial writes and interruptions.
+// Returns false on errors, or if the descriptor stops accepting bytes.
+inline bool write_all(int fd, const std::string_view* pieces, size_t count) {
+#if defined(FEA_WINDOWS)
+	for (size_t i = 0; i < count; ++i) {
+		std::string_view p = pieces[i];
+		while (!p.empty()) {
+			int written = _write(fd, p.data(), unsigned(p.size()));
+			if (written <= 0) {
+				return false;
+			}
+			p.remove_prefix(size_t(written));
+		}
+	}
+	return true;
+#else
+	// Pieces are written with as few writev calls as possible.
+#if defined(IOV_MAX)
+	constexpr size_t max_iov = IOV_MAX < 64 ? IOV_MAX : 64;
+#else
+	// The POSIX minimum.
+	constexpr size_t max_iov = 16;
+#endif
+	std::array<iovec, max_iov> iov;
+
+	size_t first = 0;
+	size_t offset = 0;
+	while (first < count) {
+		// Empty pieces aren't sent, a write of 0 bytes is a failure.
+		size_t iov_count = 0;
+		for (size_t i = first; i < count && iov_count < max_iov; ++i) {
+			size_t skip = i == first ? offset : 0;
+			if (pieces[i].size() == skip) {
+				continue;
+			}
+			iov[iov_count].iov_base
+					= const_cast<char*>(pieces[i].data() + skip);
+			iov[iov_count].iov_len = pieces[i].size() - skip;
+			++iov_count;
+		}
+		if (iov_count == 0) {
+			return true;
+		}
+
+		ssize_t written = ::writev(fd, iov.data(), int(iov_count));
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+
+		// Skip what was written, which may end in the middle of a piece.
+		size_t left = size_t(written);
+		while (first < count && left >= pieces[first].size() - offset) {
+			left -= pieces[first].size() - offset;
+			offset = 0;
+			++first;
+		}
+		offset += left;
+	}
+	return true;
+#endif
+}
+} // namespace detail
+
+// Writes to a FILE*, stdout by default. The file is locked while writing,
+// outputs of concurrent parses don't interleave.
+// char16_t and char32_t are written as utf8. wchar_t uses wide output.
+template <class CharT = char>
+struct file_sink {
+	explicit file_sink(FILE* file = stdout)
+			: _file(file) {
+	}
+
+	void write(const std::basic_string_view<CharT>* pieces,
+			size_t count) const {
+		std::string utf8;
+		if constexpr (std::is_same_v<CharT, char16_t>
+				|| std::is_same_v<CharT, char32_t>) {
+			detail::append_utf8(pieces, count, utf8);
+		}
+
+#if defined(FEA_WINDOWS)
+		_lock_file(_file);
+#else
+		flockfile(_file);
+#endif
+
+		if constexpr (std::is_same_v<CharT, char>) {
+			for (size_t i = 0; i < count; ++i) {
+				fwrite(pieces[i].data(), 1, pieces[i].size(), _file);
+			}
+		} else if constexpr (std::is_same_v<CharT, wchar_t>) {
+			for (size_t i = 0; i < count; ++i) {
+				fwprintf(_file, L"%.*ls", int(pieces[i].size()),
+						pieces[i].data());
+			}
+		} else {
+			fwrite(utf8.data(), 1, utf8.size(), _file);
+		}
+		fflush(_file);
+
+#if defined(FEA_WINDOWS)
+		_unlock_file(_file);
+#else
+		funlockfile(_file);
+#endif
+	}
+
+private:
+	FILE* _file;
+};
+
+// Writes to a file descriptor, with writev when available. Every call is
+// one write when the pipe or file accepts it, so outputs of concurrent
+// parses don't interleave.
+// Other character types than char are written as utf8.
+template <class CharT = char>
+struct fd_sink {
+	explicit fd_sink(int fd)
+			: _fd(fd) {
+	}
+
+	// Returns false if the descriptor failed or stopped accepting bytes,
+	// the output may be partially written.
+	bool write(const std::basic_string_view<CharT>* pieces,
+			size_t count) const {
+		if constexpr (std::is_same_v<CharT, char>) {
+			return detail::write_all(_fd, pieces, count);
+		} else {
+			std::string utf8;
+			detail::append_utf8(pieces, count, utf8);
+			std::string_view view = utf8;
+			return detail::write_all(_fd, &view, 1);
+		}
+	}
+
+private:
+	int _fd;
+};
+
+// Appends to a string. Not thread-safe, use one string per thread.
+template <class CharT = char>
+struct string_sink {
+	explicit string_sink(std::basic_string<CharT>& out)
+			: _out(&out) {
+	}
+
+	void write(const std::basic_string_view<CharT>* pieces,
+			size_t count) const {
+		for (size_t i = 0; i < count; ++i) {
+			*_out += pieces[i];
+		}
+	}
+
+private:
+	std::basic_string<CharT>* _out;
+};
+} // namespace fea
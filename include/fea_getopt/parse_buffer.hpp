@@ -0,0 +1,81 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+/*
+Fixed capacity storage for the parse state of a get_opt_context, for code
+which mustn't allocate, like fork/exec helpers and crash handlers.
+
+The buffer has no upstream, std::bad_alloc is thrown if it is too small.
+Call heap_free on the context once options are added, the parse state is
+reserved then and parses allocate nothing afterwards.
+
+ex :
+static fea::parse_buffer<4096> buffer;
+static fea::get_opt_context<char> ctx{ spec, buffer.resource() };
+ctx.heap_free();
+// Later, in the crash handler.
+ctx.parse_options(argc, argv);
+*/
+
+namespace fea {
+template <size_t Bytes>
+struct parse_buffer {
+	parse_buffer() = default;
+
+	// Contexts point to the buffer.
+	parse_buffer(const parse_buffer&) = delete;
+	parse_buffer& operator=(const parse_buffer&) = delete;
+
+	// Pass this to the context.
+	std::pmr::memory_resource* resource() {
+		return &_resource;
+	}
+
+	// Frees everything, the contexts which use the buffer mustn't be used
+	// afterwards.
+	void release() {
+		_resource.release();
+	}
+
+private:
+	alignas(std::max_align_t) std::byte _storage[Bytes];
+	std::pmr::monotonic_buffer_resource _resource{ _storage, Bytes,
+		std::pmr::null_memory_resource() };
+};
+} // namespace fea
@@ -0,0 +1,235 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fea_getopt/compiled_options.hpp>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+prefix_trie finds the long options which start with a prefix, for GNU style
+abbreviations. ex : '--verb' for '--verbose'
+
+It is built once from a compiled_options. Options are sorted by name, and
+every trie node is the range of sorted options which share its prefix.
+Children are stored next to each other, sorted by character. Branches stop
+once a single option is left, the rest of its name is compared directly.
+Looking up a prefix costs its length, whatever the number of options.
+
+The trie doesn't own the names, lookups take the index it was built from.
+Adding options requires a new build.
+
+ex :
+fea::detail::prefix_trie<char> trie;
+trie.build(index);
+
+auto r = trie.find(index, "verb");
+if (r.size() == 1) {
+	size_t opt_idx = trie.option(r.first);
+}
+*/
+
+namespace fea {
+namespace detail {
+template <class CharT>
+struct prefix_trie {
+	using string_view = std::basic_string_view<CharT>;
+
+	// Positions in the options sorted by name, [first, last).
+	struct range {
+		size_t first = 0;
+		size_t last = 0;
+
+		size_t size() const {
+			return last - first;
+		}
+	};
+
+	void build(const compiled_options<CharT>& index);
+
+	// The options which start with prefix. An empty prefix matches nothing.
+	range find(const compiled_options<CharT>& index, string_view prefix) const;
+
+	// The option index at a sorted position.
+	size_t option(size_t pos) const;
+
+	size_t memory_usage() const;
+
+	void clear();
+
+private:
+	struct node {
+		std::uint32_t first_child = 0;
+		std::uint32_t child_count = 0;
+		// The sorted options under this node.
+		std::uint32_t first = 0;
+		std::uint32_t last = 0;
+		CharT ch = CharT('\0');
+	};
+
+	void build_children(const compiled_options<CharT>& index,
+			size_t node_idx, size_t depth);
+
+	std::vector<node> _nodes;
+	std::vector<std::uint32_t> _sorted;
+};
+
+template <class CharT>
+void prefix_trie<CharT>::build(const compiled_options<CharT>& index) {
+	clear();
+	if (index.size() == 0) {
+		return;
+	}
+
+	// Options without a long name can't be abbreviated.
+	for (size_t i = 0; i < index.size(); ++i) {
+		if (!index.long_name(i).empty()) {
+			_sorted.push_back(std::uint32_t(i));
+		}
+	}
+	if (_sorted.empty()) {
+		return;
+	}
+
+	std::sort(_sorted.begin(), _sorted.end(),
+			[&](std::uint32_t lhs, std::uint32_t rhs) {
+				return index.long_name(lhs) < index.long_name(rhs);
+			});
+
+	node root;
+	root.last = std::uint32_t(_sorted.size());
+	_nodes.push_back(root);
+	build_children(index, 0, 0);
+}
+
+template <class CharT>
+void prefix_trie<CharT>::build_children(
+		const compiled_options<CharT>& index, size_t node_idx, size_t depth) {
+	size_t first = _nodes[node_idx].first;
+	size_t last = _nodes[node_idx].last;
+	if (last - first <= 1) {
+		return;
+	}
+
+	// A name which ends here sorts first, it has no child.
+	size_t i = first;
+	if (index.long_name(_sorted[i]).size() == depth) {
+		++i;
+	}
+
+	// Names are sorted, each child is a run of the same character.
+	size_t first_child = _nodes.size();
+	while (i < last) {
+		node child;
+		child.ch = index.long_name(_sorted[i])[depth];
+		child.first = std::uint32_t(i);
+		while (i < last && index.long_name(_sorted[i])[depth] == child.ch) {
+			++i;
+		}
+		child.last = std::uint32_t(i);
+		_nodes.push_back(child);
+	}
+
+	size_t child_count = _nodes.size() - first_child;
+	_nodes[node_idx].first_child = std::uint32_t(first_child);
+	_nodes[node_idx].child_count = std::uint32_t(child_count);
+
+	for (size_t c = first_child; c < first_child + child_count; ++c) {
+		build_children(index, c, depth + 1);
+	}
+}
+
+template <class CharT>
+auto prefix_trie<CharT>::find(const compiled_options<CharT>& index,
+		string_view prefix) const -> range {
+	if (_nodes.empty() || prefix.empty()) {
+		return {};
+	}
+
+	const node* n = &_nodes[0];
+	for (size_t depth = 0;; ++depth) {
+		if (n->last - n->first == 1) {
+			// A single option left, compare the rest of its name.
+			string_view name = index.long_name(_sorted[n->first]);
+			if (name.size() >= prefix.size()
+					&& name.compare(depth, prefix.size() - depth,
+							   prefix.substr(depth))
+							== 0) {
+				return { n->first, n->last };
+			}
+			return {};
+		}
+
+		if (depth == prefix.size()) {
+			return { n->first, n->last };
+		}
+
+		// Same order as the sorted names.
+		const node* beg = _nodes.data() + n->first_child;
+		const node* end = beg + n->child_count;
+		CharT c = prefix[depth];
+		const node* child = std::lower_bound(
+				beg, end, c, [](const node& lhs, CharT rhs) {
+					return std::char_traits<CharT>::lt(lhs.ch, rhs);
+				});
+		if (child == end || child->ch != c) {
+			return {};
+		}
+		n = child;
+	}
+}
+
+template <class CharT>
+size_t prefix_trie<CharT>::option(size_t pos) const {
+	return _sorted[pos];
+}
+
+template <class CharT>
+size_t prefix_trie<CharT>::memory_usage() const {
+	return _nodes.capacity() * sizeof(node)
+			+ _sorted.capacity() * sizeof(std::uint32_t);
+}
+
+template <class CharT>
+void prefix_trie<CharT>::clear() {
+	_nodes.clear();
+	_sorted.clear();
+}
+} // namespace detail
+} // namespace fea
@@ -0,0 +1,130 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#pragma once
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_getopt/response_file.hpp>
+#include <istream>
+#include <string>
+#include <string_view>
+
+/*
+repl_driver parses command lines with one get_opt, for consoles and
+interpreters. The get_opt and its buffers are reused for every line.
+
+Lines are split like response files : arguments are separated by
+whitespace, and quotes group arguments which contain spaces. Every command
+line recieves the same arg0.
+
+ex :
+fea::get_opt<char> opt;
+fea::repl_driver<char> repl{ opt, "console" };
+opt.add_flag_option("quit", [&]() { repl.stop(); return true; }, "Quit.");
+repl.run(std::cin);
+*/
+
+namespace fea {
+template <class CharT = char,
+		class PrintfT = decltype(detail::get_print<CharT>())>
+struct repl_driver {
+	using string = std::basic_string<CharT>;
+	using string_view = std::basic_string_view<CharT>;
+
+	repl_driver(get_opt<CharT, PrintfT>& opt, string_view arg0)
+			: _opt(opt)
+			, _arg0(arg0) {
+	}
+
+	// Parses one command line, returns success.
+	// Empty lines do nothing and succeed.
+	bool parse_line(string_view line) {
+		detail::response_tokenizer<CharT> tokens{ line };
+
+		string_view tok;
+		if (!tokens.next(tok)) {
+			return true;
+		}
+
+		// Once a token fails, finish reports the error.
+		if (_opt.feed(_arg0)) {
+			do {
+				if (!_opt.feed(tok)) {
+					break;
+				}
+			} while (tokens.next(tok));
+		}
+
+		bool ret = _opt.finish();
+		++_line_count;
+		if (!ret) {
+			++_error_count;
+		}
+		return ret;
+	}
+
+	// Parses lines until the end of the stream, or until stop is called.
+	void run(std::basic_istream<CharT>& is) {
+		_stop = false;
+		while (!_stop && std::getline(is, _line)) {
+			parse_line(_line);
+		}
+	}
+
+	// Call from a callback to stop running after the current line.
+	void stop() {
+		_stop = true;
+	}
+
+	// Parsed command lines, without empty lines.
+	size_t line_count() const {
+		return _line_count;
+	}
+
+	// Command lines which failed.
+	size_t error_count() const {
+		return _error_count;
+	}
+
+private:
+	get_opt<CharT, PrintfT>& _opt;
+	string _arg0;
+
+	// Reused between lines.
+	string _line;
+
+	size_t _line_count = 0;
+	size_t _error_count = 0;
+	bool _stop = false;
+};
+} // namespace fea
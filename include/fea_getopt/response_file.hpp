@@ -0,0 +1,315 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <fea_utils/platform.hpp>
+#include <fea_utils/string.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(FEA_WINDOWS)
+// Keep windows.h from leaking min/max macros and unused APIs into user code.
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#define FEA_GETOPT_UNDEF_LEAN_AND_MEAN
+#endif
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#define FEA_GETOPT_UNDEF_NOMINMAX
+#endif
+#include <windows.h>
+#if defined(FEA_GETOPT_UNDEF_LEAN_AND_MEAN)
+#undef WIN32_LEAN_AND_MEAN
+#undef FEA_GETOPT_UNDEF_LEAN_AND_MEAN
+#endif
+#if defined(FEA_GETOPT_UNDEF_NOMINMAX)
+#undef NOMINMAX
+#undef FEA_GETOPT_UNDEF_NOMINMAX
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+Response files hold arguments, separated by whitespace. Newlines can be LF
+or CRLF. Arguments which contain whitespace can be enclosed in double or
+single quotes. There are no escape sequences.
+
+ex : 'my_tool @args.txt', where args.txt contains
+--flag
+--required "a value"
+raw_arg.txt
+
+The files are memory mapped and tokenized as they are parsed. Files are
+expected to be utf-8, they are transcoded when parsing with other character
+types.
+*/
+
+namespace fea {
+namespace detail {
+// A read-only memory mapped file.
+struct mapped_file {
+	mapped_file() = default;
+	~mapped_file() {
+		close();
+	}
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+	mapped_file(mapped_file&& other) noexcept
+			: _data(std::exchange(other._data, nullptr))
+			, _size(std::exchange(other._size, 0)) {
+	}
+	mapped_file& operator=(mapped_file&& other) noexcept {
+		if (this != &other) {
+			close();
+			_data = std::exchange(other._data, nullptr);
+			_size = std::exchange(other._size, 0);
+		}
+		return *this;
+	}
+
+	// Returns false if the file couldn't be opened or mapped.
+	// Empty files are valid and have no data.
+	bool open(const std::filesystem::path& path) {
+		close();
+
+#if defined(FEA_WINDOWS)
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ,
+				FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size)) {
+			CloseHandle(file);
+			return false;
+		}
+
+		if (file_size.QuadPart == 0) {
+			CloseHandle(file);
+			return true;
+		}
+
+		HANDLE mapping = CreateFileMappingW(
+				file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr) {
+			return false;
+		}
+
+		// The view keeps the mapping alive.
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (data == nullptr) {
+			return false;
+		}
+
+		_data = static_cast<const char*>(data);
+		_size = size_t(file_size.QuadPart);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+			::close(fd);
+			return false;
+		}
+
+		if (file_stat.st_size == 0) {
+			::close(fd);
+			return true;
+		}
+
+		// The mapping keeps the file alive.
+		size_t file_size = size_t(file_stat.st_size);
+		void* data = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (data == MAP_FAILED) {
+			return false;
+		}
+		madvise(data, file_size, MADV_SEQUENTIAL);
+
+		_data = static_cast<const char*>(data);
+		_size = file_size;
+#endif
+		return true;
+	}
+
+	void close() {
+		if (_data == nullptr) {
+			return;
+		}
+
+#if defined(FEA_WINDOWS)
+		UnmapViewOfFile(_data);
+#else
+		munmap(const_cast<char*>(_data), _size);
+#endif
+		_data = nullptr;
+		_size = 0;
+	}
+
+	const char* data() const {
+		return _data;
+	}
+	size_t size() const {
+		return _size;
+	}
+
+private:
+	const char* _data = nullptr;
+	size_t _size = 0;
+};
+
+// Splits response file text into arguments, one at a time.
+// The arguments are views into the text.
+template <class CharT>
+struct response_tokenizer {
+	using string_view = std::basic_string_view<CharT>;
+
+	response_tokenizer() = default;
+	explicit response_tokenizer(string_view text)
+			: _text(text) {
+		// Skip the byte order mark.
+		if constexpr (sizeof(CharT) == 1) {
+			if (_text.size() >= 3 && _text[0] == CharT('\xef')
+					&& _text[1] == CharT('\xbb') && _text[2] == CharT('\xbf')) {
+				_text.remove_prefix(3);
+			}
+		} else {
+			if (!_text.empty() && _text[0] == CharT(0xfeff)) {
+				_text.remove_prefix(1);
+			}
+		}
+	}
+
+	// Returns false once all arguments have been read.
+	bool next(string_view& out) {
+		while (_pos < _text.size() && is_whitespace(_text[_pos])) {
+			++_pos;
+		}
+
+		if (_pos >= _text.size()) {
+			return false;
+		}
+
+		CharT c = _text[_pos];
+		if (c == CharT('"') || c == CharT('\'')) {
+			// Everything up to the closing quote, or the end of the text.
+			size_t beg = _pos + 1;
+			size_t end = _text.find(c, beg);
+			if (end == string_view::npos) {
+				end = _text.size();
+				_pos = end;
+			} else {
+				_pos = end + 1;
+			}
+			out = _text.substr(beg, end - beg);
+			return true;
+		}
+
+		size_t beg = _pos;
+		while (_pos < _text.size() && !is_whitespace(_text[_pos])) {
+			++_pos;
+		}
+		out = _text.substr(beg, _pos - beg);
+		return true;
+	}
+
+private:
+	static constexpr bool is_whitespace(CharT c) {
+		return c == CharT(' ') || c == CharT('\n') || c == CharT('\r')
+				|| c == CharT('\t') || c == CharT('\v') || c == CharT('\f');
+	}
+
+	string_view _text;
+	size_t _pos = 0;
+};
+
+// An expanded response file, with its current argument.
+template <class CharT>
+struct response_file {
+	using string = std::basic_string<CharT>;
+	using string_view = std::basic_string_view<CharT>;
+
+	// Returns false if the file couldn't be read.
+	bool open(string_view path) {
+		if (!file.open(std::filesystem::path{ string{ path } })) {
+			return false;
+		}
+
+		if constexpr (std::is_same_v<CharT, char>) {
+			tokens = response_tokenizer<CharT>{ string_view{
+					file.data(), file.size() } };
+		} else {
+			// Other character types parse a transcoded copy.
+			std::string utf8{ file.data(), file.size() };
+			transcoded = utf32_to_any<CharT>(utf8_to_utf32(utf8));
+			file.close();
+			tokens = response_tokenizer<CharT>{ transcoded };
+		}
+
+		has_front = tokens.next(front);
+		return true;
+	}
+
+	void pop() {
+		has_front = tokens.next(front);
+	}
+
+	mapped_file file;
+	string transcoded;
+	response_tokenizer<CharT> tokens;
+
+	string_view front;
+	bool has_front = false;
+
+	// How many files include this one.
+	size_t depth = 0;
+};
+} // namespace detail
+} // namespace fea
@@ -0,0 +1,1034 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_getopt/response_file.hpp>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+static_get_opt is a compile time get_opt, for tools with big option tables
+that are launched often.
+
+The whole option table is declared at once. Lookup tables are generated
+when the static_get_opt is built : a perfect hash for long options and a
+direct table for short options. Callbacks are stored as-is and called
+directly, without std::function.
+
+Declare your static_get_opt constexpr to build the tables at compile time.
+Duplicate long or short options will then fail to compile. Otherwise, they
+throw std::invalid_argument like get_opt, when the static_get_opt is built.
+
+Names are checked along with the callbacks, and lambdas which capture
+locals can't be constexpr. Those tables are only checked at runtime. Use
+captureless lambdas or function pointers to keep the compile time checks.
+
+Arguments follow get_opt's grammar : '--name=value', attached short values
+('-j8', '-vj8'), bundled flags and response files ('@file', see
+allow_response_files). static_get_opt doesn't have typed options
+(add_option<T>), counters, streaming multi-arg options, abbreviations,
+"did you mean" suggestions, subcommands, nor the arg0 and help callbacks.
+With it, '--verb' is an unknown option and '-vvv' sets a flag 3 times,
+which is an error.
+
+ex :
+constexpr auto opts = fea::make_static_get_opt(
+		fea::static_flag_option("verbose", []() { return true; }, "Talk.", 'v'),
+		fea::static_required_arg_option("jobs",
+				[](std::string_view) { return true; }, "Job count.", 'j'));
+
+opts.parse_options(argc, argv);
+*/
+
+namespace fea {
+namespace detail {
+// The slot of a key in the perfect hash table, given its bucket
+// displacement.
+constexpr std::uint64_t perfect_hash_slot(
+		std::uint64_t hash, std::uint64_t displacement) {
+	return hash_mix(hash + displacement * 0x9e3779b97f4a7c15ull);
+}
+
+template <class CharT, user_option_e Type, class Func>
+struct static_option {
+	using char_type = CharT;
+	using string_view = std::basic_string_view<CharT>;
+	static constexpr user_option_e opt_type = Type;
+
+	string_view long_name;
+	CharT short_name = CharT('\0');
+	string_view description;
+	string_view default_val;
+	Func func;
+};
+
+template <class CharT>
+struct static_short_opt {
+	CharT short_name = CharT('\0');
+	std::uint32_t opt_idx = 0;
+};
+
+// Everything that changes while parsing, lives on the stack.
+template <class CharT, size_t OptCount>
+struct static_parse_state {
+	using string_view = std::basic_string_view<CharT>;
+
+	// Arguments end early when a response file fails.
+	bool empty() const {
+		return file_error != nullptr
+				|| (response_stack.empty() && idx >= argc);
+	}
+	string_view front() const {
+		if (!response_stack.empty()) {
+			return response_stack.back()->front;
+		}
+		return string_view{ argv[idx] };
+	}
+	string_view pop() {
+		string_view ret = front();
+		if (response_stack.empty()) {
+			++idx;
+		} else {
+			// Finished files go back to the file or argv which included
+			// them.
+			response_stack.back()->pop();
+			while (!response_stack.empty()
+					&& !response_stack.back()->has_front) {
+				response_stack.pop_back();
+			}
+		}
+
+		if (expand_files) {
+			expand_response_files();
+		}
+		return ret;
+	}
+	// The value of the current option, attached values first.
+	// ex : '--opt=value', '-j8'
+	string_view pop_value() {
+		if (attached.data() != nullptr) {
+			return std::exchange(attached, string_view{});
+		}
+		return pop();
+	}
+	// Is there a value for the current option?
+	bool has_value_arg() const {
+		if (attached.data() != nullptr) {
+			return true;
+		}
+		return concat_args.empty() && !empty() && !starts_with_dash(front());
+	}
+
+	// Replaces '@path' arguments with the arguments of the file.
+	void expand_response_files() {
+		// Guards against files which include themselves.
+		constexpr size_t max_depth = 64;
+
+		while (!empty()) {
+			string_view arg = front();
+			if (arg.size() < 2 || arg.front() != CharT('@')) {
+				return;
+			}
+
+			size_t depth = response_stack.empty()
+					? 1
+					: response_stack.back()->depth + 1;
+			if (depth > max_depth) {
+				failed_arg = arg;
+				file_error = FEA_ML("Response files are nested too deeply.\n");
+				return;
+			}
+
+			response_file<CharT>& file = response_files.emplace_back();
+			file.depth = depth;
+			if (!file.open(arg.substr(1))) {
+				response_files.pop_back();
+				failed_arg = arg;
+				file_error = FEA_ML("Couldn't read response file.\n");
+				return;
+			}
+
+			// Skip the '@path' argument itself.
+			expand_files = false;
+			pop();
+			expand_files = true;
+
+			if (file.has_front) {
+				response_stack.push_back(&file);
+			}
+		}
+	}
+
+	CharT const* const* argv = nullptr;
+	size_t argc = 0;
+	size_t idx = 0;
+
+	string_view concat_args;
+	string_view attached;
+	string_view opt_name;
+	std::array<bool, OptCount> parsed{};
+	std::vector<string_view> multi_args;
+
+	// Expanded response files, only allocated when used.
+	bool expand_files = false;
+	std::list<response_file<CharT>> response_files;
+	std::vector<response_file<CharT>*> response_stack;
+	string_view failed_arg;
+	const CharT* file_error = nullptr;
+};
+
+enum class static_parse_error : std::uint8_t {
+	none,
+	missing_arg,
+	missing_multi_arg,
+	unexpected_arg,
+	callback_failed,
+	count,
+};
+} // namespace detail
+
+
+// Option factories. Same behavior as the get_opt add_*_option functions.
+// Callbacks recieve views into argv.
+
+// ex : 'my_tool a/raw/arg.txt'
+template <class CharT, class Func>
+constexpr auto static_raw_option(
+		const CharT* name, Func func, const CharT* help) {
+	static_assert(
+			std::is_invocable_r_v<bool, Func, std::basic_string_view<CharT>>,
+			"static_get_opt : raw option callback must have signature "
+			"bool(std::basic_string_view<CharT>)");
+	return detail::static_option<CharT, detail::user_option_e::raw_arg, Func>{
+		name, CharT('\0'), help, {}, std::move(func)
+	};
+}
+
+// ex : '--flag'
+template <class CharT, class Func>
+constexpr auto static_flag_option(const CharT* long_name, Func func,
+		const CharT* help, CharT short_name = CharT('\0')) {
+	static_assert(std::is_invocable_r_v<bool, Func>,
+			"static_get_opt : flag option callback must have signature "
+			"bool()");
+	return detail::static_option<CharT, detail::user_option_e::flag, Func>{
+		long_name, short_name, help, {}, std::move(func)
+	};
+}
+
+// ex : '--has_default arg' or '--has_default'
+template <class CharT, class Func>
+constexpr auto static_default_arg_option(const CharT* long_name, Func func,
+		const CharT* help, const CharT* default_value,
+		CharT short_name = CharT('\0')) {
+	static_assert(
+			std::is_invocable_r_v<bool, Func, std::basic_string_view<CharT>>,
+			"static_get_opt : default option callback must have signature "
+			"bool(std::basic_string_view<CharT>)");
+	return detail::static_option<CharT, detail::user_option_e::default_arg,
+			Func>{ long_name, short_name, help, default_value,
+		std::move(func) };
+}
+
+// ex : '--optional arg' or '--optional'
+template <class CharT, class Func>
+constexpr auto static_optional_arg_option(const CharT* long_name, Func func,
+		const CharT* help, CharT short_name = CharT('\0')) {
+	static_assert(
+			std::is_invocable_r_v<bool, Func, std::basic_string_view<CharT>>,
+			"static_get_opt : optional option callback must have signature "
+			"bool(std::basic_string_view<CharT>)");
+	return detail::static_option<CharT, detail::user_option_e::optional_arg,
+			Func>{ long_name, short_name, help, {}, std::move(func) };
+}
+
+// ex : '--required arg'
+template <class CharT, class Func>
+constexpr auto static_required_arg_option(const CharT* long_name, Func func,
+		const CharT* help, CharT short_name = CharT('\0')) {
+	static_assert(
+			std::is_invocable_r_v<bool, Func, std::basic_string_view<CharT>>,
+			"static_get_opt : required option callback must have signature "
+			"bool(std::basic_string_view<CharT>)");
+	return detail::static_option<CharT, detail::user_option_e::required_arg,
+			Func>{ long_name, short_name, help, {}, std::move(func) };
+}
+
+// ex : '--multi "a b c d"' or '--multi a b c d'
+template <class CharT, class Func>
+constexpr auto static_multi_arg_option(const CharT* long_name, Func func,
+		const CharT* help, CharT short_name = CharT('\0')) {
+	static_assert(std::is_invocable_r_v<bool, Func,
+						  const std::vector<std::basic_string_view<CharT>>&>,
+			"static_get_opt : multi option callback must have signature "
+			"bool(const std::vector<std::basic_string_view<CharT>>&)");
+	return detail::static_option<CharT, detail::user_option_e::multi_arg,
+			Func>{ long_name, short_name, help, {}, std::move(func) };
+}
+
+
+template <class CharT, class... Opts>
+struct static_get_opt {
+	using string = std::basic_string<CharT>;
+	using string_view = std::basic_string_view<CharT>;
+
+	static constexpr size_t opt_count = sizeof...(Opts);
+	static constexpr size_t npos = size_t(-1);
+
+	constexpr static_get_opt(Opts... opts);
+
+	// Adds some text before printing the help.
+	constexpr void add_help_intro(string_view message);
+
+	// Adds some text after printing the help.
+	constexpr void add_help_outro(string_view message);
+
+	// By default, if a user provides no options, help will be printed and
+	// success will be false. Use this to allow success on no arguments passed.
+	constexpr void no_options_is_ok();
+
+	// By default, the text wrapping will use 120 characters width.
+	// Use this to change the width of the console window.
+	constexpr void console_width(size_t character_width);
+
+	// Replaces '@path' arguments with the arguments read from the file,
+	// like get_opt. Off by default.
+	constexpr void allow_response_files();
+
+	// Parse the arguments, execute your callbacks, returns success bool
+	// (and prints help if there was an error).
+	bool parse_options(size_t argc, CharT const* const* argv) const;
+
+	// Same, but print with your own function. It must accept a const
+	// std::basic_string<CharT>&.
+	template <class PrintFunc>
+	bool parse_options(size_t argc, CharT const* const* argv,
+			const PrintFunc& print_func) const;
+
+	// Returns the option index, or npos if it doesn't exist.
+	constexpr size_t find_long(string_view long_name) const;
+
+	// Returns the option index, or npos if it doesn't exist.
+	constexpr size_t find_short(CharT short_name) const;
+
+private:
+	static_assert(
+			std::is_same_v<CharT,
+					char> || std::is_same_v<CharT, wchar_t> || std::is_same_v<CharT, char16_t> || std::is_same_v<CharT, char32_t>,
+			"static_get_opt : unknown character type, static_get_opt only "
+			"supports char, wchar_t, char16_t and char32_t");
+
+	using state_t = detail::static_parse_state<CharT, opt_count>;
+	using parse_func_t = detail::static_parse_error (static_get_opt::*)(
+			state_t&) const;
+
+	static constexpr std::array<detail::user_option_e, opt_count> _opt_types{
+		{ Opts::opt_type... }
+	};
+	static constexpr size_t raw_count
+			= (size_t(Opts::opt_type == detail::user_option_e::raw_arg) + ...
+					+ 0);
+	static constexpr size_t ascii_count = 128;
+
+	// Perfect hash sizes. Keep the table half empty so it is quick to build.
+	static constexpr size_t bucket_count = opt_count / 2 + 1;
+	static constexpr size_t slot_count = detail::next_pow2(opt_count * 2);
+
+	template <size_t... Is>
+	constexpr void register_options(std::index_sequence<Is...>);
+	template <size_t I>
+	constexpr void register_option(size_t& raw_idx);
+	constexpr void build_perfect_hash();
+
+	// Is the rest of a short option bundle the option's value?
+	// ex : '-j8'
+	static constexpr bool takes_attached(size_t opt_idx, string_view rest);
+
+	template <size_t I>
+	detail::static_parse_error parse_option(state_t& state) const;
+	template <size_t... Is>
+	static constexpr std::array<parse_func_t, opt_count> make_parse_funcs(
+			std::index_sequence<Is...>);
+
+	template <class PrintFunc>
+	void print_help(const PrintFunc& print_func, const state_t& state) const;
+
+	std::tuple<Opts...> _opts;
+
+	// Indexed with the option index.
+	std::array<string_view, opt_count> _names{};
+
+	// Perfect hash of long names.
+	std::array<std::uint32_t, bucket_count> _displacements{};
+	std::array<size_t, slot_count> _slots{};
+
+	// Short options, ascii is direct indexing.
+	std::array<size_t, ascii_count> _ascii_shorts{};
+	std::array<detail::static_short_opt<CharT>, opt_count> _other_shorts{};
+	size_t _other_shorts_size = 0;
+
+	// Raw options in order of declaration.
+	std::array<size_t, raw_count> _raw_opts{};
+
+	string_view _help_intro;
+	string_view _help_outro;
+	size_t _output_width = 120;
+	bool _no_arg_is_help = true;
+	bool _allow_response_files = false;
+};
+
+// Builds a static_get_opt from option factories.
+// Declare the result constexpr to validate everything at compile time.
+template <class Opt, class... Opts>
+constexpr auto make_static_get_opt(Opt opt, Opts... opts) {
+	using char_t = typename Opt::char_type;
+	static_assert((std::is_same_v<char_t, typename Opts::char_type> && ...),
+			"static_get_opt : all options must use the same character type");
+	return static_get_opt<char_t, Opt, Opts...>{ std::move(opt),
+		std::move(opts)... };
+}
+
+
+template <class CharT, class... Opts>
+constexpr static_get_opt<CharT, Opts...>::static_get_opt(Opts... opts)
+		: _opts(std::move(opts)...) {
+	for (size_t i = 0; i < slot_count; ++i) {
+		_slots[i] = npos;
+	}
+	for (size_t i = 0; i < ascii_count; ++i) {
+		_ascii_shorts[i] = npos;
+	}
+
+	register_options(std::index_sequence_for<Opts...>{});
+	build_perfect_hash();
+}
+
+template <class CharT, class... Opts>
+constexpr void static_get_opt<CharT, Opts...>::add_help_intro(
+		string_view message) {
+	_help_intro = message;
+}
+
+template <class CharT, class... Opts>
+constexpr void static_get_opt<CharT, Opts...>::add_help_outro(
+		string_view message) {
+	_help_outro = message;
+}
+
+template <class CharT, class... Opts>
+constexpr void static_get_opt<CharT, Opts...>::no_options_is_ok() {
+	_no_arg_is_help = false;
+}
+
+template <class CharT, class... Opts>
+constexpr void static_get_opt<CharT, Opts...>::console_width(
+		size_t character_width) {
+	_output_width = character_width;
+}
+
+template <class CharT, class... Opts>
+constexpr void static_get_opt<CharT, Opts...>::allow_response_files() {
+	_allow_response_files = true;
+}
+
+template <class CharT, class... Opts>
+constexpr size_t static_get_opt<CharT, Opts...>::find_long(
+		string_view long_name) const {
+	if constexpr (opt_count == raw_count) {
+		return npos;
+	} else {
+		std::uint64_t hash = detail::fnv1a(long_name);
+		std::uint32_t displacement = _displacements[hash % bucket_count];
+		size_t idx = _slots[detail::perfect_hash_slot(hash, displacement)
+				& (slot_count - 1)];
+
+		if (idx == npos || _names[idx] != long_name) {
+			return npos;
+		}
+		return idx;
+	}
+}
+
+template <class CharT, class... Opts>
+constexpr size_t static_get_opt<CharT, Opts...>::find_short(
+		CharT short_name) const {
+	using uchar_t = std::make_unsigned_t<CharT>;
+	if (uchar_t(short_name) < ascii_count) {
+		return _ascii_shorts[uchar_t(short_name)];
+	}
+
+	// Sorted, binary search.
+	size_t beg = 0;
+	size_t end = _other_shorts_size;
+	while (beg < end) {
+		size_t mid = beg + (end - beg) / 2;
+		if (_other_shorts[mid].short_name < short_name) {
+			beg = mid + 1;
+		} else {
+			end = mid;
+		}
+	}
+
+	if (beg < _other_shorts_size
+			&& _other_shorts[beg].short_name == short_name) {
+		return _other_shorts[beg].opt_idx;
+	}
+	return npos;
+}
+
+template <class CharT, class... Opts>
+template <size_t... Is>
+constexpr void static_get_opt<CharT, Opts...>::register_options(
+		std::index_sequence<Is...>) {
+	size_t raw_idx = 0;
+	(register_option<Is>(raw_idx), ...);
+	(void)raw_idx;
+}
+
+template <class CharT, class... Opts>
+template <size_t I>
+constexpr void static_get_opt<CharT, Opts...>::register_option(
+		size_t& raw_idx) {
+	using uchar_t = std::make_unsigned_t<CharT>;
+	const auto& opt = std::get<I>(_opts);
+	_names[I] = opt.long_name;
+
+	if constexpr (_opt_types[I] == detail::user_option_e::raw_arg) {
+		for (size_t i = 0; i < raw_idx; ++i) {
+			if (_names[_raw_opts[i]] == opt.long_name) {
+				throw std::invalid_argument{
+					"static_get_opt : Raw option already exists."
+				};
+			}
+		}
+		_raw_opts[raw_idx++] = I;
+		return;
+	} else {
+		if (opt.long_name.empty()) {
+			throw std::invalid_argument{
+				"static_get_opt : Long option name cannot be empty."
+			};
+		}
+
+		// '--name=value' splits at the first '='.
+		if (opt.long_name.find(CharT('=')) != string_view::npos) {
+			throw std::invalid_argument{
+				"static_get_opt : Long option name cannot contain '='."
+			};
+		}
+
+		if (opt.short_name == CharT('\0')) {
+			return;
+		}
+
+		if (uchar_t(opt.short_name) < ascii_count) {
+			if (_ascii_shorts[uchar_t(opt.short_name)] != npos) {
+				throw std::invalid_argument{
+					"static_get_opt : Short option already exists."
+				};
+			}
+			_ascii_shorts[uchar_t(opt.short_name)] = I;
+			return;
+		}
+
+		// Insertion sort, there are very few of these.
+		size_t pos = _other_shorts_size;
+		while (pos > 0 && opt.short_name < _other_shorts[pos - 1].short_name) {
+			_other_shorts[pos] = _other_shorts[pos - 1];
+			--pos;
+		}
+		if (pos > 0 && _other_shorts[pos - 1].short_name == opt.short_name) {
+			throw std::invalid_argument{
+				"static_get_opt : Short option already exists."
+			};
+		}
+		_other_shorts[pos] = { opt.short_name, std::uint32_t(I) };
+		++_other_shorts_size;
+	}
+}
+
+// Hash and displace. Keys are first distributed in buckets. Then, starting
+// with the biggest bucket, we search for a displacement which sends all its
+// keys to free slots.
+// Duplicate names end up in the same bucket, which is where we catch them.
+template <class CharT, class... Opts>
+constexpr void static_get_opt<CharT, Opts...>::build_perfect_hash() {
+	if constexpr (opt_count == raw_count) {
+		return;
+	} else {
+		std::array<std::uint64_t, opt_count> hashes{};
+		std::array<size_t, bucket_count + 1> offsets{};
+		std::array<size_t, opt_count> keys{};
+
+		// Counting sort, keys end up grouped per bucket.
+		for (size_t i = 0; i < opt_count; ++i) {
+			if (_opt_types[i] == detail::user_option_e::raw_arg) {
+				continue;
+			}
+			hashes[i] = detail::fnv1a(_names[i]);
+			++offsets[hashes[i] % bucket_count + 1];
+		}
+		for (size_t b = 0; b < bucket_count; ++b) {
+			offsets[b + 1] += offsets[b];
+		}
+
+		std::array<size_t, bucket_count> write_pos{};
+		for (size_t b = 0; b < bucket_count; ++b) {
+			write_pos[b] = offsets[b];
+		}
+		for (size_t i = 0; i < opt_count; ++i) {
+			if (_opt_types[i] == detail::user_option_e::raw_arg) {
+				continue;
+			}
+			keys[write_pos[hashes[i] % bucket_count]++] = i;
+		}
+
+		// Biggest buckets first, they are the hardest to place.
+		std::array<size_t, bucket_count> order{};
+		for (size_t b = 0; b < bucket_count; ++b) {
+			order[b] = b;
+		}
+		auto bucket_size
+				= [&](size_t b) { return offsets[b + 1] - offsets[b]; };
+		for (size_t i = 1; i < bucket_count; ++i) {
+			size_t b = order[i];
+			size_t j = i;
+			for (; j > 0 && bucket_size(order[j - 1]) < bucket_size(b); --j) {
+				order[j] = order[j - 1];
+			}
+			order[j] = b;
+		}
+
+		for (size_t b : order) {
+			size_t beg = offsets[b];
+			size_t end = offsets[b + 1];
+			if (beg == end) {
+				break;
+			}
+
+			for (size_t i = beg; i < end; ++i) {
+				for (size_t j = i + 1; j < end; ++j) {
+					if (_names[keys[i]] == _names[keys[j]]) {
+						throw std::invalid_argument{
+							"static_get_opt : Long option already exists."
+						};
+					}
+				}
+			}
+
+			auto slot = [&](size_t key, std::uint32_t displacement) {
+				return size_t(detail::perfect_hash_slot(
+									  hashes[key], displacement)
+						& (slot_count - 1));
+			};
+
+			for (std::uint32_t d = 0;; ++d) {
+				bool fits = true;
+				for (size_t i = beg; i < end && fits; ++i) {
+					size_t s = slot(keys[i], d);
+					fits = _slots[s] == npos;
+
+					// Keys of the same bucket mustn't collide either.
+					for (size_t j = beg; j < i && fits; ++j) {
+						fits = slot(keys[j], d) != s;
+					}
+				}
+
+				if (!fits) {
+					continue;
+				}
+
+				for (size_t i = beg; i < end; ++i) {
+					_slots[slot(keys[i], d)] = keys[i];
+				}
+				_displacements[b] = d;
+				break;
+			}
+		}
+	}
+}
+
+template <class CharT, class... Opts>
+constexpr bool static_get_opt<CharT, Opts...>::takes_attached(
+		size_t opt_idx, string_view rest) {
+	using namespace detail;
+	if (rest.empty()) {
+		return false;
+	}
+
+	switch (_opt_types[opt_idx]) {
+	case user_option_e::required_arg:
+	case user_option_e::multi_arg:
+	case user_option_e::optional_arg:
+	case user_option_e::default_arg: {
+		return true;
+	} break;
+	default: {
+		return false;
+	} break;
+	}
+}
+
+template <class CharT, class... Opts>
+template <size_t I>
+detail::static_parse_error static_get_opt<CharT, Opts...>::parse_option(
+		state_t& state) const {
+	using namespace detail;
+	const auto& opt = std::get<I>(_opts);
+	constexpr user_option_e opt_type = _opt_types[I];
+
+	if constexpr (opt_type == user_option_e::raw_arg) {
+		if (!opt.func(state.pop())) {
+			return static_parse_error::callback_failed;
+		}
+	} else if constexpr (opt_type == user_option_e::flag) {
+		if (state.attached.data() != nullptr) {
+			return static_parse_error::unexpected_arg;
+		}
+		if (!opt.func()) {
+			return static_parse_error::callback_failed;
+		}
+	} else if constexpr (opt_type == user_option_e::required_arg) {
+		if (!state.has_value_arg()) {
+			return static_parse_error::missing_arg;
+		}
+		if (!opt.func(state.pop_value())) {
+			return static_parse_error::callback_failed;
+		}
+	} else if constexpr (opt_type == user_option_e::optional_arg
+			|| opt_type == user_option_e::default_arg) {
+		// Attached values are always the option's.
+		string_view arg = opt.default_val;
+		if (state.has_value_arg()) {
+			arg = state.pop_value();
+		}
+		if (!opt.func(arg)) {
+			return static_parse_error::callback_failed;
+		}
+	} else if constexpr (opt_type == user_option_e::multi_arg) {
+		if (!state.has_value_arg()) {
+			return static_parse_error::missing_multi_arg;
+		}
+
+		state.multi_args.clear();
+		string_view arg = state.pop_value();
+
+		// Were the args enclosed in quotes?
+		if (arg.find(CharT(' ')) != string_view::npos) {
+			while (!arg.empty()) {
+				size_t space_pos = arg.find(CharT(' '));
+				if (space_pos != 0) {
+					state.multi_args.push_back(arg.substr(0, space_pos));
+				}
+
+				if (space_pos == string_view::npos) {
+					break;
+				}
+				arg.remove_prefix(space_pos + 1);
+			}
+		} else {
+			// Gather everything up till the end or the next '-'
+			state.multi_args.push_back(arg);
+			while (state.has_value_arg()) {
+				state.multi_args.push_back(state.pop());
+			}
+		}
+
+		if (!opt.func(state.multi_args)) {
+			return static_parse_error::callback_failed;
+		}
+	}
+
+	return static_parse_error::none;
+}
+
+template <class CharT, class... Opts>
+template <size_t... Is>
+constexpr auto static_get_opt<CharT, Opts...>::make_parse_funcs(
+		std::index_sequence<Is...>) -> std::array<parse_func_t, opt_count> {
+	return { { &static_get_opt::parse_option<Is>... } };
+}
+
+template <class CharT, class... Opts>
+bool static_get_opt<CharT, Opts...>::parse_options(
+		size_t argc, CharT const* const* argv) const {
+	return parse_options(argc, argv,
+			[](const string& message) {
+				detail::get_print<CharT>()(message);
+			});
+}
+
+template <class CharT, class... Opts>
+template <class PrintFunc>
+bool static_get_opt<CharT, Opts...>::parse_options(size_t argc,
+		CharT const* const* argv, const PrintFunc& print_func) const {
+	using namespace detail;
+
+	// Jump table, calls the callbacks directly.
+	static constexpr std::array<parse_func_t, opt_count> parse_funcs
+			= make_parse_funcs(std::index_sequence_for<Opts...>{});
+
+	state_t state;
+	state.argv = argv;
+	state.argc = argv == nullptr ? 0 : argc;
+	state.expand_files = _allow_response_files;
+
+	auto print = [&](const string& message) { print_func(message); };
+	auto on_error = [&]() {
+		print(FEA_ML("\n\n"));
+		print_help(print, state);
+		return false;
+	};
+	auto could_not_parse = [&](string_view what, const CharT* why) {
+		print(FEA_ML("Could not parse : '") + string{ what }
+				+ FEA_ML("'\n"));
+		print(why);
+		return on_error();
+	};
+
+	auto file_failed = [&]() {
+		return could_not_parse(state.failed_arg, state.file_error);
+	};
+
+	if (state.empty()) {
+		return on_error();
+	}
+	state.pop();
+
+	if (state.file_error != nullptr) {
+		return file_failed();
+	}
+	if (state.empty()) {
+		if (_no_arg_is_help) {
+			print_help(print, state);
+			return false;
+		}
+		return true;
+	}
+
+	size_t raw_idx = 0;
+	while (true) {
+		size_t opt_idx = npos;
+
+		if (!state.concat_args.empty()) {
+			// Validated when we first saw them.
+			opt_idx = find_short(state.concat_args.front());
+			state.concat_args.remove_prefix(1);
+
+			if (takes_attached(opt_idx, state.concat_args)) {
+				state.attached = state.concat_args;
+				state.concat_args = {};
+			}
+		} else {
+			if (state.file_error != nullptr) {
+				return file_failed();
+			}
+			if (state.empty()) {
+				break;
+			}
+
+			string_view arg = state.front();
+			switch (classify_arg(arg)) {
+			case arg_kind::help: {
+				print_help(print, state);
+				return false;
+			} break;
+			case arg_kind::shortarg: {
+				state.pop();
+				string_view name = strip_dashes(arg);
+				if (name.size() == 1) {
+					opt_idx = find_short(name.front());
+				}
+
+				if (opt_idx == npos) {
+					return could_not_parse(
+							name, FEA_ML("Option not recognized.\n"));
+				}
+			} break;
+			case arg_kind::longarg: {
+				state.pop();
+				string_view name = strip_dashes(arg);
+				size_t eq_pos = name.find(CharT('='));
+				if (eq_pos != string_view::npos) {
+					state.attached = name.substr(eq_pos + 1);
+					name = name.substr(0, eq_pos);
+				}
+
+				// '---' or '--=x'.
+				if (name.empty()) {
+					return could_not_parse(
+							arg, FEA_ML("Option doesn't exist.\n"));
+				}
+
+				opt_idx = find_long(name);
+				if (opt_idx == npos) {
+					return could_not_parse(
+							name, FEA_ML("Option doesn't exist.\n"));
+				}
+			} break;
+			case arg_kind::concat: {
+				state.pop();
+				string_view name = strip_dashes(arg);
+				if (name.empty()) {
+					return could_not_parse(
+							arg, FEA_ML("Option not recognized.\n"));
+				}
+
+				// The bundle ends at the first option which takes the rest
+				// as its value.
+				for (size_t i = 0; i < name.size(); ++i) {
+					size_t idx = find_short(name[i]);
+					if (idx == npos) {
+						return could_not_parse(name.substr(i, 1),
+								FEA_ML("Option not recognized.\n"));
+					}
+					if (takes_attached(idx, name.substr(i + 1))) {
+						break;
+					}
+				}
+
+				// Options are taken one by one at the top of the loop.
+				state.concat_args = name;
+				continue;
+			} break;
+			default: {
+				if (raw_idx == raw_count) {
+					return could_not_parse(arg,
+							FEA_ML("All arguments have previously been "
+								   "parsed.\n"));
+				}
+
+				if constexpr (raw_count != 0) {
+					opt_idx = _raw_opts[raw_idx++];
+				}
+				state.opt_name = arg;
+			} break;
+			}
+		}
+
+		if (_opt_types[opt_idx] != user_option_e::raw_arg) {
+			state.opt_name = _names[opt_idx];
+			if (state.parsed[opt_idx]) {
+				print(FEA_ML("'") + string{ state.opt_name }
+						+ FEA_ML("' already parsed.\n"));
+				return on_error();
+			}
+			state.parsed[opt_idx] = true;
+		}
+
+		static_parse_error err = (this->*parse_funcs[opt_idx])(state);
+		if (state.file_error != nullptr) {
+			return file_failed();
+		}
+
+		switch (err) {
+		case static_parse_error::none: {
+		} break;
+		case static_parse_error::missing_arg: {
+			return could_not_parse(state.opt_name,
+					FEA_ML("Option requires an argument, none was "
+						   "provided.\n"));
+		} break;
+		case static_parse_error::missing_multi_arg: {
+			return could_not_parse(state.opt_name,
+					FEA_ML("Option requires at minimum 1 argument, none "
+						   "was provided.\n"));
+		} break;
+		case static_parse_error::unexpected_arg: {
+			return could_not_parse(state.opt_name,
+					FEA_ML("Option doesn't take an argument.\n"));
+		} break;
+		default: {
+			print(FEA_ML("'") + string{ state.opt_name }
+					+ FEA_ML("' problem parsing argument.\n"));
+			return on_error();
+		} break;
+		}
+	}
+
+	return true;
+}
+
+template <class CharT, class... Opts>
+template <class PrintFunc>
+void static_get_opt<CharT, Opts...>::print_help(
+		const PrintFunc& print_func, const state_t& state) const {
+	using namespace detail;
+
+	help_info<CharT> info;
+	if (state.argc > 0) {
+		info.arg0 = state.argv[0];
+	}
+	info.intro = _help_intro;
+	info.outro = _help_outro;
+	info.output_width = _output_width;
+
+	// Rendered in one string, printed with one call.
+	// Options are printed in order of declaration.
+	std::basic_string<CharT> out;
+	detail::print_help(
+			[&](std::basic_string_view<CharT> message) { out += message; },
+			info,
+			[this](const auto& func) {
+				std::apply(
+						[&](const auto&... opts) {
+							((opts.opt_type == user_option_e::raw_arg
+											 ? func(opts)
+											 : void()),
+									...);
+						},
+						_opts);
+			},
+			[this](const auto& func) {
+				std::apply(
+						[&](const auto&... opts) {
+							((opts.opt_type != user_option_e::raw_arg
+											 ? func(opts)
+											 : void()),
+									...);
+						},
+						_opts);
+			});
+	print_func(out);
+}
+
+} // namespace fea
@@ -0,0 +1,395 @@
+﻿/*
+BSD 3-Clause License
+
+Copyright (c) 2020, Philippe Groarke
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <fea_getopt/compiled_options.hpp>
+#include <string_view>
+#include <vector>
+
+/*
+suggestion_index finds the long options nearest to a misspelled name, for
+"Did you mean" messages. ex : 'verbos' or 'verbsoe' for 'verbose'
+
+Distances are Levenshtein distances, computed with Myers' bit-parallel
+algorithm. The misspelled name is encoded once as bit masks, each candidate
+then costs a few word operations per character. Candidates are bucketed by
+name length, only names which could be close enough are compared. Every name
+also has a signature of the characters it contains, names missing too many
+of the misspelled name's characters are skipped without computing their
+distance. The search stops comparing a candidate once it can't beat the
+bound, and the bound shrinks as better candidates are found.
+
+Names longer than 64 characters get no suggestions.
+
+ex :
+fea::detail::suggestion_index<char> suggest;
+suggest.build(index);
+
+auto found = suggest.find(index, "verbos");
+for (const auto& s : found) {
+	printf("%s\n", index.long_name(s.opt_idx).data());
+}
+*/
+
+namespace fea {
+namespace detail {
+// A name encoded as bit masks, one bit per character.
+template <class CharT>
+struct edit_pattern {
+	using string_view = std::basic_string_view<CharT>;
+
+	static constexpr size_t max_size = 64;
+
+	// Returns false if the name is too long.
+	bool build(string_view name);
+
+	size_t size() const {
+		return _size;
+	}
+
+	// The Levenshtein distance to text, or max_distance + 1 if it is
+	// greater than max_distance.
+	size_t distance(string_view text, size_t max_distance) const;
+
+private:
+	// The positions of c in the name.
+	std::uint64_t mask(CharT c) const;
+
+	// Ascii characters are looked up directly, others are searched.
+	std::array<std::uint64_t, 128> _ascii{};
+	std::array<CharT, max_size> _others{};
+	std::array<std::uint64_t, max_size> _other_masks{};
+	size_t _others_size = 0;
+	size_t _size = 0;
+};
+
+template <class CharT>
+struct suggestion_index {
+	using string_view = std::basic_string_view<CharT>;
+
+	static constexpr size_t max_suggestions = 4;
+
+	struct suggestion {
+		size_t opt_idx = 0;
+		size_t distance = 0;
+	};
+
+	// The nearest names, at the same distance. Doesn't allocate.
+	struct result {
+		std::array<suggestion, max_suggestions> data{};
+		size_t count = 0;
+
+		const suggestion* begin() const {
+			return data.data();
+		}
+		const suggestion* end() const {
+			return data.data() + count;
+		}
+		size_t size() const {
+			return count;
+		}
+		bool empty() const {
+			return count == 0;
+		}
+	};
+
+	void build(const compiled_options<CharT>& index);
+
+	// The characters of a name, as a set of 64 character classes.
+	static std::uint64_t signature(string_view name);
+
+	// The names within a third of name's length, at least 1 edit.
+	static size_t max_distance(size_t name_size);
+
+	// The nearest names to name, in declaration order. Only names at the
+	// smallest distance are suggested.
+	result find(const compiled_options<CharT>& index, string_view name) const;
+
+	size_t memory_usage() const;
+
+	void clear();
+
+private:
+	// Option indexes sorted by name length.
+	std::vector<std::uint32_t> _by_length;
+	// The signatures of _by_length's names.
+	std::vector<std::uint64_t> _signatures;
+	// Where names of a length start in _by_length, with an end sentinel.
+	std::vector<std::uint32_t> _length_begin;
+};
+
+
+template <class CharT>
+bool edit_pattern<CharT>::build(string_view name) {
+	_ascii.fill(0);
+	_others_size = 0;
+	_size = 0;
+	if (name.size() > max_size) {
+		return false;
+	}
+
+	for (size_t i = 0; i < name.size(); ++i) {
+		CharT c = name[i];
+		std::uint64_t bit = std::uint64_t(1) << i;
+		if (size_t(c) < _ascii.size()) {
+			_ascii[size_t(c)] |= bit;
+			continue;
+		}
+
+		CharT* end = _others.data() + _others_size;
+		CharT* it = std::find(_others.data(), end, c);
+		if (it == end) {
+			_others[_others_size] = c;
+			_other_masks[_others_size] = 0;
+			++_others_size;
+		}
+		_other_masks[size_t(it - _others.data())] |= bit;
+	}
+	_size = name.size();
+	return true;
+}
+
+template <class CharT>
+std::uint64_t edit_pattern<CharT>::mask(CharT c) const {
+	if (size_t(c) < _ascii.size()) {
+		return _ascii[size_t(c)];
+	}
+	for (size_t i = 0; i < _others_size; ++i) {
+		if (_others[i] == c) {
+			return _other_masks[i];
+		}
+	}
+	return 0;
+}
+
+template <class CharT>
+size_t edit_pattern<CharT>::distance(
+		string_view text, size_t max_distance) const {
+	if (_size == 0) {
+		return (std::min)(text.size(), max_distance + 1);
+	}
+
+	// Myers 1999, with Hyyrö's formulation. Pv and Mv are the vertical
+	// deltas of the current column, +1 and -1. The first row is the text
+	// position, every step right adds 1.
+	std::uint64_t last_bit = std::uint64_t(1) << (_size - 1);
+	std::uint64_t pv = ~std::uint64_t(0);
+	std::uint64_t mv = 0;
+	size_t score = _size;
+
+	for (size_t j = 0; j < text.size(); ++j) {
+		std::uint64_t eq = mask(text[j]);
+		std::uint64_t xv = eq | mv;
+		std::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		std::uint64_t ph = mv | ~(xh | pv);
+		std::uint64_t mh = pv & xh;
+
+		// Branchless, the deltas are unpredictable.
+		score += size_t((ph & last_bit) != 0);
+		score -= size_t((mh & last_bit) != 0);
+
+		// Every remaining character lowers the score by 1 at most.
+		size_t remaining = text.size() - j - 1;
+		if (score > max_distance + remaining) {
+			return max_distance + 1;
+		}
+
+		ph = (ph << 1) | 1;
+		mh <<= 1;
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+	}
+	return (std::min)(score, max_distance + 1);
+}
+
+
+template <class CharT>
+void suggestion_index<CharT>::build(const compiled_options<CharT>& index) {
+	clear();
+
+	// Counting sort, names are short.
+	size_t max_len = 0;
+	for (size_t i = 0; i < index.size(); ++i) {
+		max_len = (std::max)(max_len, index.long_name(i).size());
+	}
+
+	// Options without a long name are never suggested.
+	_length_begin.assign(max_len + 2, 0);
+	for (size_t i = 0; i < index.size(); ++i) {
+		if (!index.long_name(i).empty()) {
+			++_length_begin[index.long_name(i).size() + 1];
+		}
+	}
+	for (size_t l = 1; l < _length_begin.size(); ++l) {
+		_length_begin[l] += _length_begin[l - 1];
+	}
+
+	_by_length.resize(_length_begin.back());
+	_signatures.resize(_length_begin.back());
+	std::vector<std::uint32_t> next(
+			_length_begin.begin(), _length_begin.end() - 1);
+	for (size_t i = 0; i < index.size(); ++i) {
+		string_view name = index.long_name(i);
+		if (name.empty()) {
+			continue;
+		}
+		size_t pos = next[name.size()]++;
+		_by_length[pos] = std::uint32_t(i);
+		_signatures[pos] = signature(name);
+	}
+}
+
+template <class CharT>
+std::uint64_t suggestion_index<CharT>::signature(string_view name) {
+	// Characters which share a class can't be told apart, which only
+	// weakens the bound.
+	std::uint64_t ret = 0;
+	for (CharT c : name) {
+		size_t bit = 0;
+		if (c >= CharT('0') && c <= CharT('9')) {
+			bit = size_t(c - CharT('0'));
+		} else if (c >= CharT('a') && c <= CharT('z')) {
+			bit = 10 + size_t(c - CharT('a'));
+		} else if (c >= CharT('A') && c <= CharT('Z')) {
+			bit = 36 + size_t(c - CharT('A'));
+		} else {
+			bit = 62 + (size_t(c) & 1);
+		}
+		ret |= std::uint64_t(1) << bit;
+	}
+	return ret;
+}
+
+template <class CharT>
+size_t suggestion_index<CharT>::max_distance(size_t name_size) {
+	return (std::max)(size_t(1), name_size / 3);
+}
+
+template <class CharT>
+auto suggestion_index<CharT>::find(const compiled_options<CharT>& index,
+		string_view name) const -> result {
+	result ret;
+	edit_pattern<CharT> pattern;
+	if (_by_length.empty() || name.empty() || !pattern.build(name)) {
+		return ret;
+	}
+
+	// A suggestion must keep some of the name.
+	size_t bound = (std::min)(max_distance(name.size()), name.size() - 1);
+	if (bound == 0) {
+		return ret;
+	}
+
+	auto insert = [&](suggestion s) {
+		// Only the nearest names are kept, the bound drops to their
+		// distance.
+		if (ret.count == 0 || s.distance < ret.data[0].distance) {
+			ret.count = 0;
+			bound = s.distance;
+		}
+
+		// In declaration order.
+		suggestion* end = ret.data.data() + ret.count;
+		suggestion* it = std::upper_bound(ret.data.data(), end, s,
+				[](const suggestion& lhs, const suggestion& rhs) {
+					return lhs.opt_idx < rhs.opt_idx;
+				});
+		if (ret.count == max_suggestions) {
+			if (it == end) {
+				return;
+			}
+			--end;
+		} else {
+			++ret.count;
+		}
+		std::move_backward(it, end, end + 1);
+		*it = s;
+	};
+
+	// Every character class a name lacks, or has in excess, is an edit.
+	std::uint64_t name_sig = signature(name);
+	auto sig_distance = [&](std::uint64_t sig) {
+		size_t missing = std::bitset<64>(name_sig & ~sig).count();
+		size_t extra = std::bitset<64>(sig & ~name_sig).count();
+		return (std::max)(missing, extra);
+	};
+
+	// Names closer in length first, they are likelier to be closer.
+	size_t max_len = _length_begin.size() - 2;
+	for (size_t delta = 0; delta <= bound; ++delta) {
+		for (int sign = 0; sign < (delta == 0 ? 1 : 2); ++sign) {
+			if (sign == 1 && name.size() < delta) {
+				continue;
+			}
+			size_t len = sign == 0 ? name.size() + delta : name.size() - delta;
+			// No names this long.
+			if (len > max_len) {
+				continue;
+			}
+			for (size_t i = _length_begin[len]; i < _length_begin[len + 1];
+					++i) {
+				if (sig_distance(_signatures[i]) > bound) {
+					continue;
+				}
+				size_t opt_idx = _by_length[i];
+				size_t d = pattern.distance(index.long_name(opt_idx), bound);
+				if (d <= bound) {
+					insert({ opt_idx, d });
+				}
+			}
+		}
+	}
+	return ret;
+}
+
+template <class CharT>
+size_t suggestion_index<CharT>::memory_usage() const {
+	return (_by_length.capacity() + _length_begin.capacity())
+			* sizeof(std::uint32_t)
+			+ _signatures.capacity() * sizeof(std::uint64_t);
+}
+
+template <class CharT>
+void suggestion_index<CharT>::clear() {
+	_by_length.clear();
+	_signatures.clear();
+	_length_begin.clear();
+}
+} // namespace detail
+} // namespace fea
@@ -0,0 +1,90 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fea_getopt/batch.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+int print_nothing(const std::string&) {
+	return 0;
+}
+
+TEST(parse_batch, results) {
+	std::atomic<size_t> num_flags{ 0 };
+
+	fea::get_opt_spec<char> spec{ print_nothing };
+	spec.add_raw_option(
+			"file", [](std::string_view) { return true; }, "");
+	spec.add_flag_option(
+			"flag",
+			[&]() {
+				++num_flags;
+				return true;
+			},
+			"", 'f');
+	spec.add_required_arg_option(
+			"required", [](std::string_view) { return true; }, "", 'r');
+
+	std::vector<std::string_view> lines{ "tool -f" };
+	EXPECT_THROW(fea::parse_batch(spec, lines), std::invalid_argument);
+
+	spec.freeze();
+
+	lines = {
+		"tool -f",
+		"tool --flag file.txt",
+		"",
+		"tool --bad",
+		"tool -r",
+		"tool a.txt b.txt",
+		"tool -r \"a value\" -f",
+		"tool -f -f",
+	};
+	std::vector<bool> expected{ true, true, true, false, false, false, true,
+		false };
+	EXPECT_EQ(fea::parse_batch(spec, lines), expected);
+	EXPECT_EQ(fea::parse_batch(spec, lines, 1), expected);
+
+	// Many chunks, many threads, results stay in order.
+	constexpr size_t count = 100'000;
+	std::vector<std::string> owned;
+	owned.reserve(count);
+	expected.clear();
+	for (size_t i = 0; i < count; ++i) {
+		if (i % 3 == 0) {
+			owned.push_back("tool --oops " + std::to_string(i));
+			expected.push_back(false);
+		} else {
+			owned.push_back("tool -r " + std::to_string(i) + " -f");
+			expected.push_back(true);
+		}
+	}
+
+	num_flags = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<bool> results = fea::parse_batch(spec, owned, 8);
+	std::chrono::duration<double> elapsed
+			= std::chrono::steady_clock::now() - start;
+
+	EXPECT_EQ(results, expected);
+	EXPECT_EQ(num_flags, count - (count + 2) / 3);
+	printf("parse_batch : %.0f lines/sec\n", count / elapsed.count());
+}
+
+TEST(parse_batch, exceptions) {
+	fea::get_opt_spec<char> spec{ print_nothing };
+	spec.add_flag_option(
+			"throw", []() -> bool { throw std::runtime_error{ "oops" }; },
+			"", 't');
+	spec.add_flag_option(
+			"flag", []() { return true; }, "", 'f');
+	spec.freeze();
+
+	std::vector<std::string_view> lines(10'000, "tool -f");
+	lines[5'000] = "tool -t";
+	EXPECT_THROW(fea::parse_batch(spec, lines, 4), std::runtime_error);
+}
+} // namespace
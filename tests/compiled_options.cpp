@@ -0,0 +1,160 @@
+﻿#include <fea_getopt/compiled_options.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+TEST(compiled_options, lookups) {
+	fea::compiled_options<char> index;
+	EXPECT_TRUE(index.empty());
+	EXPECT_EQ(index.find_long("nope"), index.npos);
+	EXPECT_EQ(index.find_short('n'), index.npos);
+
+	EXPECT_EQ(index.add("verbose", 'v'), 0u);
+	EXPECT_EQ(index.add("jobs", 'j'), 1u);
+	EXPECT_EQ(index.add("no_short"), 2u);
+	EXPECT_EQ(index.add("", 'e'), 3u);
+	EXPECT_EQ(index.add("", 'f'), 4u);
+	index.build();
+
+	EXPECT_EQ(index.size(), 5u);
+	EXPECT_EQ(index.find_long("verbose"), 0u);
+	EXPECT_EQ(index.find_long("jobs"), 1u);
+	EXPECT_EQ(index.find_long("no_short"), 2u);
+	// Short only options aren't indexed by long name.
+	EXPECT_EQ(index.find_long(""), index.npos);
+	EXPECT_EQ(index.find_long("verbos"), index.npos);
+	EXPECT_EQ(index.find_long("verbosee"), index.npos);
+
+	EXPECT_EQ(index.find_short('v'), 0u);
+	EXPECT_EQ(index.find_short('j'), 1u);
+	EXPECT_EQ(index.find_short('e'), 3u);
+	EXPECT_EQ(index.find_short('f'), 4u);
+	EXPECT_EQ(index.find_short('n'), index.npos);
+	EXPECT_EQ(index.find_short('\0'), index.npos);
+
+	EXPECT_EQ(index.long_name(1), "jobs");
+	EXPECT_EQ(index.long_name(3), "");
+
+	index.clear();
+	EXPECT_TRUE(index.empty());
+	EXPECT_EQ(index.find_long("verbose"), index.npos);
+	EXPECT_EQ(index.find_short('v'), index.npos);
+
+	// Wide strings.
+	fea::compiled_options<char32_t> windex;
+	windex.add(U"été", U'é');
+	windex.add(U"中文", U'中');
+	windex.build();
+	EXPECT_EQ(windex.find_long(U"中文"), 1u);
+	EXPECT_EQ(windex.find_short(U'é'), 0u);
+	EXPECT_EQ(windex.find_long(U"ete"), windex.npos);
+}
+
+TEST(compiled_options, short_options) {
+	// ASCII goes through the direct table, the rest through the sorted
+	// fallback.
+	fea::compiled_options<char> index;
+	index.add("a", 'a');
+	index.add("del", '\x7f');
+	index.add("high", '\xe9');
+	index.add("higher", '\xff');
+	index.build();
+	EXPECT_EQ(index.find_short('a'), 0u);
+	EXPECT_EQ(index.find_short('\x7f'), 1u);
+	EXPECT_EQ(index.find_short('\xe9'), 2u);
+	EXPECT_EQ(index.find_short('\xff'), 3u);
+	EXPECT_EQ(index.find_short('\x80'), index.npos);
+	EXPECT_EQ(index.find_short('b'), index.npos);
+
+	fea::compiled_options<char32_t> windex;
+	for (char32_t c = U'\x70'; c < U'\x90'; ++c) {
+		windex.add(std::u32string(1, c), c);
+	}
+	windex.build();
+	for (char32_t c = U'\x70'; c < U'\x90'; ++c) {
+		EXPECT_EQ(windex.find_short(c), size_t(c - U'\x70'));
+	}
+	EXPECT_EQ(windex.find_short(U'\x6f'), windex.npos);
+	EXPECT_EQ(windex.find_short(U'\x90'), windex.npos);
+	EXPECT_EQ(windex.find_short(U'\x10070'), windex.npos);
+
+	// Rebuilding after adding keeps everything.
+	index.add("b", 'b');
+	index.add("wide", '\xf0');
+	index.build();
+	EXPECT_EQ(index.find_short('a'), 0u);
+	EXPECT_EQ(index.find_short('\xff'), 3u);
+	EXPECT_EQ(index.find_short('b'), 4u);
+	EXPECT_EQ(index.find_short('\xf0'), 5u);
+}
+
+TEST(compiled_options, big) {
+	std::vector<std::string> names;
+	fea::compiled_options<char> index;
+	for (size_t i = 0; i < 10'000; ++i) {
+		names.push_back("option_" + std::to_string(i));
+		index.add(names.back());
+	}
+	index.build();
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		EXPECT_EQ(index.find_long(names[i]), i);
+		EXPECT_EQ(index.find_long(names[i] + "_"), index.npos);
+	}
+}
+
+TEST(compiled_options, duplicates) {
+	fea::compiled_options<char> index;
+	index.add("a", 'a');
+	index.add("a", 'b');
+	EXPECT_THROW(index.build(), std::invalid_argument);
+
+	index.clear();
+	index.add("a", 'a');
+	index.add("b", 'a');
+	EXPECT_THROW(index.build(), std::invalid_argument);
+
+	index.clear();
+	index.add("a", '\xe9');
+	index.add("b", '\xe9');
+	EXPECT_THROW(index.build(), std::invalid_argument);
+
+	index.clear();
+	index.add("a", 'a');
+	index.add("b", 'b');
+	EXPECT_NO_THROW(index.build());
+}
+
+TEST(compiled_options, insert) {
+	fea::compiled_options<wchar_t> index;
+
+	// Grows and rehashes along the way, lookups work without build.
+	std::vector<std::wstring> names;
+	for (size_t i = 0; i < 1000; ++i) {
+		names.push_back(L"option_" + std::to_wstring(i));
+		wchar_t short_name = i % 100 == 0 ? wchar_t(0x4e00 + i) : L'\0';
+		EXPECT_EQ(index.insert(names.back(), short_name), i);
+
+		EXPECT_EQ(index.find_long(names.back()), i);
+		EXPECT_EQ(index.find_long(names.front()), 0u);
+	}
+	index.insert(L"jobs", L'j');
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		EXPECT_EQ(index.find_long(names[i]), i);
+	}
+	for (size_t i = 0; i < names.size(); i += 100) {
+		EXPECT_EQ(index.find_short(wchar_t(0x4e00 + i)), i);
+	}
+	EXPECT_EQ(index.find_short(L'j'), 1000u);
+	EXPECT_EQ(index.find_short(L'k'), index.npos);
+
+	EXPECT_THROW(index.insert(L"jobs"), std::invalid_argument);
+	EXPECT_THROW(index.insert(L"other", L'j'), std::invalid_argument);
+	EXPECT_THROW(
+			index.insert(L"other", wchar_t(0x4e00)), std::invalid_argument);
+	EXPECT_EQ(index.size(), 1001u);
+	EXPECT_GT(index.memory_usage(), 0u);
+}
+} // namespace
@@ -0,0 +1,90 @@
+﻿#include <fea_getopt/fea_getopt.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+namespace {
+std::string printed;
+
+int print_to_string(const std::string& message) {
+	printed += message;
+	return 0;
+}
+
+TEST(display_width, widths) {
+	using namespace std::string_view_literals;
+
+	EXPECT_EQ(fea::display_width(""sv), 0u);
+	EXPECT_EQ(fea::display_width("a"sv), 1u);
+	EXPECT_EQ(fea::display_width("a long ascii string, longer than a word"sv),
+			39u);
+
+	// CJK takes 2 columns, combining marks none.
+	EXPECT_EQ(fea::display_width(u8"日本語"sv), 6u);
+	EXPECT_EQ(fea::display_width(u8"é"sv), 1u);
+	EXPECT_EQ(fea::display_width(u8"été"sv), 3u);
+	EXPECT_EQ(fea::display_width(u8"ascii then ＡＢ"sv), 15u);
+
+	// utf16 surrogate pairs and utf32.
+	EXPECT_EQ(fea::display_width(u"\U0001F600"sv), 2u);
+	EXPECT_EQ(fea::display_width(u"中文 text"sv), 9u);
+	EXPECT_EQ(fea::display_width(U"中文 text"sv), 9u);
+	EXPECT_EQ(fea::display_width(L"中文 text"sv), 9u);
+
+	// Invalid utf8 is one replacement character per byte.
+	EXPECT_EQ(fea::display_width("a\xff\xfe"sv), 3u);
+	EXPECT_EQ(fea::display_width("\xe6\x97"sv), 2u);
+}
+
+TEST(display_width, width_prefix) {
+	using namespace std::string_view_literals;
+
+	EXPECT_EQ(fea::detail::width_prefix("abcdef"sv, 3), 3u);
+	EXPECT_EQ(fea::detail::width_prefix("abc"sv, 10), 3u);
+
+	// Never splits a wide character, or a character and its combining mark.
+	std::string_view cjk = u8"日本語";
+	EXPECT_EQ(fea::detail::width_prefix(cjk, 3), 3u);
+	EXPECT_EQ(fea::detail::width_prefix(cjk, 4), 6u);
+	EXPECT_EQ(fea::detail::width_prefix(u8"éx"sv, 1), 3u);
+	EXPECT_EQ(fea::detail::width_prefix(u"\U0001F600a"sv, 2), 2u);
+	EXPECT_EQ(fea::detail::width_prefix(u"\U0001F600a"sv, 1), 0u);
+}
+
+TEST(display_width, help_layout) {
+	fea::get_opt<char> opt{ print_to_string };
+	opt.console_width(40);
+	opt.add_flag_option("ascii", []() { return true; },
+			"Some description which is long enough to wrap around.", 'a');
+	opt.add_flag_option("cjk", []() { return true; },
+			u8"这是一个很长的描述 "
+			u8"这是一个很长的描述",
+			'c');
+	opt.add_flag_option("word", []() { return true; },
+			"Averyveryveryverylongwordwithoutanyspaces", 'w');
+
+	const std::string help = opt.help_string("prog");
+
+	// Every line fits in the console, in columns.
+	size_t lines = 0;
+	std::string_view rest = help;
+	while (!rest.empty()) {
+		size_t nl = rest.find('\n');
+		std::string_view line = rest.substr(0, nl);
+		EXPECT_LE(fea::display_width(line), 40u) << line;
+		++lines;
+		if (nl == std::string_view::npos) {
+			break;
+		}
+		rest.remove_prefix(nl + 1);
+	}
+	EXPECT_GT(lines, 8u);
+
+	// The CJK description is split at its space, not in the middle.
+	EXPECT_NE(help.find(u8"描述\n"), std::string::npos);
+
+	// Words wider than the console are cut instead of looping forever.
+	EXPECT_NE(help.find("Averyvery"), std::string::npos);
+	EXPECT_NE(help.find("spaces\n"), std::string::npos);
+}
+} // namespace
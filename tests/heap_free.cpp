@@ -0,0 +1,196 @@
+﻿#include <array>
+#include <cstdlib>
+#include <fea_getopt/fea_getopt.hpp>
+#include <gtest/gtest.h>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The replacements pair malloc with free. Once inlined, GCC sees a new
+// expression freed by free.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Counts every heap allocation of the test binary.
+namespace {
+size_t heap_allocations = 0;
+} // namespace
+
+void* operator new(size_t size) {
+	++heap_allocations;
+	if (void* p = std::malloc(size == 0 ? 1 : size)) {
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+namespace {
+// Doesn't allocate, keeps the output size.
+size_t printed_size = 0;
+int print_size(const std::string& message) {
+	printed_size += message.size();
+	return 0;
+}
+
+struct parsed {
+	size_t flags = 0;
+	int jobs = 0;
+	std::string_view out;
+	std::string_view level;
+	size_t values = 0;
+	size_t streamed = 0;
+	std::string_view file;
+};
+
+template <class GetOpt>
+void add_options(GetOpt& opt, parsed& p) {
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				++p.flags;
+				return true;
+			},
+			"A flag.", 'f');
+	opt.template add_option<int>(
+			"jobs",
+			[&](int v) {
+				p.jobs = v;
+				return true;
+			},
+			"Job count.", 'j');
+	opt.add_required_arg_option(
+			"out",
+			[&](std::string_view s) {
+				p.out = s;
+				return true;
+			},
+			"Output file.", 'o');
+	opt.add_default_arg_option(
+			"level",
+			[&](std::string_view s) {
+				p.level = s;
+				return true;
+			},
+			"Level.", "3", 'l');
+	opt.add_multi_arg_option(
+			"values",
+			[&](const std::vector<std::string_view>& v) {
+				p.values += v.size();
+				return true;
+			},
+			"Values.", 'v');
+	opt.add_streaming_multi_arg_option(
+			"stream",
+			[&](std::string_view) {
+				++p.streamed;
+				return true;
+			},
+			"Streamed values.", 's');
+	opt.add_raw_option(
+			"file",
+			[&](std::string_view s) {
+				p.file = s;
+				return true;
+			},
+			"A file.");
+}
+
+TEST(heap_free, get_opt) {
+	parsed p;
+	fea::get_opt<char> opt{ print_size };
+	add_options(opt, p);
+	opt.allow_response_files();
+	opt.heap_free(4, 64);
+
+	std::array<const char*, 14> argv{ "tool", "file.txt", "-f", "--jobs",
+		"8", "-o", "out.txt", "--level", "--values", "a", "b", "c", "-s",
+		"x" };
+	std::array<const char*, 2> help{ "tool", "--help" };
+	std::array<const char*, 2> bad{ "tool", "--nope" };
+	std::array<const char*, 7> too_many{ "tool", "-v", "a", "b", "c", "d",
+		"e" };
+	std::array<const char*, 2> response{ "tool", "@args.txt" };
+	std::array<const char*, 3> typed{ "tool", "-j", "many" };
+	// Echoed in a piece longer than the output buffer.
+	std::string long_name = "--" + std::string(200, 'x');
+	std::array<const char*, 2> long_arg{ "tool", long_name.c_str() };
+	size_t help_size = opt.help_string("tool").size();
+
+	size_t before = heap_allocations;
+	for (size_t i = 0; i < 100; ++i) {
+		p = parsed{};
+		EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+		EXPECT_EQ(p.flags, 1u);
+		EXPECT_EQ(p.jobs, 8);
+		EXPECT_EQ(p.out, "out.txt");
+		EXPECT_EQ(p.level, "3");
+		EXPECT_EQ(p.values, 3u);
+		EXPECT_EQ(p.streamed, 1u);
+		EXPECT_EQ(p.file, "file.txt");
+	}
+
+	// Errors and help are printed in pieces.
+	printed_size = 0;
+	EXPECT_FALSE(opt.parse_options(help.size(), help.data()));
+	EXPECT_EQ(printed_size, help_size);
+
+	printed_size = 0;
+	EXPECT_FALSE(opt.parse_options(long_arg.size(), long_arg.data()));
+	std::string_view error_beg = "Could not parse : '";
+	std::string_view error_end = "'\nOption doesn't exist.\n\n\n";
+	EXPECT_EQ(printed_size,
+			error_beg.size() + 200 + error_end.size() + help_size);
+
+	EXPECT_FALSE(opt.parse_options(bad.size(), bad.data()));
+	EXPECT_FALSE(opt.parse_options(too_many.size(), too_many.data()));
+	EXPECT_FALSE(opt.parse_options(response.size(), response.data()));
+	EXPECT_FALSE(opt.parse_options(typed.size(), typed.data()));
+
+	opt.parse_engine(fea::get_opt_engine::fsm);
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_FALSE(opt.parse_options(bad.size(), bad.data()));
+
+	EXPECT_EQ(heap_allocations, before);
+}
+
+TEST(heap_free, parse_buffer) {
+	parsed p;
+	fea::get_opt_spec<char> spec{ print_size };
+	add_options(spec, p);
+	spec.freeze();
+
+	// Callbacks take a std::vector and print functions a std::string,
+	// heap_free reserves those on the heap. Parsing doesn't allocate.
+	{
+		fea::parse_buffer<1024> buffer;
+		fea::get_opt_context<char> ctx{ spec, buffer.resource() };
+		ctx.heap_free(8, 128);
+		size_t before = heap_allocations;
+
+		std::array<const char*, 5> argv{ "tool", "b.txt", "-v", "d", "e" };
+		for (size_t i = 0; i < 100; ++i) {
+			p = parsed{};
+			EXPECT_TRUE(ctx.parse_options(argv.size(), argv.data()));
+			EXPECT_EQ(p.values, 2u);
+			EXPECT_EQ(p.file, "b.txt");
+		}
+
+		std::array<const char*, 2> bad{ "tool", "--nope" };
+		EXPECT_FALSE(ctx.parse_options(bad.size(), bad.data()));
+		EXPECT_EQ(heap_allocations, before);
+	}
+
+	// The spec must be frozen.
+	fea::get_opt_spec<char> unfrozen{ print_size };
+	fea::get_opt_context<char> ctx{ unfrozen };
+	EXPECT_THROW(ctx.heap_free(), std::invalid_argument);
+}
+} // namespace
@@ -0,0 +1,161 @@
+﻿#include <array>
+#include <chrono>
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_getopt/instrument.hpp>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+using namespace std::chrono_literals;
+
+TEST(instrument, histogram) {
+	fea::latency_histogram h;
+	EXPECT_EQ(h.count(), 0u);
+	EXPECT_EQ(h.percentile(50.0), 0ns);
+	EXPECT_EQ(h.mean(), 0ns);
+	EXPECT_EQ(h.min(), 0ns);
+
+	for (int i = 0; i < 99; ++i) {
+		h.record(100ns);
+	}
+	h.record(10000ns);
+
+	EXPECT_EQ(h.count(), 100u);
+	EXPECT_EQ(h.total(), 99 * 100ns + 10000ns);
+	EXPECT_EQ(h.min(), 100ns);
+	EXPECT_EQ(h.max(), 10000ns);
+	EXPECT_EQ(h.mean(), 199ns);
+
+	// 100 is in the [64, 127] bucket, 10000 in [8192, 16383].
+	EXPECT_EQ(h.percentile(50.0), 127ns);
+	EXPECT_EQ(h.percentile(99.0), 127ns);
+	EXPECT_EQ(h.percentile(100.0), 10000ns);
+
+	// Negative durations are clamped.
+	h.record(-5ns);
+	EXPECT_EQ(h.min(), 0ns);
+	EXPECT_EQ(h.percentile(0.0), 0ns);
+
+	h.clear();
+	EXPECT_EQ(h.count(), 0u);
+	EXPECT_EQ(h.max(), 0ns);
+}
+
+TEST(instrument, trace) {
+	fea::instrumentation instr;
+	instr.name_callbacks({ "my \"option\"", "arg0" });
+	instr.trace_capacity(3);
+
+	using clock = fea::instrumentation::clock;
+	clock::time_point beg = clock::now();
+	instr.record(fea::parse_phase::classify, fea::instrumentation::no_callback,
+			beg, beg + 1500ns);
+	instr.record(fea::parse_phase::lookup, fea::instrumentation::no_callback,
+			beg, beg + 10ns);
+	instr.record(fea::parse_phase::callback, 0, beg, beg + 2us);
+	instr.record(fea::parse_phase::callback, 1, beg, beg + 1us);
+
+	EXPECT_EQ(instr.phase(fea::parse_phase::classify).count(), 1u);
+	EXPECT_EQ(instr.phase(fea::parse_phase::callback).count(), 2u);
+	EXPECT_EQ(instr.callback(0).total(), 2us);
+	EXPECT_EQ(instr.callback(1).total(), 1us);
+	EXPECT_EQ(instr.callback_name(0), "my \"option\"");
+
+	// The oldest event was dropped.
+	std::vector<fea::trace_event> events = instr.trace_events();
+	ASSERT_EQ(events.size(), 3u);
+	EXPECT_EQ(events[0].phase, fea::parse_phase::lookup);
+	EXPECT_EQ(events[1].callback, 0u);
+	EXPECT_EQ(events[2].callback, 1u);
+	EXPECT_EQ(events[1].duration_ns, 2000);
+
+	std::string json = instr.chrome_trace();
+	EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+	EXPECT_NE(json.find("\"name\":\"lookup\",\"cat\":\"lookup\",\"ph\":\"X\""),
+			std::string::npos);
+	EXPECT_NE(json.find("\"name\":\"my \\\"option\\\"\",\"cat\":\"callback\""),
+			std::string::npos);
+	EXPECT_NE(json.find("\"dur\":2.000,\"pid\":1,\"tid\":1}"),
+			std::string::npos);
+	EXPECT_EQ(json.find("classify"), std::string::npos);
+
+	std::string report = instr.report();
+	EXPECT_NE(report.find("my \"option\""), std::string::npos);
+	EXPECT_NE(report.find("Allocations : 0, 0 bytes"), std::string::npos);
+
+	// Tracing can be disabled, histograms are still recorded.
+	instr.trace_capacity(0);
+	instr.record(fea::parse_phase::help, fea::instrumentation::no_callback,
+			beg, beg + 1ns);
+	EXPECT_TRUE(instr.trace_events().empty());
+	EXPECT_EQ(instr.phase(fea::parse_phase::help).count(), 1u);
+
+	instr.clear();
+	EXPECT_EQ(instr.phase(fea::parse_phase::help).count(), 0u);
+	EXPECT_EQ(instr.callback_count(), 2u);
+}
+
+#if defined(FEA_GETOPT_INSTRUMENT)
+int print_nothing(const std::string&) {
+	return 0;
+}
+
+TEST(instrument, parse) {
+	size_t verbose = 0;
+	std::string out;
+
+	fea::get_opt<char> opt{ print_nothing };
+	opt.add_flag_option(
+			"verbose",
+			[&]() {
+				++verbose;
+				return true;
+			},
+			"Verbose.", 'v');
+	opt.add_required_arg_option(
+			"out",
+			[&](std::string_view s) {
+				out = s;
+				return true;
+			},
+			"Output.", 'o');
+	opt.add_raw_option(
+			"file", [](std::string_view) { return true; }, "A file.");
+
+	const fea::instrumentation& instr = opt.instrument();
+	std::array<const char*, 5> argv{ "tool", "--verbose", "-o", "a.txt",
+		"file.txt" };
+	ASSERT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	ASSERT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(verbose, 2u);
+
+	// Help was rendered once, when freezing.
+	EXPECT_EQ(instr.phase(fea::parse_phase::help).count(), 1u);
+	EXPECT_EQ(instr.phase(fea::parse_phase::classify).count(), 2u * 4u);
+	EXPECT_EQ(instr.phase(fea::parse_phase::lookup).count(), 2u * 2u);
+	EXPECT_EQ(instr.phase(fea::parse_phase::callback).count(), 2u * 3u);
+	EXPECT_EQ(instr.phase(fea::parse_phase::tokenize).count(), 0u);
+
+	// Options, raw options, arg0 and help.
+	ASSERT_EQ(instr.callback_count(), 5u);
+	for (size_t i = 0; i < instr.callback_count(); ++i) {
+		std::string_view name = instr.callback_name(i);
+		size_t expected = name == "arg0" || name == "help" ? 0u : 2u;
+		EXPECT_EQ(instr.callback(i).count(), expected) << name;
+	}
+
+	std::string json = instr.chrome_trace();
+	EXPECT_NE(json.find("\"name\":\"verbose\""), std::string::npos);
+	EXPECT_NE(json.find("\"name\":\"file\""), std::string::npos);
+
+	// Fed tokens are tokenized, help prints are timed.
+	opt.feed("tool");
+	opt.feed("--help");
+	EXPECT_FALSE(opt.finish());
+	EXPECT_EQ(instr.phase(fea::parse_phase::tokenize).count(), 2u);
+	EXPECT_EQ(instr.phase(fea::parse_phase::help).count(), 2u);
+	EXPECT_GT(instr.allocations(), 0u);
+	EXPECT_GT(instr.allocated_bytes(), 0u);
+}
+#endif
+} // namespace
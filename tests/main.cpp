@@ -4,7 +4,9 @@
 #include <fea_getopt/fea_getopt.hpp>
 #include <fea_utils/platform.hpp>
 #include <gtest/gtest.h>
+#include <memory_resource>
 #include <random>
+#include <thread>
 
 #if defined(FEA_WINDOWS)
 #include <windows.h>
@@ -316,15 +318,42 @@ struct test_scenario {
 			test.populate();
 		}
 
+		// Run every test case with both engines, they must behave the same.
+		constexpr size_t engine_count = size_t(fea::get_opt_engine::count);
+
 		for (const opt_test& test : tests) {
-			auto& g_tester = get_global_tester<CharT>();
-			g_tester = test;
+			std::array<bool, engine_count> results{};
+
+			for (size_t i = 0; i < engine_count; ++i) {
+				opt.parse_engine(fea::get_opt_engine(i));
+
+				auto& g_tester = get_global_tester<CharT>();
+				g_tester = test;
+
+				std::vector<const CharT*> opts = g_tester.get_argv();
+				results[i] = opt.parse_options(opts.size(), opts.data());
+
+				g_tester.testit();
+			}
+
+			EXPECT_EQ(results[0], results[1]);
 
-			std::vector<const CharT*> opts = g_tester.get_argv();
-			opt.parse_options(opts.size(), opts.data());
+			// Feeding tokens one at a time is the same as parsing argv.
+			{
+				auto& g_tester = get_global_tester<CharT>();
+				g_tester = test;
 
-			g_tester.testit();
+				std::vector<const CharT*> opts = g_tester.get_argv();
+				for (const CharT* token : opts) {
+					opt.feed(token);
+				}
+				EXPECT_EQ(opt.finish(), results[0]);
+
+				g_tester.testit();
+			}
 		}
+
+		opt.parse_engine(fea::get_opt_engine::loop);
 	}
 
 	std::vector<option_tester<CharT>> tests;
@@ -1184,6 +1213,1104 @@ TEST(fea_getopt, basics) {
 	}
 }
 
+TEST(fea_getopt, string_views) {
+	// View callbacks must recieve pointers into argv, nothing is copied.
+	std::array<const char*, 12> argv{ "tool.exe", "raw.txt", "-r", "req",
+		"--default", "--optional", "opt", "-m", "a", "b", "c", "-fg" };
+
+	std::vector<const char*> recieved;
+	size_t flags = 0;
+
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_arg0_callback([&](std::string_view s) {
+		recieved.push_back(s.data());
+		return true;
+	});
+	opt.add_raw_option(
+			"raw",
+			[&](std::string_view s) {
+				recieved.push_back(s.data());
+				return true;
+			},
+			"");
+	opt.add_required_arg_option(
+			"required",
+			[&](std::string_view s) {
+				recieved.push_back(s.data());
+				return true;
+			},
+			"", 'r');
+	opt.add_default_arg_option(
+			"default",
+			[&](std::string_view s) {
+				EXPECT_EQ(s, "def");
+				return true;
+			},
+			"", "def");
+	opt.add_optional_arg_option(
+			"optional",
+			[&](std::string_view s) {
+				recieved.push_back(s.data());
+				return true;
+			},
+			"");
+	opt.add_multi_arg_option(
+			"multi",
+			[&](const std::vector<std::string_view>& v) {
+				for (std::string_view s : v) {
+					recieved.push_back(s.data());
+				}
+				return true;
+			},
+			"", 'm');
+	opt.add_flag_option(
+			"flag1",
+			[&]() {
+				++flags;
+				return true;
+			},
+			"", 'f');
+	opt.add_flag_option(
+			"flag2",
+			[&]() {
+				++flags;
+				return true;
+			},
+			"", 'g');
+
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(flags, 2u);
+
+	std::vector<const char*> expected{ argv[0], argv[1], argv[3], argv[6],
+		argv[8], argv[9], argv[10] };
+	EXPECT_EQ(recieved, expected);
+
+	// Quoted multi args are split in place.
+	{
+		std::array<const char*, 3> argv2{ "tool.exe", "--multi", "a b  c" };
+		recieved.clear();
+		EXPECT_TRUE(opt.parse_options(argv2.size(), argv2.data()));
+		expected = { argv2[0], argv2[2], argv2[2] + 2, argv2[2] + 5 };
+		EXPECT_EQ(recieved, expected);
+	}
+
+	// Bad input shouldn't crash.
+	{
+		std::array<const char*, 2> argv2{ "tool.exe", "-" };
+		EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+		argv2[1] = "--";
+		EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+		argv2[1] = "-fx";
+		flags = 0;
+		EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+		EXPECT_EQ(flags, 0u);
+		EXPECT_FALSE(opt.parse_options(0, argv2.data()));
+	}
+}
+
+TEST(fea_getopt, freeze) {
+	std::vector<std::string> recieved;
+	auto make_func = [&](std::string name) {
+		return [&, name]() {
+			recieved.push_back(name);
+			return true;
+		};
+	};
+
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_flag_option("flag1", make_func("flag1"), "", 'a');
+	opt.add_flag_option("flag2", make_func("flag2"), "", 'b');
+	opt.freeze();
+
+	std::array<const char*, 3> argv{ "tool.exe", "--flag1", "-b" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	std::vector<std::string> expected{ "flag1", "flag2" };
+	EXPECT_EQ(recieved, expected);
+
+	// Options added after freezing are found, the index is rebuilt.
+	opt.add_flag_option("flag3", make_func("flag3"), "", 'c');
+	argv = { "tool.exe", "--flag3", "-ab" };
+	recieved.clear();
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	expected = { "flag3", "flag1", "flag2" };
+	EXPECT_EQ(recieved, expected);
+
+	// Freezing twice is fine.
+	opt.freeze();
+	opt.freeze();
+	argv = { "tool.exe", "-c", "--flag4" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	expected = { "flag3" };
+	EXPECT_EQ(recieved, expected);
+}
+
+TEST(fea_getopt, short_options) {
+	std::u32string recieved;
+	fea::get_opt<char32_t> opt{ print_to_string32 };
+	for (char32_t c : std::u32string{ U"abcdefé中" }) {
+		opt.add_flag_option(
+				std::u32string{ U"flag_" } + c,
+				[&recieved, c]() {
+					recieved += c;
+					return true;
+				},
+				U"", c);
+	}
+	opt.add_required_arg_option(
+			U"required",
+			[&](std::u32string_view s) {
+				recieved += s;
+				return true;
+			},
+			U"", U'r');
+
+	// Bundles resolve each short option directly to its option.
+	std::array<const char32_t*, 4> argv{ U"tool.exe", U"-abc中", U"-é",
+		U"-fedr" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(recieved, U"abc中éfed");
+
+	std::array<const char32_t*, 5> argv2{ U"tool.exe", U"-abc中", U"-é",
+		U"-fedr", U"val" };
+	recieved.clear();
+	EXPECT_TRUE(opt.parse_options(argv2.size(), argv2.data()));
+	EXPECT_EQ(recieved, U"abc中éfedval");
+
+	// Unknown short options in a bundle call nothing.
+	argv2 = { U"tool.exe", U"-abcx", U"-d", U"-e", U"-f" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+	EXPECT_TRUE(recieved.empty());
+
+	// Options are parsed once, whether they are long or short.
+	argv2 = { U"tool.exe", U"-a", U"-b", U"-c", U"--flag_a" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+	EXPECT_EQ(recieved, U"abc");
+}
+
+TEST(fea_getopt, attached_values) {
+	std::vector<std::string> recieved;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				recieved.push_back("flag");
+				return true;
+			},
+			"", 'f');
+	opt.add_option<int>(
+			"jobs",
+			[&](int v) {
+				recieved.push_back("jobs " + std::to_string(v));
+				return true;
+			},
+			"", 'j');
+	opt.add_required_arg_option(
+			"include",
+			[&](std::string_view s) {
+				recieved.push_back("include " + std::string{ s });
+				return true;
+			},
+			"", 'I');
+	opt.add_default_arg_option(
+			"level",
+			[&](std::string_view s) {
+				recieved.push_back("level " + std::string{ s });
+				return true;
+			},
+			"", "1", 'l');
+	opt.add_option<bool>(
+			"bool",
+			[&](bool b) {
+				recieved.push_back(b ? "bool true" : "bool false");
+				return true;
+			},
+			"", 'b');
+	opt.add_multi_arg_option(
+			"inputs",
+			[&](const std::vector<std::string_view>& v) {
+				std::string str = "inputs";
+				for (std::string_view s : v) {
+					str += " " + std::string{ s };
+				}
+				recieved.push_back(str);
+				return true;
+			},
+			"", 'i');
+
+	// The rest of a bundle is the value of an option which takes one.
+	std::array<const char*, 5> argv{ "tool.exe", "-j8", "-fI/usr/include",
+		"-l", "3" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	std::vector<std::string> expected{ "jobs 8", "flag", "include /usr/include",
+		"level 3" };
+	EXPECT_EQ(recieved, expected);
+
+	// Bool options take the rest only if it is a bool.
+	std::array<const char*, 4> argv2{ "tool.exe", "-bf", "-lx", "-ia.txt" };
+	recieved.clear();
+	EXPECT_TRUE(opt.parse_options(argv2.size(), argv2.data()));
+	expected = { "bool true", "flag", "level x", "inputs a.txt" };
+	EXPECT_EQ(recieved, expected);
+
+	std::array<const char*, 4> argv3{ "tool.exe", "-bfalse", "-ia.txt",
+		"b.txt" };
+	recieved.clear();
+	EXPECT_TRUE(opt.parse_options(argv3.size(), argv3.data()));
+	expected = { "bool false", "inputs a.txt b.txt" };
+	EXPECT_EQ(recieved, expected);
+
+	// Values are checked, letters after a value aren't options.
+	std::array<const char*, 2> argv4{ "tool.exe", "-jx" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv4.size(), argv4.data()));
+	EXPECT_TRUE(recieved.empty());
+
+	std::array<const char*, 2> argv5{ "tool.exe", "-fzj8" };
+	EXPECT_FALSE(opt.parse_options(argv5.size(), argv5.data()));
+	EXPECT_TRUE(recieved.empty());
+	EXPECT_NE(last_printed_string.find("Could not parse : 'z'"),
+			std::string::npos);
+
+	// Fed tokens too.
+	recieved.clear();
+	for (const char* token : argv) {
+		EXPECT_TRUE(opt.feed(token));
+	}
+	EXPECT_TRUE(opt.finish());
+	expected = { "jobs 8", "flag", "include /usr/include", "level 3" };
+	EXPECT_EQ(recieved, expected);
+
+	// Values after an attached value are waited for.
+	recieved.clear();
+	for (const char* token : argv3) {
+		EXPECT_TRUE(opt.feed(token));
+	}
+	EXPECT_TRUE(opt.finish());
+	expected = { "bool false", "inputs a.txt b.txt" };
+	EXPECT_EQ(recieved, expected);
+}
+
+TEST(fea_getopt, equals_values) {
+	std::vector<std::string> recieved;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				recieved.push_back("flag");
+				return true;
+			},
+			"", 'f');
+	opt.add_required_arg_option(
+			"out",
+			[&](std::string_view s) {
+				recieved.push_back("out " + std::string{ s });
+				return true;
+			},
+			"", 'o');
+	opt.add_default_arg_option(
+			"level",
+			[&](std::string_view s) {
+				recieved.push_back("level " + std::string{ s });
+				return true;
+			},
+			"", "1");
+	opt.add_option<bool>(
+			"bool",
+			[&](bool b) {
+				recieved.push_back(b ? "bool true" : "bool false");
+				return true;
+			},
+			"");
+	opt.add_multi_arg_option(
+			"inputs",
+			[&](const std::vector<std::string_view>& v) {
+				std::string str = "inputs";
+				for (std::string_view s : v) {
+					str += " " + std::string{ s };
+				}
+				recieved.push_back(str);
+				return true;
+			},
+			"");
+
+	// The value is a view of the same argument.
+	std::string out_arg = "--out=a=b.txt";
+	std::array<const char*, 6> argv{ "tool.exe", out_arg.c_str(),
+		"--level=", "--bool=false", "--inputs=x", "y" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	std::vector<std::string> expected{ "out a=b.txt", "level ",
+		"bool false", "inputs x y" };
+	EXPECT_EQ(recieved, expected);
+
+	// Fed tokens too.
+	recieved.clear();
+	for (const char* token : argv) {
+		EXPECT_TRUE(opt.feed(token));
+	}
+	EXPECT_TRUE(opt.finish());
+	EXPECT_EQ(recieved, expected);
+
+	// Explicit values are checked.
+	std::array<const char*, 2> argv2{ "tool.exe", "--bool=maybe" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+	EXPECT_TRUE(recieved.empty());
+
+	std::array<const char*, 2> argv3{ "tool.exe", "--flag=true" };
+	EXPECT_FALSE(opt.parse_options(argv3.size(), argv3.data()));
+	EXPECT_TRUE(recieved.empty());
+	EXPECT_NE(last_printed_string.find("Option doesn't take an argument."),
+			std::string::npos);
+
+	std::array<const char*, 2> argv4{ "tool.exe", "--nope=1" };
+	EXPECT_FALSE(opt.parse_options(argv4.size(), argv4.data()));
+	EXPECT_NE(last_printed_string.find("Could not parse : 'nope'"),
+			std::string::npos);
+
+	// An empty name doesn't match short-only options.
+	opt.add_flag_option(
+			"",
+			[&]() {
+				recieved.push_back("short only");
+				return true;
+			},
+			"Short only.", 's');
+	opt.add_required_arg_option(
+			"",
+			[&](std::string_view s) {
+				recieved.push_back("short value " + std::string{ s });
+				return true;
+			},
+			"Short value.", 't');
+	EXPECT_THROW(opt.add_flag_option("", []() { return true; }, ""),
+			std::invalid_argument);
+
+	std::array<const char*, 4> argv5{ "tool.exe", "-s", "-t", "x" };
+	EXPECT_TRUE(opt.parse_options(argv5.size(), argv5.data()));
+	EXPECT_EQ(recieved,
+			(std::vector<std::string>{ "short only", "short value x" }));
+
+	// No long column, the value follows the short name.
+	std::string help = opt.help_string("tool.exe");
+	auto help_line = [&](std::string_view desc) {
+		size_t end = help.find(desc);
+		if (end == std::string::npos) {
+			return std::string{};
+		}
+		size_t beg = help.rfind('\n', end) + 1;
+		return help.substr(beg, end - beg);
+	};
+	std::string s_line = help_line("Short only.");
+	EXPECT_EQ(s_line.find(" -s "), 0u);
+	EXPECT_EQ(s_line.find_first_not_of(' ', 3), std::string::npos);
+	std::string t_line = help_line("Short value.");
+	EXPECT_EQ(t_line.find(" -t  <value> "), 0u);
+	EXPECT_EQ(t_line.find_first_not_of(' ', 12), std::string::npos);
+
+	// Never suggested.
+	std::array<const char*, 2> argv8{ "tool.exe", "--q" };
+	EXPECT_FALSE(opt.parse_options(argv8.size(), argv8.data()));
+	EXPECT_EQ(last_printed_string.find("''"), std::string::npos);
+
+	// Errors name them by their short name.
+	std::array<const char*, 2> argv7{ "tool.exe", "-t" };
+	EXPECT_FALSE(opt.parse_options(argv7.size(), argv7.data()));
+	EXPECT_NE(last_printed_string.find("Could not parse : 't'"),
+			std::string::npos);
+
+	recieved.clear();
+	for (const char* arg : { "--=x", "---" }) {
+		std::array<const char*, 2> argv6{ "tool.exe", arg };
+		EXPECT_FALSE(opt.parse_options(argv6.size(), argv6.data()));
+		EXPECT_TRUE(recieved.empty());
+		EXPECT_NE(last_printed_string.find("Could not parse : '"
+											  + std::string{ arg }
+											  + "'\nOption doesn't exist."),
+				std::string::npos);
+	}
+
+	EXPECT_THROW(opt.add_flag_option("a=b", []() { return true; }, ""),
+			std::invalid_argument);
+}
+
+TEST(fea_getopt, abbreviations) {
+	std::vector<std::string> recieved;
+	fea::get_opt<char> opt{ print_to_string };
+	for (const char* name : { "verbose", "verbatim", "version", "j", "jobs" }) {
+		opt.add_flag_option(
+				name,
+				[&recieved, name]() {
+					recieved.push_back(name);
+					return true;
+				},
+				"");
+	}
+
+	// Off by default.
+	std::array<const char*, 2> argv{ "tool.exe", "--verbo" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_TRUE(recieved.empty());
+
+	// Exact names win over longer ones.
+	opt.allow_abbreviations();
+	std::array<const char*, 4> argv2{ "tool.exe", "--verbo", "--vers",
+		"--j" };
+	EXPECT_TRUE(opt.parse_options(argv2.size(), argv2.data()));
+	std::vector<std::string> expected{ "verbose", "version", "j" };
+	EXPECT_EQ(recieved, expected);
+
+	// Abbreviations are the same option.
+	std::array<const char*, 3> argv3{ "tool.exe", "--jo", "--jobs" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv3.size(), argv3.data()));
+	EXPECT_NE(last_printed_string.find("'jobs' already parsed."),
+			std::string::npos);
+
+	std::array<const char*, 2> argv4{ "tool.exe", "--ver" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv4.size(), argv4.data()));
+	EXPECT_TRUE(recieved.empty());
+	EXPECT_NE(last_printed_string.find(
+					  "Ambiguous option, could be : 'verbatim', 'verbose', "
+					  "'version'."),
+			std::string::npos);
+
+	// Options added later are abbreviated too.
+	opt.add_flag_option(
+			"zebra",
+			[&]() {
+				recieved.push_back("zebra");
+				return true;
+			},
+			"");
+	std::array<const char*, 2> argv5{ "tool.exe", "--z" };
+	EXPECT_TRUE(opt.parse_options(argv5.size(), argv5.data()));
+	EXPECT_EQ(recieved, std::vector<std::string>{ "zebra" });
+}
+
+TEST(fea_getopt, suggestions) {
+	size_t help_calls = 0;
+	fea::get_opt<char> opt{ print_to_string };
+	for (const char* name : { "verbose", "version", "output", "input" }) {
+		opt.add_flag_option(
+				name, []() { return true; }, "Some help.");
+	}
+	opt.add_help_callback([&]() { ++help_calls; });
+
+	for (size_t i = 0; i < size_t(fea::get_opt_engine::count); ++i) {
+		opt.parse_engine(fea::get_opt_engine(i));
+
+		// The nearest names replace the help.
+		std::array<const char*, 2> argv{ "tool.exe", "--verbos" };
+		EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+		EXPECT_NE(last_printed_string.find("Option doesn't exist.\n"
+										   "Did you mean : 'verbose'?\n"),
+				std::string::npos);
+		EXPECT_EQ(last_printed_string.find("Some help."), std::string::npos);
+		EXPECT_EQ(help_calls, i);
+
+		std::array<const char*, 2> argv2{ "tool.exe", "--outptu=a" };
+		EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+		EXPECT_NE(last_printed_string.find("Did you mean : 'output'?\n"
+										   "Use '--help' to see all options."),
+				std::string::npos);
+
+		// Longer than every option.
+		std::array<const char*, 2> argv4{ "tool.exe", "--verbosee" };
+		EXPECT_FALSE(opt.parse_options(argv4.size(), argv4.data()));
+		EXPECT_NE(last_printed_string.find("Did you mean : 'verbose'?"),
+				std::string::npos);
+		EXPECT_EQ(help_calls, i);
+
+		// Nothing near, prints the help.
+		std::array<const char*, 2> argv3{ "tool.exe", "--verbosityyyyyyy" };
+		EXPECT_FALSE(opt.parse_options(argv3.size(), argv3.data()));
+		EXPECT_EQ(last_printed_string.find("Did you mean"), std::string::npos);
+		EXPECT_NE(last_printed_string.find("Some help."), std::string::npos);
+		EXPECT_EQ(help_calls, i + 1);
+	}
+}
+
+TEST(fea_getopt, counter) {
+	size_t verbosity = 0;
+	size_t flags = 0;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_counter_option(
+			"verbose",
+			[&]() {
+				++verbosity;
+				return true;
+			},
+			"", 'v');
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				++flags;
+				return true;
+			},
+			"", 'f');
+
+	std::array<const char*, 4> argv{ "tool.exe", "-vvv", "--verbose", "-fv" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(verbosity, 5u);
+	EXPECT_EQ(flags, 1u);
+
+	// Other options are still parsed once.
+	std::array<const char*, 2> argv2{ "tool.exe", "-vff" };
+	EXPECT_FALSE(opt.parse_options(argv2.size(), argv2.data()));
+	EXPECT_NE(last_printed_string.find("'flag' already parsed."),
+			std::string::npos);
+}
+
+TEST(fea_getopt, huge_argc) {
+	// The loop engine's stack doesn't grow with the number of arguments.
+	constexpr size_t count = 100'000;
+
+	std::vector<std::string> names;
+	names.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		names.push_back("--flag_" + std::to_string(i));
+	}
+
+	size_t recieved = 0;
+	fea::get_opt<char> opt{ print_to_string };
+	for (const std::string& name : names) {
+		opt.add_flag_option(
+				name.substr(2),
+				[&]() {
+					++recieved;
+					return true;
+				},
+				"");
+	}
+	opt.add_multi_arg_option(
+			"multi",
+			[&](const std::vector<std::string_view>& v) {
+				recieved += v.size();
+				return true;
+			},
+			"");
+
+	std::vector<const char*> argv{ "tool.exe" };
+	for (const std::string& name : names) {
+		argv.push_back(name.c_str());
+	}
+	argv.push_back("--multi");
+	for (size_t i = 0; i < count; ++i) {
+		argv.push_back("val");
+	}
+
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(recieved, count * 2);
+}
+
+TEST(fea_getopt, streaming_multi) {
+	std::vector<std::string> recieved;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_raw_option(
+			"raw",
+			[&](std::string_view s) {
+				recieved.push_back("raw " + std::string{ s });
+				return true;
+			},
+			"");
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				recieved.push_back("flag");
+				return true;
+			},
+			"", 'f');
+	opt.add_streaming_multi_arg_option(
+			"inputs",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return s != "bad";
+			},
+			"", 'i');
+
+	std::vector<const char*> argv{ "tool.exe", "--inputs", "a", "b", "c",
+		"-f" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	std::vector<std::string> expected{ "a", "b", "c", "flag" };
+	EXPECT_EQ(recieved, expected);
+
+	// Quoted values, the following raw isn't a value.
+	argv = { "tool.exe", "-fi", "a  b c", "d" };
+	recieved.clear();
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	expected = { "flag", "a", "b", "c", "raw d" };
+	EXPECT_EQ(recieved, expected);
+
+	// At least one value.
+	argv = { "tool.exe", "-i", "-f" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+
+	// The callback stops parsing.
+	argv = { "tool.exe", "-i", "a", "bad", "c" };
+	recieved.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	expected = { "a", "bad" };
+	EXPECT_EQ(recieved, expected);
+
+	// Fed values are parsed as they come.
+	recieved.clear();
+	EXPECT_TRUE(opt.feed("tool.exe"));
+	EXPECT_TRUE(opt.feed("--inputs"));
+	EXPECT_TRUE(recieved.empty());
+	EXPECT_TRUE(opt.feed("a"));
+	expected = { "a" };
+	EXPECT_EQ(recieved, expected);
+	EXPECT_TRUE(opt.feed("b"));
+	expected = { "a", "b" };
+	EXPECT_EQ(recieved, expected);
+	EXPECT_TRUE(opt.feed("-f"));
+	EXPECT_TRUE(opt.finish());
+	expected = { "a", "b", "flag" };
+	EXPECT_EQ(recieved, expected);
+
+	recieved.clear();
+	EXPECT_TRUE(opt.feed("tool.exe"));
+	EXPECT_TRUE(opt.feed("-i"));
+	EXPECT_TRUE(opt.feed("a"));
+	EXPECT_FALSE(opt.feed("bad"));
+	EXPECT_FALSE(opt.feed("c"));
+	EXPECT_FALSE(opt.finish());
+	expected = { "a", "bad" };
+	EXPECT_EQ(recieved, expected);
+
+	// Many values, nothing is gathered.
+	constexpr size_t count = 200'000;
+	std::vector<std::string> values;
+	values.reserve(count);
+	argv = { "tool.exe", "--inputs" };
+	for (size_t i = 0; i < count; ++i) {
+		values.push_back(std::to_string(i));
+		argv.push_back(values.back().c_str());
+	}
+
+	size_t num_recieved = 0;
+	fea::get_opt<char> big_opt{ print_to_string };
+	big_opt.add_streaming_multi_arg_option(
+			"inputs",
+			[&](std::string_view) {
+				++num_recieved;
+				return true;
+			},
+			"");
+	EXPECT_TRUE(big_opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(num_recieved, count);
+}
+
+TEST(fea_getopt, help_string) {
+	size_t num_prints = 0;
+	std::string printed;
+	auto print_func = [&](const std::string& message) {
+		++num_prints;
+		printed += message;
+		return 0;
+	};
+
+	fea::get_opt<char, std::function<int(const std::string&)>> opt{
+		print_func
+	};
+	opt.add_raw_option(
+			"file", [](std::string_view) { return true; }, "A file.");
+	opt.add_flag_option(
+			"flag", []() { return true; }, "A flag.", 'f');
+	opt.add_help_intro("The intro.");
+
+	// Help is printed in one call.
+	std::array<const char*, 2> argv{ "tool.exe", "-h" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(num_prints, 1u);
+	EXPECT_EQ(printed, opt.help_string("tool.exe"));
+	EXPECT_EQ(printed.find("The intro.\n\nUsage: tool.exe \"file\""), 0u);
+	EXPECT_NE(printed.find("--flag"), std::string::npos);
+
+	// Errors print their message, then the help.
+	argv = { "other.exe", "--nope" };
+	num_prints = 0;
+	printed.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	std::string help = opt.help_string("other.exe");
+	ASSERT_GT(printed.size(), help.size());
+	EXPECT_EQ(printed.substr(printed.size() - help.size()), help);
+
+	// Changes are rendered.
+	opt.add_flag_option(
+			"new_flag", []() { return true; }, "A new flag.");
+	EXPECT_NE(opt.help_string().find("--new_flag"), std::string::npos);
+	opt.add_help_outro("The outro.");
+	opt.add_help_intro("");
+	help = opt.help_string("a");
+	EXPECT_EQ(help.find("\nUsage: a "), 0u);
+	EXPECT_NE(help.find("The outro."), std::string::npos);
+
+	opt.freeze();
+	EXPECT_EQ(opt.help_string("a"), help);
+
+	// Wrapping follows the console width.
+	opt.add_flag_option(
+			"long_help", []() { return true; },
+			"Some words which are long enough to wrap on a narrow console.");
+	opt.console_width(40);
+	opt.freeze();
+	argv = { "tool.exe", "--help" };
+	printed.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(printed, opt.help_string("tool.exe"));
+	EXPECT_EQ(printed.find("Some words which are long enough"),
+			std::string::npos);
+}
+
+TEST(fea_getopt, subcommands) {
+	size_t built = 0;
+	size_t jobs = 0;
+	bool verbose = false;
+	std::vector<std::string> files;
+
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_flag_option(
+			"verbose",
+			[&]() {
+				verbose = true;
+				return true;
+			},
+			"Prints more.", 'v');
+	opt.add_subcommand(
+			"build",
+			[&](fea::get_opt<char>& sub) {
+				++built;
+				sub.add_option<size_t>(
+						"jobs",
+						[&](size_t j) {
+							jobs = j;
+							return true;
+						},
+						"Parallel jobs.", 'j');
+				sub.add_raw_option(
+						"file",
+						[&](std::string_view f) {
+							files.push_back(std::string{ f });
+							return true;
+						},
+						"A file.");
+			},
+			"Builds files.");
+	opt.add_subcommand(
+			"test",
+			[&](fea::get_opt<char>& sub) {
+				++built;
+				sub.add_subcommand(
+						"unit",
+						[&](fea::get_opt<char>&) { ++built; },
+						"Unit tests.");
+			},
+			"Runs tests.");
+	// Inherited by subcommands, 'tool.exe test unit' has no options.
+	opt.no_options_is_ok();
+
+	EXPECT_THROW(opt.add_subcommand("build", nullptr, ""),
+			std::invalid_argument);
+	EXPECT_THROW(opt.add_subcommand("-x", nullptr, ""), std::invalid_argument);
+
+	// Nothing is built until parsed.
+	std::array<const char*, 2> argv{ "tool.exe", "-v" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_TRUE(verbose);
+	EXPECT_TRUE(opt.subcommand().empty());
+	EXPECT_EQ(built, 0u);
+
+	for (size_t i = 0; i < size_t(fea::get_opt_engine::count); ++i) {
+		opt.parse_engine(fea::get_opt_engine(i));
+		verbose = false;
+		files.clear();
+
+		// Arguments after the subcommand are its own.
+		std::array<const char*, 6> argv2{ "tool.exe", "-v", "build", "-j",
+			"4", "a.cpp" };
+		EXPECT_TRUE(opt.parse_options(argv2.size(), argv2.data()));
+		EXPECT_TRUE(verbose);
+		EXPECT_EQ(jobs, 4u);
+		EXPECT_EQ(files, std::vector<std::string>{ "a.cpp" });
+		EXPECT_EQ(opt.subcommand(), "build");
+		EXPECT_EQ(built, 1u);
+
+		// Options aren't shared.
+		std::array<const char*, 3> argv3{ "tool.exe", "build", "-v" };
+		EXPECT_FALSE(opt.parse_options(argv3.size(), argv3.data()));
+	}
+
+	// Help is rendered per subcommand.
+	std::array<const char*, 3> argv4{ "tool.exe", "build", "--help" };
+	EXPECT_FALSE(opt.parse_options(argv4.size(), argv4.data()));
+	EXPECT_EQ(last_printed_string,
+			opt.subcommand_options("build").help_string("tool.exe build"));
+	EXPECT_EQ(last_printed_string.find("\nUsage: tool.exe build \"file\""),
+			0u);
+	EXPECT_EQ(last_printed_string.find("Runs tests."), std::string::npos);
+
+	std::array<const char*, 2> argv5{ "tool.exe", "--help" };
+	EXPECT_FALSE(opt.parse_options(argv5.size(), argv5.data()));
+	EXPECT_NE(last_printed_string.find(
+					  "Usage: tool.exe [options] <command> [<args>]"),
+			std::string::npos);
+	EXPECT_NE(last_printed_string.find("Commands:\n"
+									   " build    Builds files.\n"
+									   " test     Runs tests.\n"),
+			std::string::npos);
+	EXPECT_EQ(last_printed_string.find("Parallel jobs."), std::string::npos);
+
+	// Unknown commands suggest the nearest.
+	std::array<const char*, 2> argv6{ "tool.exe", "tst" };
+	EXPECT_FALSE(opt.parse_options(argv6.size(), argv6.data()));
+	EXPECT_NE(last_printed_string.find("Command doesn't exist.\n"
+									   "Did you mean : 'test'?"),
+			std::string::npos);
+	EXPECT_EQ(built, 1u);
+
+	// Nested.
+	std::array<const char*, 3> argv7{ "tool.exe", "test", "unit" };
+	EXPECT_TRUE(opt.parse_options(argv7.size(), argv7.data()));
+	EXPECT_EQ(opt.subcommand(), "test");
+	EXPECT_EQ(opt.subcommand_options("test").subcommand(), "unit");
+	EXPECT_EQ(built, 3u);
+	EXPECT_THROW(opt.subcommand_options("nope"), std::invalid_argument);
+
+	// Fed tokens after the subcommand go to it.
+	jobs = 0;
+	files.clear();
+	for (const char* token : { "tool.exe", "build", "--jobs", "8", "b.cpp" }) {
+		EXPECT_TRUE(opt.feed(token));
+	}
+	EXPECT_TRUE(opt.finish());
+	EXPECT_EQ(jobs, 8u);
+	EXPECT_EQ(files, std::vector<std::string>{ "b.cpp" });
+	EXPECT_EQ(opt.subcommand(), "build");
+
+	// The next command line starts over.
+	verbose = false;
+	EXPECT_TRUE(opt.feed("tool.exe"));
+	EXPECT_TRUE(opt.feed("-v"));
+	EXPECT_TRUE(opt.finish());
+	EXPECT_TRUE(verbose);
+	EXPECT_TRUE(opt.subcommand().empty());
+	EXPECT_EQ(built, 3u);
+}
+
+// Every thread records its own callbacks. Threads only construct their
+// copy of a namespace scope thread_local.
+thread_local std::vector<std::string> thread_recieved;
+
+TEST(fea_getopt, concurrent_contexts) {
+	fea::get_opt_spec<char> spec{ print_to_string };
+	spec.add_raw_option(
+			"file",
+			[](std::string_view s) {
+				thread_recieved.push_back(std::string{ s });
+				return true;
+			},
+			"");
+	spec.add_flag_option(
+			"flag",
+			[]() {
+				thread_recieved.push_back("flag");
+				return true;
+			},
+			"", 'f');
+	spec.add_required_arg_option(
+			"id",
+			[](std::string_view s) {
+				thread_recieved.push_back(std::string{ s });
+				return true;
+			},
+			"", 'i');
+
+	// Contexts need a frozen spec.
+	{
+		fea::get_opt_context<char> ctx{ spec };
+		std::array<const char*, 2> argv{ "tool.exe", "-f" };
+		EXPECT_THROW(ctx.parse_options(argv.size(), argv.data()),
+				std::invalid_argument);
+	}
+
+	spec.freeze();
+	EXPECT_TRUE(spec.frozen());
+
+	constexpr size_t num_threads = 8;
+	constexpr size_t num_parses = 1'000;
+	std::vector<size_t> failures(num_threads, 0);
+
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < num_threads; ++t) {
+		threads.emplace_back([&, t]() {
+			fea::get_opt_context<char> ctx{ spec };
+			std::string id = std::to_string(t);
+			std::string file = "file" + id + ".txt";
+
+			for (size_t i = 0; i < num_parses; ++i) {
+				thread_recieved.clear();
+				std::array<const char*, 5> argv{ "tool.exe", file.c_str(),
+					"-f", "--id", id.c_str() };
+				bool success = ctx.parse_options(argv.size(), argv.data());
+
+				std::vector<std::string> expected{ file, "flag", id };
+				if (!success || thread_recieved != expected) {
+					++failures[t];
+				}
+			}
+		});
+	}
+
+	for (std::thread& t : threads) {
+		t.join();
+	}
+
+	for (size_t f : failures) {
+		EXPECT_EQ(f, 0u);
+	}
+
+	// The spec wasn't touched, a fresh context sees no parsed options.
+	fea::get_opt_context<char> ctx{ spec };
+	thread_recieved.clear();
+	std::array<const char*, 3> argv{ "tool.exe", "--flag", "-i" };
+	EXPECT_FALSE(ctx.parse_options(argv.size(), argv.data()));
+	argv = { "tool.exe", "--flag", "--flag" };
+	EXPECT_FALSE(ctx.parse_options(argv.size(), argv.data()));
+	argv = { "tool.exe", "a.txt", "--flag" };
+	thread_recieved.clear();
+	EXPECT_TRUE(ctx.parse_options(argv.size(), argv.data()));
+	std::vector<std::string> expected{ "a.txt", "flag" };
+	EXPECT_EQ(thread_recieved, expected);
+}
+
+// Counts the bytes allocated through it.
+TEST(fea_getopt, reset) {
+	size_t flags = 0;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				++flags;
+				return true;
+			},
+			"", 'f');
+
+	// Parsed options are forgotten between parses.
+	std::array<const char*, 2> once{ "tool.exe", "--flag" };
+	for (size_t i = 0; i < 1'000; ++i) {
+		EXPECT_TRUE(opt.parse_options(once.size(), once.data()));
+	}
+	EXPECT_EQ(flags, 1'000u);
+
+	std::array<const char*, 3> twice{ "tool.exe", "--flag", "-f" };
+	EXPECT_FALSE(opt.parse_options(twice.size(), twice.data()));
+	EXPECT_NE(last_printed_string.find("'flag' already parsed."),
+			std::string::npos);
+	EXPECT_TRUE(opt.parse_options(once.size(), once.data()));
+
+	// New options were never parsed.
+	opt.add_flag_option("other", []() { return true; }, "", 'o');
+	std::array<const char*, 3> both{ "tool.exe", "-o", "-f" };
+	EXPECT_TRUE(opt.parse_options(both.size(), both.data()));
+	std::array<const char*, 3> other_twice{ "tool.exe", "-o", "--other" };
+	EXPECT_FALSE(opt.parse_options(other_twice.size(), other_twice.data()));
+}
+
+struct counting_resource : std::pmr::memory_resource {
+	size_t allocated = 0;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		allocated += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const
+			noexcept override {
+		return this == &other;
+	}
+};
+
+TEST(fea_getopt, memory_resource) {
+	std::vector<std::string> recieved;
+
+	fea::get_opt_spec<char> spec{ print_to_string };
+	spec.add_raw_option(
+			"file",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return true;
+			},
+			"");
+	spec.add_flag_option(
+			"flag",
+			[&]() {
+				recieved.push_back("flag");
+				return true;
+			},
+			"", 'f');
+	spec.add_required_arg_option(
+			"id",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return true;
+			},
+			"", 'i');
+	spec.freeze();
+
+	// Parsing allocates from the context's resource.
+	{
+		counting_resource resource;
+		fea::get_opt_context<char> ctx{ spec, &resource };
+		std::array<const char*, 5> argv{ "tool.exe", "a.txt", "-f", "--id",
+			"42" };
+		EXPECT_TRUE(ctx.parse_options(argv.size(), argv.data()));
+		EXPECT_GT(resource.allocated, 0u);
+
+		// Fed tokens and error messages too.
+		size_t before = resource.allocated;
+		for (const char* token : argv) {
+			ctx.feed(token);
+		}
+		ctx.feed("--nope");
+		EXPECT_FALSE(ctx.finish());
+		EXPECT_GT(resource.allocated, before);
+		EXPECT_NE(last_printed_string.find("'nope'"), std::string::npos);
+	}
+
+	// A monotonic arena per request, released in one go. The arena has no
+	// upstream, parsing throws if it needs more.
+	for (size_t i = 0; i < 100; ++i) {
+		std::array<std::byte, 4096> buffer;
+		std::pmr::monotonic_buffer_resource arena{ buffer.data(),
+			buffer.size(), std::pmr::null_memory_resource() };
+
+		recieved.clear();
+		fea::get_opt_context<char> ctx{ spec, &arena };
+		std::string id = std::to_string(i);
+		std::array<const char*, 5> argv{ "tool.exe", "b.txt", "--flag", "-i",
+			id.c_str() };
+		EXPECT_TRUE(ctx.parse_options(argv.size(), argv.data()));
+
+		std::vector<std::string> expected{ "b.txt", "flag", id };
+		EXPECT_EQ(recieved, expected);
+	}
+
+	// get_opt forwards the resource to its context.
+	counting_resource resource;
+	fea::get_opt<char> opt{ print_to_string, &resource };
+	opt.add_flag_option("flag", []() { return true; }, "", 'f');
+	std::array<const char*, 2> argv{ "tool.exe", "-f" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_GT(resource.allocated, 0u);
+}
 
 } // namespace
 
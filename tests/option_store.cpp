@@ -0,0 +1,105 @@
+﻿#include <fea_getopt/fea_getopt.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::string printed;
+
+int print_to_string(const std::string& message) {
+	printed += message;
+	return 0;
+}
+
+TEST(option_store, string_arena) {
+	fea::detail::string_arena<char> arena;
+	EXPECT_EQ(arena.size(), 1u);
+	EXPECT_EQ(arena.intern(""), arena.empty_id);
+	EXPECT_EQ(arena.get(arena.empty_id), "");
+
+	std::vector<std::string> strs;
+	std::vector<std::uint32_t> ids;
+	for (size_t i = 0; i < 500; ++i) {
+		strs.push_back("description " + std::to_string(i));
+		ids.push_back(arena.intern(strs.back()));
+	}
+
+	// Identical strings are interned once.
+	for (size_t i = 0; i < strs.size(); ++i) {
+		EXPECT_EQ(arena.intern(strs[i]), ids[i]);
+		EXPECT_EQ(arena.get(ids[i]), strs[i]);
+	}
+	EXPECT_EQ(arena.size(), 501u);
+
+	arena.clear();
+	EXPECT_EQ(arena.size(), 1u);
+	EXPECT_EQ(arena.intern("a"), 1u);
+}
+
+TEST(option_store, spec) {
+	fea::get_opt<char> opt{ print_to_string };
+	std::vector<std::string> recieved;
+
+	// Added out of order, help is sorted by name.
+	opt.add_required_arg_option(
+			"zed",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return true;
+			},
+			"Same help.", 'z');
+	opt.add_flag_option(
+			"alpha",
+			[&]() {
+				recieved.push_back("alpha");
+				return true;
+			},
+			"Same help.", 'a');
+	opt.add_default_arg_option(
+			"mid",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return true;
+			},
+			"Other help.", "def");
+	opt.add_raw_option(
+			"file",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return true;
+			},
+			"Same help.");
+
+	EXPECT_THROW(opt.add_flag_option(
+						 "alpha", []() { return true; }, "Help."),
+			std::invalid_argument);
+	EXPECT_THROW(opt.add_flag_option(
+						 "other", []() { return true; }, "Help.", 'z'),
+			std::invalid_argument);
+	EXPECT_THROW(opt.add_raw_option(
+						 "file", [](std::string_view) { return true; }, ""),
+			std::invalid_argument);
+
+	std::vector<const char*> argv{ "prog", "in.txt", "-z", "val", "--mid",
+		"-a" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	std::vector<std::string> expected{ "in.txt", "val", "def", "alpha" };
+	EXPECT_EQ(recieved, expected);
+
+	std::string help = opt.help_string("prog");
+	size_t alpha = help.find("--alpha");
+	size_t mid = help.find("--mid <=def>");
+	size_t zed = help.find("--zed <value>");
+	EXPECT_NE(alpha, std::string::npos);
+	EXPECT_LT(alpha, mid);
+	EXPECT_LT(mid, zed);
+	EXPECT_NE(help.find("\"file\""), std::string::npos);
+
+	fea::option_memory mem = opt.memory_usage();
+	EXPECT_GT(mem.hot, 0u);
+	EXPECT_GT(mem.cold, 0u);
+	EXPECT_GT(mem.index, 0u);
+	EXPECT_EQ(mem.total(), mem.hot + mem.cold + mem.index);
+}
+} // namespace
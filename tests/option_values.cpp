@@ -0,0 +1,302 @@
+﻿#include <array>
+#include <chrono>
+#include <clocale>
+#include <cstdint>
+#include <fea_getopt/fea_getopt.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+std::string printed;
+
+int print_to_string(const std::string& message) {
+	printed += message;
+	return 0;
+}
+
+template <class T>
+fea::detail::value_status parse(std::string_view s, T& out) {
+	return fea::detail::parse_value(s, out);
+}
+
+TEST(option_values, numbers) {
+	using fea::detail::value_status;
+
+	int64_t i = 0;
+	EXPECT_EQ(parse("42", i), value_status::ok);
+	EXPECT_EQ(i, 42);
+	EXPECT_EQ(parse("-42", i), value_status::ok);
+	EXPECT_EQ(i, -42);
+	EXPECT_EQ(parse("+42", i), value_status::ok);
+	EXPECT_EQ(i, 42);
+	EXPECT_EQ(parse("", i), value_status::invalid);
+	EXPECT_EQ(parse("+", i), value_status::invalid);
+	EXPECT_EQ(parse("+-1", i), value_status::invalid);
+	EXPECT_EQ(parse("42a", i), value_status::invalid);
+	EXPECT_EQ(parse("4.2", i), value_status::invalid);
+	EXPECT_EQ(parse("9223372036854775807", i), value_status::ok);
+	EXPECT_EQ(parse("9223372036854775808", i), value_status::out_of_range);
+
+	int8_t i8 = 0;
+	EXPECT_EQ(parse("-128", i8), value_status::ok);
+	EXPECT_EQ(i8, -128);
+	EXPECT_EQ(parse("128", i8), value_status::out_of_range);
+
+	uint32_t u = 0;
+	EXPECT_EQ(parse("4294967295", u), value_status::ok);
+	EXPECT_EQ(u, 4294967295u);
+	EXPECT_EQ(parse("4294967296", u), value_status::out_of_range);
+	EXPECT_EQ(parse("-1", u), value_status::invalid);
+
+	double d = 0.0;
+	EXPECT_EQ(parse("0.5", d), value_status::ok);
+	EXPECT_EQ(d, 0.5);
+	EXPECT_EQ(parse("-1e-3", d), value_status::ok);
+	EXPECT_EQ(d, -1e-3);
+	EXPECT_EQ(parse("1e999", d), value_status::out_of_range);
+	EXPECT_EQ(parse("0.5.", d), value_status::invalid);
+
+	bool b = false;
+	for (std::string_view s : { "true", "1", "yes", "on" }) {
+		b = false;
+		EXPECT_EQ(parse(s, b), value_status::ok);
+		EXPECT_TRUE(b);
+	}
+	for (std::string_view s : { "false", "0", "no", "off" }) {
+		b = true;
+		EXPECT_EQ(parse(s, b), value_status::ok);
+		EXPECT_FALSE(b);
+	}
+	EXPECT_EQ(parse("2", b), value_status::invalid);
+	EXPECT_EQ(parse("True", b), value_status::invalid);
+
+	// Other char types are narrowed.
+	int64_t wi = 0;
+	EXPECT_EQ(fea::detail::parse_value(std::u32string_view{ U"-12" }, wi),
+			value_status::ok);
+	EXPECT_EQ(wi, -12);
+	EXPECT_EQ(fea::detail::parse_value(std::u32string_view{ U"1é" }, wi),
+			value_status::invalid);
+	std::wstring long_str(200, L'1');
+	EXPECT_EQ(fea::detail::parse_value(std::wstring_view{ long_str }, wi),
+			value_status::invalid);
+}
+
+TEST(option_values, units) {
+	using fea::detail::value_status;
+	using namespace std::chrono_literals;
+
+	fea::byte_size size;
+	EXPECT_EQ(parse("100", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 100u);
+	EXPECT_EQ(parse("100B", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 100u);
+	EXPECT_EQ(parse("4K", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 4096u);
+	EXPECT_EQ(parse("512KiB", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 512u * 1024u);
+	EXPECT_EQ(parse("3m", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 3u * 1024u * 1024u);
+	EXPECT_EQ(parse("4G", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 4ull << 30);
+	EXPECT_EQ(parse("2TB", size), value_status::ok);
+	EXPECT_EQ(size.bytes, 2ull << 40);
+	EXPECT_EQ(parse("16777216T", size), value_status::out_of_range);
+	EXPECT_EQ(parse("4Q", size), value_status::invalid);
+	EXPECT_EQ(parse("4GiBs", size), value_status::invalid);
+	EXPECT_EQ(parse("-4G", size), value_status::invalid);
+	EXPECT_EQ(parse("G", size), value_status::invalid);
+
+	std::chrono::milliseconds ms{};
+	EXPECT_EQ(parse("250ms", ms), value_status::ok);
+	EXPECT_EQ(ms, 250ms);
+	EXPECT_EQ(parse("250", ms), value_status::ok);
+	EXPECT_EQ(ms, 250ms);
+	EXPECT_EQ(parse("2h", ms), value_status::ok);
+	EXPECT_EQ(ms, 2h);
+	EXPECT_EQ(parse("3min", ms), value_status::ok);
+	EXPECT_EQ(ms, 3min);
+	EXPECT_EQ(parse("-2s", ms), value_status::ok);
+	EXPECT_EQ(ms, -2s);
+	EXPECT_EQ(parse("1000us", ms), value_status::ok);
+	EXPECT_EQ(ms, 1ms);
+	EXPECT_EQ(parse("1500us", ms), value_status::invalid);
+	EXPECT_EQ(parse("2d", ms), value_status::invalid);
+
+	std::chrono::seconds s{};
+	EXPECT_EQ(parse("250ms", s), value_status::invalid);
+	EXPECT_EQ(parse("2000ms", s), value_status::ok);
+	EXPECT_EQ(s, 2s);
+
+	std::chrono::duration<int8_t> small{};
+	EXPECT_EQ(parse("2min", small), value_status::ok);
+	EXPECT_EQ(small.count(), 120);
+	EXPECT_EQ(parse("3min", small), value_status::out_of_range);
+
+	std::chrono::duration<double> fs{};
+	EXPECT_EQ(parse("250ms", fs), value_status::ok);
+	EXPECT_DOUBLE_EQ(fs.count(), 0.25);
+	EXPECT_EQ(parse("1.5h", fs), value_status::ok);
+	EXPECT_DOUBLE_EQ(fs.count(), 5400.0);
+}
+
+TEST(option_values, typed_options) {
+	using namespace std::chrono_literals;
+
+	int64_t threads = 0;
+	double ratio = 0.0;
+	bool verbose = false;
+	fea::byte_size buffer;
+	std::chrono::milliseconds timeout{};
+	std::vector<std::string> files;
+
+	fea::get_opt<char> opt{ print_to_string };
+	opt.add_raw_option(
+			"file",
+			[&](std::string_view s) {
+				files.push_back(std::string{ s });
+				return true;
+			},
+			"");
+	opt.add_option<int64_t>(
+			"threads",
+			[&](int64_t v) {
+				threads = v;
+				return v > 0;
+			},
+			"Thread count.", 'j');
+	opt.add_option<double>(
+			"ratio",
+			[&](double v) {
+				ratio = v;
+				return true;
+			},
+			"");
+	opt.add_option<bool>(
+			"verbose",
+			[&](bool v) {
+				verbose = v;
+				return true;
+			},
+			"", 'v');
+	opt.add_option<fea::byte_size>(
+			"buffer",
+			[&](fea::byte_size v) {
+				buffer = v;
+				return true;
+			},
+			"");
+	opt.add_option<std::chrono::milliseconds>(
+			"timeout",
+			[&](std::chrono::milliseconds v) {
+				timeout = v;
+				return true;
+			},
+			"");
+
+	std::vector<const char*> argv{ "tool.exe", "-j", "8", "--ratio", "0.25",
+		"--buffer", "4G", "--timeout", "2s", "-v" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(threads, 8);
+	EXPECT_EQ(ratio, 0.25);
+	EXPECT_EQ(buffer.bytes, 4ull << 30);
+	EXPECT_EQ(timeout, 2s);
+	EXPECT_TRUE(verbose);
+
+	// Bool options only take bool values.
+	argv = { "tool.exe", "--verbose", "off" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_FALSE(verbose);
+	argv = { "tool.exe", "--verbose", "a.txt" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_TRUE(verbose);
+	EXPECT_EQ(files, std::vector<std::string>{ "a.txt" });
+
+	// Errors.
+	argv = { "tool.exe", "-j", "abc" };
+	printed.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_NE(printed.find("'abc' isn't an integer between "),
+			std::string::npos);
+
+	argv = { "tool.exe", "--threads", "99999999999999999999" };
+	printed.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_NE(printed.find("is out of range, expected an integer"),
+			std::string::npos);
+
+	argv = { "tool.exe", "--timeout", "1day" };
+	printed.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_NE(printed.find("'1day' isn't a duration"), std::string::npos);
+
+	// The callback rejects the value.
+	argv = { "tool.exe", "-j", "0" };
+	printed.clear();
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_NE(printed.find("'threads' problem parsing argument."),
+			std::string::npos);
+	EXPECT_EQ(printed.find("isn't"), std::string::npos);
+
+	// Missing values.
+	argv = { "tool.exe", "--buffer" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+
+	// Feeding works the same.
+	threads = 0;
+	EXPECT_TRUE(opt.feed("tool.exe"));
+	EXPECT_TRUE(opt.feed("-j"));
+	EXPECT_TRUE(opt.feed("16"));
+	EXPECT_TRUE(opt.finish());
+	EXPECT_EQ(threads, 16);
+}
+
+TEST(option_values, wide_typed_options) {
+	uint16_t port = 0;
+
+	fea::get_opt<wchar_t> opt{ [](const std::wstring&) { return 0; } };
+	opt.add_option<uint16_t>(
+			L"port",
+			[&](uint16_t v) {
+				port = v;
+				return true;
+			},
+			L"", L'p');
+
+	std::array<const wchar_t*, 3> argv{ L"tool.exe", L"-p", L"8080" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(port, 8080);
+
+	argv = { L"tool.exe", L"-p", L"65536" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+}
+TEST(option_values, locale) {
+	using fea::detail::value_status;
+
+	// Values use '.' whatever the global locale.
+	std::string old_locale = std::setlocale(LC_ALL, nullptr);
+	const char* comma_locale = nullptr;
+	for (const char* name : { "de_DE.UTF-8", "fr_FR.UTF-8", "de_DE.utf8",
+				 "fr_FR.utf8", "German_Germany.1252", "French_France.1252" }) {
+		if (std::setlocale(LC_ALL, name) != nullptr) {
+			comma_locale = name;
+			break;
+		}
+	}
+	if (comma_locale == nullptr) {
+		GTEST_SKIP() << "No locale with a decimal comma.";
+	}
+
+	double d = 0.0;
+	EXPECT_EQ(parse("0.5", d), value_status::ok);
+	EXPECT_DOUBLE_EQ(d, 0.5);
+	EXPECT_EQ(parse("0,5", d), value_status::invalid);
+
+	float f = 0.f;
+	EXPECT_EQ(parse("1.25", f), value_status::ok);
+	EXPECT_FLOAT_EQ(f, 1.25f);
+
+	std::setlocale(LC_ALL, old_locale.c_str());
+}
+} // namespace
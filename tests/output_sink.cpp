@@ -0,0 +1,200 @@
+﻿#include <array>
+#include <cstdio>
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_utils/platform.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#if !defined(FEA_WINDOWS)
+#include <unistd.h>
+#endif
+
+namespace {
+// Records every write.
+struct counting_sink {
+	counting_sink(std::vector<std::string>& out)
+			: writes(&out) {
+	}
+
+	void write(const std::string_view* pieces, size_t count) const {
+		std::string str;
+		for (size_t i = 0; i < count; ++i) {
+			str += pieces[i];
+		}
+		writes->push_back(str);
+	}
+
+	std::vector<std::string>* writes;
+};
+
+template <class PrintfT>
+void add_options(fea::get_opt<char, PrintfT>& opt) {
+	opt.add_flag_option(
+			"flag", []() { return true; }, "A flag.", 'f');
+	opt.add_required_arg_option(
+			"required", [](std::string_view) { return true; }, "A value.",
+			'r');
+}
+
+std::string read_file(FILE* file) {
+	std::string ret;
+	rewind(file);
+	std::array<char, 256> buf;
+	size_t size = 0;
+	while ((size = fread(buf.data(), 1, buf.size(), file)) != 0) {
+		ret.append(buf.data(), size);
+	}
+	return ret;
+}
+
+TEST(output_sink, one_write) {
+	std::vector<std::string> writes;
+	fea::get_opt<char, counting_sink> opt{ counting_sink{ writes } };
+	add_options(opt);
+
+	// Nothing to say.
+	std::array<const char*, 2> argv{ "tool.exe", "-f" };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_TRUE(writes.empty());
+
+	// The error, then the help, in one write.
+	argv = { "tool.exe", "--nope" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	ASSERT_EQ(writes.size(), 1u);
+	EXPECT_EQ(writes[0].find("Could not parse : 'nope'"), 0u);
+	EXPECT_NE(writes[0].find(opt.help_string("tool.exe")), std::string::npos);
+
+	writes.clear();
+	argv = { "tool.exe", "-h" };
+	EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+	ASSERT_EQ(writes.size(), 1u);
+	EXPECT_EQ(writes[0], opt.help_string("tool.exe"));
+
+	// Fed errors are written when they happen.
+	writes.clear();
+	EXPECT_TRUE(opt.feed("tool.exe"));
+	EXPECT_FALSE(opt.feed("--nope"));
+	EXPECT_EQ(writes.size(), 1u);
+	EXPECT_FALSE(opt.feed("-f"));
+	EXPECT_FALSE(opt.finish());
+	EXPECT_EQ(writes.size(), 1u);
+
+	writes.clear();
+	EXPECT_TRUE(opt.feed("tool.exe"));
+	EXPECT_TRUE(opt.feed("-r"));
+	EXPECT_TRUE(writes.empty());
+	EXPECT_FALSE(opt.finish());
+	ASSERT_EQ(writes.size(), 1u);
+	EXPECT_NE(writes[0].find("Option requires an argument"),
+			std::string::npos);
+}
+
+TEST(output_sink, sinks) {
+	// string
+	{
+		std::string out;
+		fea::get_opt<char, fea::string_sink<char>> opt{
+			fea::string_sink<char>{ out }
+		};
+		add_options(opt);
+
+		std::array<const char*, 2> argv{ "tool.exe", "--help" };
+		EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+		EXPECT_EQ(out, opt.help_string("tool.exe"));
+	}
+
+	// FILE*
+	{
+		FILE* file = tmpfile();
+		ASSERT_NE(file, nullptr);
+
+		fea::get_opt<char, fea::file_sink<char>> opt{ fea::file_sink<char>{
+				file } };
+		add_options(opt);
+
+		std::array<const char*, 2> argv{ "tool.exe", "--help" };
+		EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+		EXPECT_EQ(read_file(file), opt.help_string("tool.exe"));
+		fclose(file);
+	}
+
+	// utf8 FILE*
+	{
+		FILE* file = tmpfile();
+		ASSERT_NE(file, nullptr);
+
+		fea::get_opt<char32_t, fea::file_sink<char32_t>> opt{
+			fea::file_sink<char32_t>{ file }
+		};
+		opt.add_flag_option(
+				U"flâg", []() { return true; }, U"Ünicode.");
+
+		std::array<const char32_t*, 2> argv{ U"tööl.exe", U"--help" };
+		EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+		EXPECT_EQ(read_file(file),
+				fea::utf32_to_utf8(opt.help_string(U"tööl.exe")));
+		fclose(file);
+	}
+
+#if !defined(FEA_WINDOWS)
+	// fd, with writev.
+	{
+		FILE* file = tmpfile();
+		ASSERT_NE(file, nullptr);
+
+		fea::get_opt<char, fea::fd_sink<char>> opt{ fea::fd_sink<char>{
+				fileno(file) } };
+		add_options(opt);
+
+		std::array<const char*, 2> argv{ "tool.exe", "--bad" };
+		EXPECT_FALSE(opt.parse_options(argv.size(), argv.data()));
+		std::string out = read_file(file);
+		EXPECT_EQ(out.find("Could not parse : 'bad'"), 0u);
+		EXPECT_NE(out.find(opt.help_string("tool.exe")), std::string::npos);
+		fclose(file);
+	}
+
+	// Many pieces, more than one writev call.
+	{
+		FILE* file = tmpfile();
+		ASSERT_NE(file, nullptr);
+
+		std::vector<std::string> strs;
+		std::vector<std::string_view> pieces;
+		std::string expected;
+		for (size_t i = 0; i < 5'000; ++i) {
+			strs.push_back(std::to_string(i) + ",");
+			expected += strs.back();
+		}
+		for (const std::string& s : strs) {
+			pieces.push_back(s);
+		}
+
+		// Empty pieces are skipped.
+		pieces.insert(pieces.begin(), std::string_view{});
+		pieces.push_back(std::string_view{});
+
+		fea::fd_sink<char> sink{ fileno(file) };
+		EXPECT_TRUE(sink.write(pieces.data(), pieces.size()));
+		EXPECT_EQ(read_file(file), expected);
+		fclose(file);
+	}
+
+	// Failures are reported.
+	{
+		std::array<int, 2> fds{};
+		ASSERT_EQ(pipe(fds.data()), 0);
+		close(fds[0]);
+		close(fds[1]);
+
+		std::string_view piece = "lost";
+		fea::fd_sink<char> sink{ fds[1] };
+		EXPECT_FALSE(sink.write(&piece, 1));
+
+		std::string_view empty;
+		EXPECT_TRUE(sink.write(&empty, 1));
+	}
+#endif
+}
+} // namespace
@@ -0,0 +1,108 @@
+﻿#include <algorithm>
+#include <fea_getopt/compiled_options.hpp>
+#include <fea_getopt/prefix_trie.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// The option names found by the trie, sorted.
+std::vector<std::string> found(const fea::detail::prefix_trie<char>& trie,
+		const fea::compiled_options<char>& index, std::string_view prefix) {
+	std::vector<std::string> ret;
+	auto r = trie.find(index, prefix);
+	for (size_t i = r.first; i < r.last; ++i) {
+		ret.push_back(std::string{ index.long_name(trie.option(i)) });
+	}
+	return ret;
+}
+
+TEST(prefix_trie, basics) {
+	fea::compiled_options<char> index;
+	fea::detail::prefix_trie<char> trie;
+	trie.build(index);
+	EXPECT_EQ(trie.find(index, "a").size(), 0u);
+
+	for (const char* name :
+			{ "verbose", "verbatim", "version", "jobs", "j", "über" }) {
+		index.add(name);
+	}
+	index.build();
+	trie.build(index);
+
+	using names = std::vector<std::string>;
+	EXPECT_EQ(found(trie, index, "verb"), (names{ "verbatim", "verbose" }));
+	EXPECT_EQ(found(trie, index, "verbo"), names{ "verbose" });
+	EXPECT_EQ(found(trie, index, "verbose"), names{ "verbose" });
+	EXPECT_EQ(found(trie, index, "vers"), names{ "version" });
+	EXPECT_EQ(found(trie, index, "ver"),
+			(names{ "verbatim", "verbose", "version" }));
+	EXPECT_EQ(found(trie, index, "j"), (names{ "j", "jobs" }));
+	EXPECT_EQ(found(trie, index, "jo"), names{ "jobs" });
+	EXPECT_EQ(found(trie, index, "ü"), names{ "über" });
+
+	EXPECT_TRUE(found(trie, index, "").empty());
+	EXPECT_TRUE(found(trie, index, "verbosee").empty());
+	EXPECT_TRUE(found(trie, index, "verbx").empty());
+	EXPECT_TRUE(found(trie, index, "x").empty());
+	EXPECT_TRUE(found(trie, index, "jobss").empty());
+
+	EXPECT_GT(trie.memory_usage(), 0u);
+	trie.clear();
+	EXPECT_TRUE(found(trie, index, "verb").empty());
+
+	// Short only options have no long name to abbreviate.
+	index.add("", 'a');
+	index.add("", 'b');
+	index.build();
+	trie.build(index);
+	EXPECT_EQ(found(trie, index, "j"), (names{ "j", "jobs" }));
+	EXPECT_EQ(found(trie, index, "v"),
+			(names{ "verbatim", "verbose", "version" }));
+}
+
+TEST(prefix_trie, brute_force) {
+	// Names with long shared prefixes and a few characters.
+	std::mt19937 gen{ 42 };
+	std::uniform_int_distribution<int> len_dist{ 1, 8 };
+	std::uniform_int_distribution<int> char_dist{ 0, 3 };
+
+	fea::compiled_options<char> index;
+	std::vector<std::string> names;
+	while (names.size() < 500) {
+		std::string name;
+		for (int i = len_dist(gen); i > 0; --i) {
+			name += "ab\xc3z"[char_dist(gen)];
+		}
+		if (index.find_long(name) != index.npos) {
+			continue;
+		}
+		index.insert(name);
+		names.push_back(name);
+	}
+
+	fea::detail::prefix_trie<char> trie;
+	trie.build(index);
+	std::sort(names.begin(), names.end());
+
+	// Every prefix of every name, and some which don't exist.
+	std::vector<std::string> prefixes;
+	for (const std::string& name : names) {
+		for (size_t i = 1; i <= name.size() + 1; ++i) {
+			prefixes.push_back(name.substr(0, i));
+			prefixes.push_back(name.substr(0, i - 1) + "q");
+		}
+	}
+
+	for (const std::string& prefix : prefixes) {
+		std::vector<std::string> expected;
+		for (const std::string& name : names) {
+			if (name.compare(0, prefix.size(), prefix) == 0) {
+				expected.push_back(name);
+			}
+		}
+		EXPECT_EQ(found(trie, index, prefix), expected) << prefix;
+	}
+}
+} // namespace
@@ -0,0 +1,187 @@
+﻿#include <fea_getopt/repl.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+std::string printed;
+
+int print_to_string(const std::string& message) {
+	printed += message;
+	return 0;
+}
+
+struct test_opts {
+	test_opts() {
+		opt.add_raw_option(
+				"raw",
+				[this](std::string_view s) {
+					recieved.push_back("raw " + std::string{ s });
+					return true;
+				},
+				"");
+		opt.add_flag_option(
+				"flag",
+				[this]() {
+					recieved.push_back("flag");
+					return true;
+				},
+				"", 'f');
+		opt.add_required_arg_option(
+				"required",
+				[this](std::string_view s) {
+					recieved.push_back("required " + std::string{ s });
+					return true;
+				},
+				"", 'r');
+		opt.add_default_arg_option(
+				"default",
+				[this](std::string_view s) {
+					recieved.push_back("default " + std::string{ s });
+					return true;
+				},
+				"", "def", 'd');
+		opt.add_multi_arg_option(
+				"multi",
+				[this](const std::vector<std::string_view>& v) {
+					std::string out = "multi";
+					for (std::string_view s : v) {
+						out += " " + std::string{ s };
+					}
+					recieved.push_back(out);
+					return true;
+				},
+				"", 'm');
+	}
+
+	fea::get_opt<char> opt{ print_to_string };
+	std::vector<std::string> recieved;
+};
+
+TEST(feed, eager) {
+	test_opts t;
+	using strings = std::vector<std::string>;
+
+	// Callbacks are called as soon as an option is complete.
+	EXPECT_TRUE(t.opt.feed("tool.exe"));
+	EXPECT_TRUE(t.opt.feed("raw.txt"));
+	EXPECT_EQ(t.recieved, strings{ "raw raw.txt" });
+
+	EXPECT_TRUE(t.opt.feed("-f"));
+	EXPECT_EQ(t.recieved, (strings{ "raw raw.txt", "flag" }));
+
+	// Waits for its value.
+	EXPECT_TRUE(t.opt.feed("--required"));
+	EXPECT_EQ(t.recieved.size(), 2u);
+	EXPECT_TRUE(t.opt.feed("val"));
+	EXPECT_EQ(t.recieved.back(), "required val");
+
+	// Waits for the next option.
+	EXPECT_TRUE(t.opt.feed("-m"));
+	EXPECT_TRUE(t.opt.feed("a"));
+	EXPECT_TRUE(t.opt.feed("b"));
+	EXPECT_EQ(t.recieved.size(), 3u);
+	EXPECT_TRUE(t.opt.feed("-d"));
+	EXPECT_EQ(t.recieved.back(), "multi a b");
+
+	// Default args wait for the next token, or the end.
+	EXPECT_EQ(t.recieved.size(), 4u);
+	EXPECT_TRUE(t.opt.finish());
+	EXPECT_EQ(t.recieved,
+			(strings{ "raw raw.txt", "flag", "required val", "multi a b",
+					"default def" }));
+
+	// The next feed starts a new command line.
+	t.recieved.clear();
+	EXPECT_TRUE(t.opt.feed("tool.exe"));
+	EXPECT_TRUE(t.opt.feed("-fm"));
+	EXPECT_EQ(t.recieved, strings{ "flag" });
+	EXPECT_TRUE(t.opt.feed("a b c"));
+	EXPECT_EQ(t.recieved, (strings{ "flag", "multi a b c" }));
+	EXPECT_TRUE(t.opt.finish());
+
+	// Errors stop parsing, the rest is ignored.
+	t.recieved.clear();
+	printed.clear();
+	EXPECT_TRUE(t.opt.feed("tool.exe"));
+	EXPECT_FALSE(t.opt.feed("--nope"));
+	EXPECT_NE(printed.find("Option doesn't exist."), std::string::npos);
+	EXPECT_FALSE(t.opt.feed("-f"));
+	EXPECT_FALSE(t.opt.finish());
+	EXPECT_TRUE(t.recieved.empty());
+
+	// Missing values are found on finish.
+	EXPECT_TRUE(t.opt.feed("tool.exe"));
+	EXPECT_TRUE(t.opt.feed("-r"));
+	EXPECT_FALSE(t.opt.finish());
+	EXPECT_TRUE(t.recieved.empty());
+
+	// Nothing but arg0 prints help.
+	EXPECT_TRUE(t.opt.feed("tool.exe"));
+	EXPECT_FALSE(t.opt.finish());
+	EXPECT_FALSE(t.opt.finish());
+
+	// Parsing argv in between works as usual.
+	std::vector<const char*> argv{ "tool.exe", "-f" };
+	EXPECT_TRUE(t.opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(t.recieved, strings{ "flag" });
+}
+
+TEST(repl_driver, lines) {
+	test_opts t;
+	using strings = std::vector<std::string>;
+
+	fea::repl_driver<char> repl{ t.opt, "console" };
+	t.opt.add_flag_option(
+			"quit",
+			[&]() {
+				repl.stop();
+				return true;
+			},
+			"", 'q');
+
+	std::istringstream iss{ "-f --required 'a value'\r\n"
+							"\n"
+							"raw.txt -m a b c -d\n"
+							"--nope\n"
+							"   \n"
+							"-fq\n"
+							"-f\n" };
+	repl.run(iss);
+
+	EXPECT_EQ(t.recieved,
+			(strings{ "flag", "required a value", "raw raw.txt",
+					"multi a b c", "default def", "flag" }));
+	EXPECT_EQ(repl.line_count(), 4u);
+	EXPECT_EQ(repl.error_count(), 1u);
+
+	// Lines are parsed the same way through parse_line.
+	t.recieved.clear();
+	EXPECT_TRUE(repl.parse_line("-d val"));
+	EXPECT_EQ(t.recieved, strings{ "default val" });
+	EXPECT_TRUE(repl.parse_line(""));
+	EXPECT_FALSE(repl.parse_line("-r"));
+
+	// A failing arg0 callback fails the line, its options aren't parsed.
+	t.recieved.clear();
+	t.opt.add_arg0_callback([](std::string_view) { return false; });
+	EXPECT_FALSE(repl.parse_line("-f"));
+	EXPECT_TRUE(t.recieved.empty());
+	EXPECT_EQ(repl.error_count(), 3u);
+}
+
+TEST(repl_driver, throughput) {
+	// Thousands of commands, through the same parser.
+	test_opts t;
+	fea::repl_driver<char> repl{ t.opt, "console" };
+
+	for (size_t i = 0; i < 10'000; ++i) {
+		t.recieved.clear();
+		EXPECT_TRUE(repl.parse_line("-f --required val -m a b c"));
+		EXPECT_EQ(t.recieved.size(), 3u);
+	}
+	EXPECT_EQ(repl.line_count(), 10'000u);
+	EXPECT_EQ(repl.error_count(), 0u);
+}
+} // namespace
@@ -0,0 +1,283 @@
+﻿#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <fea_getopt/fea_getopt.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+std::string printed;
+
+int print_to_string(const std::string& message) {
+	printed += message;
+	return 0;
+}
+
+// Writes a temporary response file, as-is.
+std::filesystem::path write_file(
+		const std::string& name, const std::string& content) {
+	std::filesystem::path path
+			= std::filesystem::temp_directory_path() / ("fea_getopt_" + name);
+	std::ofstream ofs{ path, std::ios::binary };
+	ofs << content;
+	return path;
+}
+
+template <class CharT>
+std::vector<std::basic_string<CharT>> tokenize(
+		std::basic_string_view<CharT> text) {
+	fea::detail::response_tokenizer<CharT> tokens{ text };
+	std::vector<std::basic_string<CharT>> ret;
+	std::basic_string_view<CharT> tok;
+	while (tokens.next(tok)) {
+		ret.push_back(std::basic_string<CharT>{ tok });
+	}
+	return ret;
+}
+
+TEST(response_file, tokenizer) {
+	using strings = std::vector<std::string>;
+
+	// LF and CRLF give the same arguments.
+	EXPECT_EQ(tokenize<char>("Line1\nLine2\n\nLine4"),
+			(strings{ "Line1", "Line2", "Line4" }));
+	EXPECT_EQ(tokenize<char>("Line1\r\nLine2\r\n\r\nLine4\r\n"),
+			(strings{ "Line1", "Line2", "Line4" }));
+
+	EXPECT_EQ(tokenize<char>("  -a\t--b  c "), (strings{ "-a", "--b", "c" }));
+	EXPECT_EQ(tokenize<char>("--multi \"a b c\" 'd \"e\"' \"\" end"),
+			(strings{ "--multi", "a b c", "d \"e\"", "", "end" }));
+	EXPECT_EQ(tokenize<char>("\"unterminated quote"),
+			(strings{ "unterminated quote" }));
+	EXPECT_EQ(tokenize<char>("\xef\xbb\xbf-a"), (strings{ "-a" }));
+	EXPECT_TRUE(tokenize<char>("").empty());
+	EXPECT_TRUE(tokenize<char>(" \r\n\t ").empty());
+
+	EXPECT_EQ(tokenize<char32_t>(U"\xfeff été\r\n\"中 文\""),
+			(std::vector<std::u32string>{ U"été", U"中 文" }));
+}
+
+TEST(response_file, parsing) {
+	std::vector<std::string> recieved;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.allow_response_files();
+	opt.add_raw_option(
+			"raw",
+			[&](std::string_view s) {
+				recieved.push_back("raw " + std::string{ s });
+				return true;
+			},
+			"");
+	opt.add_flag_option(
+			"flag",
+			[&]() {
+				recieved.push_back("flag");
+				return true;
+			},
+			"", 'f');
+	opt.add_required_arg_option(
+			"required",
+			[&](std::string_view s) {
+				recieved.push_back("required " + std::string{ s });
+				return true;
+			},
+			"", 'r');
+	opt.add_multi_arg_option(
+			"multi",
+			[&](const std::vector<std::string_view>& v) {
+				std::string out = "multi";
+				for (std::string_view s : v) {
+					out += " " + std::string{ s };
+				}
+				recieved.push_back(out);
+				return true;
+			},
+			"", 'm');
+
+	auto parse = [&](std::vector<std::string> args) {
+		std::vector<const char*> argv{ "tool.exe" };
+		for (const std::string& a : args) {
+			argv.push_back(a.c_str());
+		}
+		recieved.clear();
+		printed.clear();
+		return opt.parse_options(argv.size(), argv.data());
+	};
+
+	std::filesystem::path lf = write_file("lf.txt", "--flag\n-r\nreq\n");
+	std::filesystem::path crlf
+			= write_file("crlf.txt", "--flag\r\n-r\r\n\"a req\"\r\n");
+	std::filesystem::path multi = write_file("multi.txt", "--multi a b");
+	std::filesystem::path nested
+			= write_file("nested.txt", "raw.txt @" + multi.string() + " c");
+	std::filesystem::path empty = write_file("empty.txt", "");
+	std::filesystem::path value = write_file("value.txt", "'a value'");
+	std::filesystem::path self = std::filesystem::temp_directory_path()
+			/ "fea_getopt_self.txt";
+	write_file("self.txt", "@" + self.string());
+
+	EXPECT_TRUE(parse({ "@" + lf.string() }));
+	EXPECT_EQ(recieved, (std::vector<std::string>{ "flag", "required req" }));
+
+	EXPECT_TRUE(parse({ "@" + crlf.string() }));
+	EXPECT_EQ(recieved, (std::vector<std::string>{ "flag", "required a req" }));
+
+	// Values continue after a nested file, until the next option.
+	EXPECT_TRUE(parse({ "@" + nested.string(), "d", "-f" }));
+	EXPECT_EQ(recieved,
+			(std::vector<std::string>{
+					"raw raw.txt", "multi a b c d", "flag" }));
+
+	// Option values can come from a file, empty files are skipped.
+	EXPECT_TRUE(parse({ "-r", "@" + empty.string(), "@" + value.string(),
+			"@" + empty.string(), "-f" }));
+	EXPECT_EQ(recieved,
+			(std::vector<std::string>{ "required a value", "flag" }));
+
+	// Errors.
+	EXPECT_FALSE(parse({ "-f", "@does_not_exist.txt" }));
+	EXPECT_NE(printed.find("Couldn't read response file."), std::string::npos);
+
+	EXPECT_FALSE(parse({ "@" + self.string() }));
+	EXPECT_NE(printed.find("nested too deeply"), std::string::npos);
+
+	EXPECT_FALSE(parse({ "-r", "@does_not_exist.txt" }));
+	EXPECT_TRUE(recieved.empty());
+
+	// Only with allow_response_files.
+	fea::get_opt<char> opt2{ print_to_string };
+	opt2.add_raw_option(
+			"raw",
+			[&](std::string_view s) {
+				recieved.push_back(std::string{ s });
+				return true;
+			},
+			"");
+	std::string arg = "@" + lf.string();
+	std::vector<const char*> argv{ "tool.exe", arg.c_str() };
+	recieved.clear();
+	EXPECT_TRUE(opt2.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(recieved, std::vector<std::string>{ arg });
+
+	std::filesystem::remove(lf);
+	std::filesystem::remove(crlf);
+	std::filesystem::remove(multi);
+	std::filesystem::remove(nested);
+	std::filesystem::remove(empty);
+	std::filesystem::remove(value);
+	std::filesystem::remove(self);
+}
+
+TEST(response_file, wide) {
+	std::filesystem::path path
+			= write_file("wide.txt", "--été \"中 文\"\r\n-é\r\n");
+
+	std::u32string recieved;
+	fea::get_opt<char32_t> opt{ [](const std::u32string&) { return 0; } };
+	opt.allow_response_files();
+	opt.add_multi_arg_option(
+			U"été",
+			[&](const std::vector<std::u32string_view>& v) {
+				for (std::u32string_view s : v) {
+					recieved += s;
+					recieved += U",";
+				}
+				return true;
+			},
+			U"");
+	opt.add_flag_option(
+			U"flag",
+			[&]() {
+				recieved += U"flag";
+				return true;
+			},
+			U"", U'é');
+
+	std::u32string arg = U"@" + path.u32string();
+	std::vector<const char32_t*> argv{ U"tool.exe", arg.c_str() };
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	EXPECT_EQ(recieved, U"中,文,flag");
+
+	std::filesystem::remove(path);
+}
+
+TEST(response_file, subcommand) {
+	std::filesystem::path path = write_file("sub.txt", "--jobs\n8\na.cpp");
+
+	size_t jobs = 0;
+	std::vector<std::string> files;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.allow_response_files();
+	opt.add_subcommand(
+			"build",
+			[&](fea::get_opt<char>& sub) {
+				sub.add_option<size_t>(
+						"jobs",
+						[&](size_t j) {
+							jobs = j;
+							return true;
+						},
+						"");
+				sub.add_raw_option(
+						"file",
+						[&](std::string_view f) {
+							files.push_back(std::string{ f });
+							return true;
+						},
+						"");
+			},
+			"");
+
+	// The file right after the subcommand is the subcommand's.
+	std::string arg = "@" + path.string();
+	std::vector<const char*> argv{ "tool.exe", "build", arg.c_str() };
+	printed.clear();
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data())) << printed;
+	EXPECT_EQ(jobs, 8u);
+	EXPECT_EQ(files, std::vector<std::string>{ "a.cpp" });
+
+	std::filesystem::remove(path);
+}
+
+TEST(response_file, big) {
+	// 1M arguments.
+	constexpr size_t count = 1'000'000;
+
+	std::string content = "--multi";
+	content.reserve(count * 8);
+	for (size_t i = 0; i < count; ++i) {
+		content += (i % 2 == 0) ? "\n" : "\r\n";
+		content += std::to_string(i);
+	}
+	std::filesystem::path path = write_file("big.txt", content);
+
+	size_t recieved = 0;
+	bool in_order = true;
+	fea::get_opt<char> opt{ print_to_string };
+	opt.allow_response_files();
+	opt.add_multi_arg_option(
+			"multi",
+			[&](const std::vector<std::string_view>& v) {
+				recieved = v.size();
+				in_order = v.front() == "0" && v.back() == "999999";
+				return true;
+			},
+			"");
+
+	std::string arg = "@" + path.string();
+	std::vector<const char*> argv{ "tool.exe", arg.c_str() };
+
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_TRUE(opt.parse_options(argv.size(), argv.data()));
+	std::chrono::duration<double> elapsed
+			= std::chrono::steady_clock::now() - start;
+
+	EXPECT_EQ(recieved, count);
+	EXPECT_TRUE(in_order);
+	// Generous, debug builds and slow machines.
+	EXPECT_LT(elapsed.count(), 5.0);
+
+	std::filesystem::remove(path);
+}
+} // namespace
@@ -0,0 +1,319 @@
+﻿#include <array>
+#include <filesystem>
+#include <fstream>
+#include <fea_getopt/static_get_opt.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+std::string printed;
+std::vector<std::string> recieved;
+
+int print_to_string(const std::string& message) {
+	printed += message;
+	return 0;
+}
+
+bool recieve_flag() {
+	recieved.push_back("flag");
+	return true;
+}
+
+constexpr auto make_test_opts() {
+	auto ret = fea::make_static_get_opt(
+			fea::static_raw_option(
+					"file",
+					[](std::string_view s) {
+						recieved.push_back(std::string{ s });
+						return true;
+					},
+					"A file."),
+			fea::static_flag_option("flag", &recieve_flag, "A flag.", 'f'),
+			fea::static_flag_option(
+					"flag2",
+					[]() {
+						recieved.push_back("flag2");
+						return true;
+					},
+					"Another flag.", 'g'),
+			fea::static_required_arg_option(
+					"required",
+					[](std::string_view s) {
+						recieved.push_back("required " + std::string{ s });
+						return true;
+					},
+					"Required.", 'r'),
+			fea::static_optional_arg_option(
+					"optional",
+					[](std::string_view s) {
+						recieved.push_back("optional " + std::string{ s });
+						return true;
+					},
+					"Optional."),
+			fea::static_default_arg_option(
+					"default",
+					[](std::string_view s) {
+						recieved.push_back("default " + std::string{ s });
+						return true;
+					},
+					"Default.", "d_val", 'd'),
+			fea::static_multi_arg_option(
+					"multi",
+					[](const std::vector<std::string_view>& v) {
+						std::string out = "multi";
+						for (std::string_view s : v) {
+							out += " " + std::string{ s };
+						}
+						recieved.push_back(out);
+						return true;
+					},
+					"Multi.", 'm'),
+			fea::static_flag_option(
+					"fails", []() { return false; }, "Always fails."));
+	ret.add_help_intro("Intro.");
+	return ret;
+}
+
+// Generates option names at compile time, to test big tables.
+constexpr size_t big_count = 64;
+using name_t = std::array<char, 8>;
+
+constexpr std::array<name_t, big_count> make_names() {
+	std::array<name_t, big_count> ret{};
+	for (size_t i = 0; i < big_count; ++i) {
+		ret[i][0] = 'o';
+		ret[i][1] = 'p';
+		ret[i][2] = 't';
+		ret[i][3] = char('0' + (i / 100) % 10);
+		ret[i][4] = char('0' + (i / 10) % 10);
+		ret[i][5] = char('0' + i % 10);
+	}
+	return ret;
+}
+constexpr std::array<name_t, big_count> big_names = make_names();
+
+template <size_t... Is>
+constexpr auto make_big_opts(std::index_sequence<Is...>) {
+	return fea::make_static_get_opt(fea::static_flag_option(
+			big_names[Is].data(), &recieve_flag, "", '\0')...);
+}
+
+template <class Opts>
+constexpr bool all_found(const Opts& opts) {
+	for (size_t i = 0; i < big_count; ++i) {
+		if (opts.find_long(big_names[i].data()) != i) {
+			return false;
+		}
+	}
+	return opts.find_long("opt") == Opts::npos
+			&& opts.find_long("opt2560") == Opts::npos;
+}
+
+TEST(static_get_opt, lookups) {
+	constexpr auto opts = make_test_opts();
+	using opts_t = std::decay_t<decltype(opts)>;
+
+	// Everything is resolved at compile time.
+	static_assert(opts.find_long("flag") == 1, "");
+	static_assert(opts.find_long("multi") == 6, "");
+	static_assert(opts.find_long("file") == opts_t::npos, "");
+	static_assert(opts.find_long("nope") == opts_t::npos, "");
+	static_assert(opts.find_long("") == opts_t::npos, "");
+	static_assert(opts.find_short('f') == 1, "");
+	static_assert(opts.find_short('m') == 6, "");
+	static_assert(opts.find_short('x') == opts_t::npos, "");
+
+	constexpr auto big_opts = make_big_opts(
+			std::make_index_sequence<big_count>{});
+	static_assert(all_found(big_opts), "");
+
+	// Wide short options use the sorted table.
+	constexpr auto wopts = fea::make_static_get_opt(
+			fea::static_flag_option(
+					U"a", []() { return true; }, U"", U'é'),
+			fea::static_flag_option(
+					U"b", []() { return true; }, U"", U'中'),
+			fea::static_flag_option(
+					U"c", []() { return true; }, U"", U'À'),
+			fea::static_flag_option(
+					U"d", []() { return true; }, U"", U'd'));
+	static_assert(wopts.find_short(U'é') == 0, "");
+	static_assert(wopts.find_short(U'中') == 1, "");
+	static_assert(wopts.find_short(U'À') == 2, "");
+	static_assert(wopts.find_short(U'd') == 3, "");
+	static_assert(wopts.find_short(U'Á') == size_t(-1), "");
+}
+
+TEST(static_get_opt, duplicates) {
+	// In a constant expression, these fail to compile.
+	EXPECT_THROW(fea::make_static_get_opt(
+						 fea::static_flag_option(
+								 "a", []() { return true; }, ""),
+						 fea::static_flag_option(
+								 "a", []() { return true; }, "")),
+			std::invalid_argument);
+	EXPECT_THROW(fea::make_static_get_opt(
+						 fea::static_flag_option(
+								 "a", []() { return true; }, "", 'a'),
+						 fea::static_flag_option(
+								 "b", []() { return true; }, "", 'a')),
+			std::invalid_argument);
+	EXPECT_THROW(fea::make_static_get_opt(
+						 fea::static_flag_option(
+								 "", []() { return true; }, "")),
+			std::invalid_argument);
+	EXPECT_THROW(fea::make_static_get_opt(
+						 fea::static_flag_option(
+								 "a=b", []() { return true; }, "")),
+			std::invalid_argument);
+	EXPECT_NO_THROW(fea::make_static_get_opt(
+			fea::static_flag_option("a", []() { return true; }, "", 'a'),
+			fea::static_flag_option("b", []() { return true; }, "", 'b')));
+}
+
+TEST(static_get_opt, parsing) {
+	constexpr auto opts = make_test_opts();
+
+	auto parse = [&](std::vector<const char*> argv) {
+		recieved.clear();
+		printed.clear();
+		return opts.parse_options(argv.size(), argv.data(), print_to_string);
+	};
+
+	EXPECT_TRUE(parse({ "tool.exe", "file.txt", "-fg", "--required", "req",
+			"--optional", "-d", "--multi", "a", "b", "c" }));
+	std::vector<std::string> expected{ "file.txt", "flag", "flag2",
+		"required req", "optional ", "default d_val", "multi a b c" };
+	EXPECT_EQ(recieved, expected);
+
+	EXPECT_TRUE(parse({ "tool.exe", "-m", "a b c", "-d", "val", "-r",
+			"req2", "--optional", "opt" }));
+	expected = { "multi a b c", "default val", "required req2",
+		"optional opt" };
+	EXPECT_EQ(recieved, expected);
+
+	// Concatenated options, the last one recieves the arguments.
+	EXPECT_TRUE(parse({ "tool.exe", "-gfr", "req3" }));
+	expected = { "flag2", "flag", "required req3" };
+	EXPECT_EQ(recieved, expected);
+
+	// Errors print help.
+	EXPECT_FALSE(parse({ "tool.exe", "--nope" }));
+	EXPECT_NE(printed.find("Option doesn't exist."), std::string::npos);
+	EXPECT_NE(printed.find("Intro."), std::string::npos);
+	EXPECT_NE(printed.find("Usage: tool.exe \"file\" [options]"),
+			std::string::npos);
+
+	EXPECT_FALSE(parse({ "tool.exe", "-f", "--flag" }));
+	EXPECT_NE(printed.find("'flag' already parsed."), std::string::npos);
+
+	EXPECT_FALSE(parse({ "tool.exe", "-fr" }));
+	EXPECT_NE(printed.find("Option requires an argument"), std::string::npos);
+
+	EXPECT_FALSE(parse({ "tool.exe", "-fx" }));
+	EXPECT_TRUE(recieved.empty());
+
+	EXPECT_FALSE(parse({ "tool.exe", "a.txt", "b.txt" }));
+	EXPECT_NE(printed.find("All arguments have previously been parsed."),
+			std::string::npos);
+
+	EXPECT_FALSE(parse({ "tool.exe", "--fails" }));
+	EXPECT_NE(printed.find("'fails' problem parsing argument."),
+			std::string::npos);
+
+	EXPECT_FALSE(parse({ "tool.exe", "--help" }));
+	EXPECT_TRUE(recieved.empty());
+	EXPECT_NE(printed.find("--multi <multiple>"), std::string::npos);
+
+	EXPECT_FALSE(parse({ "tool.exe" }));
+	EXPECT_FALSE(parse({}));
+}
+
+TEST(static_get_opt, grammar) {
+	constexpr auto opts = make_test_opts();
+
+	auto parse = [&](const auto& parser, std::vector<const char*> argv) {
+		recieved.clear();
+		printed.clear();
+		return parser.parse_options(
+				argv.size(), argv.data(), print_to_string);
+	};
+
+	// '--name=value', the value may be empty or contain '='.
+	EXPECT_TRUE(parse(opts,
+			{ "tool.exe", "--required=a=b", "--optional=", "--default=d",
+					"--multi=a", "b" }));
+	std::vector<std::string> expected{ "required a=b", "optional ",
+		"default d", "multi a b" };
+	EXPECT_EQ(recieved, expected);
+
+	// Attached short values, the bundle ends at the first option which
+	// takes a value.
+	EXPECT_TRUE(parse(opts, { "tool.exe", "-rreq", "-fgdval", "-mx", "y" }));
+	expected = { "required req", "flag", "flag2", "default val",
+		"multi x y" };
+	EXPECT_EQ(recieved, expected);
+
+	EXPECT_TRUE(parse(opts, { "tool.exe", "-rf" }));
+	expected = { "required f" };
+	EXPECT_EQ(recieved, expected);
+
+	// Attached values are always the option's.
+	EXPECT_TRUE(parse(opts, { "tool.exe", "-d-1" }));
+	expected = { "default -1" };
+	EXPECT_EQ(recieved, expected);
+
+	EXPECT_FALSE(parse(opts, { "tool.exe", "--flag=x" }));
+	EXPECT_NE(printed.find("Could not parse : 'flag'\n"
+						   "Option doesn't take an argument."),
+			std::string::npos);
+	EXPECT_TRUE(recieved.empty());
+
+	EXPECT_FALSE(parse(opts, { "tool.exe", "--=x" }));
+	EXPECT_NE(printed.find("Could not parse : '--=x'"), std::string::npos);
+	EXPECT_FALSE(parse(opts, { "tool.exe", "--nope=x" }));
+	EXPECT_NE(printed.find("Could not parse : 'nope'"), std::string::npos);
+
+	// get_opt only syntax.
+	EXPECT_FALSE(parse(opts, { "tool.exe", "--req", "x" }));
+	EXPECT_NE(printed.find("Option doesn't exist."), std::string::npos);
+	EXPECT_FALSE(parse(opts, { "tool.exe", "-ff" }));
+	EXPECT_NE(printed.find("'flag' already parsed."), std::string::npos);
+
+	// Response files are off by default, '@file' is a raw argument.
+	std::filesystem::path args = std::filesystem::temp_directory_path()
+			/ "fea_getopt_static_args.txt";
+	std::filesystem::path nested = std::filesystem::temp_directory_path()
+			/ "fea_getopt_static_nested.txt";
+	{
+		std::ofstream ofs{ args, std::ios::binary };
+		ofs << "-f \"--required=a b\"\n@" << nested.string() << "\n";
+	}
+	{
+		std::ofstream ofs{ nested, std::ios::binary };
+		ofs << "--multi x y";
+	}
+	std::string at_args = "@" + args.string();
+	std::string at_missing
+			= "@" + (std::filesystem::temp_directory_path() / "nope").string();
+
+	EXPECT_TRUE(parse(opts, { "tool.exe", at_args.c_str() }));
+	expected = { at_args };
+	EXPECT_EQ(recieved, expected);
+
+	auto file_opts = opts;
+	file_opts.allow_response_files();
+	EXPECT_TRUE(parse(file_opts, { "tool.exe", at_args.c_str(), "-g" }));
+	expected = { "flag", "required a b", "multi x y", "flag2" };
+	EXPECT_EQ(recieved, expected);
+
+	EXPECT_FALSE(parse(file_opts, { "tool.exe", "-f", at_missing.c_str() }));
+	EXPECT_NE(printed.find("Couldn't read response file."),
+			std::string::npos);
+
+	std::filesystem::remove(args);
+	std::filesystem::remove(nested);
+}
+} // namespace
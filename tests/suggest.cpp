@@ -0,0 +1,181 @@
+﻿#include <algorithm>
+#include <fea_getopt/compiled_options.hpp>
+#include <fea_getopt/suggest.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// Textbook dynamic programming Levenshtein distance.
+template <class CharT>
+size_t levenshtein(
+		std::basic_string_view<CharT> a, std::basic_string_view<CharT> b) {
+	std::vector<size_t> row(b.size() + 1);
+	for (size_t j = 0; j < row.size(); ++j) {
+		row[j] = j;
+	}
+	for (size_t i = 1; i <= a.size(); ++i) {
+		size_t diag = row[0];
+		row[0] = i;
+		for (size_t j = 1; j <= b.size(); ++j) {
+			size_t up = row[j];
+			size_t cost = a[i - 1] == b[j - 1] ? 0 : 1;
+			row[j] = (std::min)({ row[j] + 1, row[j - 1] + 1, diag + cost });
+			diag = up;
+		}
+	}
+	return row.back();
+}
+
+template <class CharT>
+std::basic_string<CharT> random_name(std::mt19937& gen,
+		std::basic_string_view<CharT> alphabet, size_t min_len,
+		size_t max_len) {
+	std::uniform_int_distribution<size_t> len_dist{ min_len, max_len };
+	std::uniform_int_distribution<size_t> char_dist{ 0, alphabet.size() - 1 };
+	std::basic_string<CharT> ret;
+	for (size_t i = len_dist(gen); i > 0; --i) {
+		ret += alphabet[char_dist(gen)];
+	}
+	return ret;
+}
+
+// The option names suggested.
+std::vector<std::string> suggested(
+		const fea::detail::suggestion_index<char>& suggest,
+		const fea::compiled_options<char>& index, std::string_view name) {
+	std::vector<std::string> ret;
+	for (const auto& s : suggest.find(index, name)) {
+		ret.push_back(std::string{ index.long_name(s.opt_idx) });
+	}
+	return ret;
+}
+
+TEST(suggest, edit_distance) {
+	fea::detail::edit_pattern<char> pattern;
+	EXPECT_TRUE(pattern.build("kitten"));
+	EXPECT_EQ(pattern.distance("sitting", 10), 3u);
+	EXPECT_EQ(pattern.distance("kitten", 10), 0u);
+	EXPECT_EQ(pattern.distance("", 10), 6u);
+	// Bounded.
+	EXPECT_EQ(pattern.distance("sitting", 2), 3u);
+	EXPECT_EQ(pattern.distance("xxxxxxxxxxxxxxxxxxxx", 2), 3u);
+
+	EXPECT_TRUE(pattern.build(std::string(64, 'a')));
+	EXPECT_EQ(pattern.distance(std::string(63, 'a') + "b", 10), 1u);
+	EXPECT_FALSE(pattern.build(std::string(65, 'a')));
+
+	// Random names, with non-ascii characters and repeats.
+	std::mt19937 gen{ 42 };
+	for (size_t i = 0; i < 2000; ++i) {
+		std::string a = random_name<char>(gen, "ab\xc3\xa9z", 0, 64);
+		std::string b = random_name<char>(gen, "ab\xc3\xa9z", 0, 70);
+		size_t expected = levenshtein<char>(a, b);
+		EXPECT_TRUE(pattern.build(a));
+		EXPECT_EQ(pattern.distance(b, 100), expected) << a << " " << b;
+		EXPECT_EQ(pattern.distance(b, 5), (std::min)(expected, size_t(6)));
+	}
+
+	fea::detail::edit_pattern<char16_t> wide;
+	for (size_t i = 0; i < 500; ++i) {
+		std::u16string a = random_name<char16_t>(gen, u"aé中文", 1, 64);
+		std::u16string b = random_name<char16_t>(gen, u"aé中文", 0, 64);
+		EXPECT_TRUE(wide.build(a));
+		EXPECT_EQ(wide.distance(b, 100), levenshtein<char16_t>(a, b));
+	}
+}
+
+TEST(suggest, basics) {
+	fea::compiled_options<char> index;
+	fea::detail::suggestion_index<char> suggest;
+	suggest.build(index);
+	EXPECT_TRUE(suggest.find(index, "verbose").empty());
+
+	for (const char* name : { "verbose", "version", "verbatim", "jobs", "j",
+				 "output", "input", "mode_a", "mode_b" }) {
+		index.add(name);
+	}
+	index.build();
+	suggest.build(index);
+
+	using names = std::vector<std::string>;
+	EXPECT_EQ(suggested(suggest, index, "verbos"), names{ "verbose" });
+	EXPECT_EQ(suggested(suggest, index, "vrebose"), names{ "verbose" });
+	EXPECT_EQ(suggested(suggest, index, "versoin"), names{ "version" });
+	EXPECT_EQ(suggested(suggest, index, "verbse"), names{ "verbose" });
+	EXPECT_EQ(suggested(suggest, index, "verison"), names{ "version" });
+	EXPECT_EQ(suggested(suggest, index, "jbs"), names{ "jobs" });
+	// Only the nearest, in declaration order.
+	EXPECT_EQ(suggested(suggest, index, "mode_c"),
+			(names{ "mode_a", "mode_b" }));
+	EXPECT_EQ(suggested(suggest, index, "mode_bb"), names{ "mode_b" });
+	EXPECT_EQ(suggested(suggest, index, "nput"), names{ "input" });
+	EXPECT_EQ(suggested(suggest, index, "ouput"), names{ "output" });
+
+	// Too far, or too short to tell.
+	EXPECT_TRUE(suggested(suggest, index, "x").empty());
+	EXPECT_TRUE(suggested(suggest, index, "bananas").empty());
+	EXPECT_TRUE(suggested(suggest, index, std::string(65, 'v')).empty());
+
+	// Longer than every name.
+	EXPECT_EQ(suggested(suggest, index, "verbatimmm"), names{ "verbatim" });
+	EXPECT_TRUE(suggested(suggest, index, "verbosityyyyyyyyy").empty());
+
+	EXPECT_GT(suggest.memory_usage(), 0u);
+	suggest.clear();
+	EXPECT_TRUE(suggest.find(index, "verbos").empty());
+}
+
+TEST(suggest, brute_force) {
+	std::mt19937 gen{ 42 };
+	fea::compiled_options<char> index;
+	std::vector<std::string> names;
+	while (names.size() < 1000) {
+		std::string name = random_name<char>(gen, "abcd", 1, 12);
+		if (index.find_long(name) != index.npos) {
+			continue;
+		}
+		index.insert(name);
+		names.push_back(name);
+	}
+
+	fea::detail::suggestion_index<char> suggest;
+	suggest.build(index);
+
+	using suggestion = fea::detail::suggestion_index<char>::suggestion;
+	for (size_t i = 0; i < 1000; ++i) {
+		std::string name = random_name<char>(gen, "abcde", 1, 14);
+		size_t bound = (std::min)(
+				suggest.max_distance(name.size()), name.size() - 1);
+		if (bound == 0) {
+			// Too short to suggest anything.
+			EXPECT_TRUE(suggest.find(index, name).empty());
+			continue;
+		}
+
+		std::vector<suggestion> expected;
+		for (size_t opt_idx = 0; opt_idx < names.size(); ++opt_idx) {
+			size_t d = levenshtein<char>(name, names[opt_idx]);
+			if (d > bound) {
+				continue;
+			}
+			if (!expected.empty() && d < expected.front().distance) {
+				expected.clear();
+			}
+			if (expected.empty() || d == expected.front().distance) {
+				expected.push_back({ opt_idx, d });
+			}
+		}
+		expected.resize((std::min)(expected.size(),
+				fea::detail::suggestion_index<char>::max_suggestions));
+
+		auto found = suggest.find(index, name);
+		ASSERT_EQ(found.size(), expected.size()) << name;
+		for (size_t j = 0; j < expected.size(); ++j) {
+			EXPECT_EQ(found.data[j].opt_idx, expected[j].opt_idx) << name;
+			EXPECT_EQ(found.data[j].distance, expected[j].distance) << name;
+		}
+	}
+}
+} // namespace
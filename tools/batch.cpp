@@ -0,0 +1,195 @@
+﻿#include <chrono>
+#include <cstdio>
+#include <fea_getopt/batch.hpp>
+#include <fea_getopt/fea_getopt.hpp>
+#include <fea_getopt/response_file.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+fea_getopt_batch validates a file of command lines, one per line, with all
+cores. The options of the validated command lines are described with this
+tool's options. Short names follow a ':', ex 'verbose:v'.
+
+ex :
+fea_getopt_batch --flags verbose:v --required out:o --raw 1 jobs.txt
+*/
+
+namespace {
+int print_nothing(const std::string&) {
+	return 0;
+}
+
+// Splits 'name:c' into the long and short names.
+std::pair<std::string, char> split_name(std::string_view name) {
+	if (name.size() > 2 && name[name.size() - 2] == ':') {
+		return { std::string{ name.substr(0, name.size() - 2) },
+			name.back() };
+	}
+	return { std::string{ name }, '\0' };
+}
+
+// The kinds of options this tool can describe.
+enum class option_kind {
+	flag,
+	required_arg,
+	optional_arg,
+	multi_arg,
+};
+
+void add_options(fea::get_opt_spec<char>& spec,
+		const std::vector<std::string_view>& names, option_kind kind) {
+	for (std::string_view n : names) {
+		auto [long_name, short_name] = split_name(n);
+		auto one_arg = [](std::string_view) { return true; };
+
+		switch (kind) {
+		case option_kind::flag: {
+			spec.add_flag_option(
+					std::move(long_name), []() { return true; }, "",
+					short_name);
+		} break;
+		case option_kind::required_arg: {
+			spec.add_required_arg_option(
+					std::move(long_name), one_arg, "", short_name);
+		} break;
+		case option_kind::optional_arg: {
+			spec.add_optional_arg_option(
+					std::move(long_name), one_arg, "", short_name);
+		} break;
+		case option_kind::multi_arg: {
+			spec.add_multi_arg_option(
+					std::move(long_name),
+					[](const std::vector<std::string_view>&) { return true; },
+					"", short_name);
+		} break;
+		}
+	}
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	std::vector<std::string_view> flags;
+	std::vector<std::string_view> required;
+	std::vector<std::string_view> optional;
+	std::vector<std::string_view> multi;
+	size_t num_raw = 0;
+	size_t num_threads = 0;
+	std::string path;
+
+	fea::get_opt<char> opt;
+	opt.add_raw_option(
+			"commands_file",
+			[&](std::string_view s) {
+				path = s;
+				return true;
+			},
+			"A file with one command line per line.");
+
+	auto gather = [](std::vector<std::string_view>& out) {
+		return [&](const std::vector<std::string_view>& names) {
+			out.insert(out.end(), names.begin(), names.end());
+			return true;
+		};
+	};
+	opt.add_multi_arg_option("flags", gather(flags),
+			"Flag options of the command lines.", 'f');
+	opt.add_multi_arg_option("required", gather(required),
+			"Options with a required argument.", 'r');
+	opt.add_multi_arg_option("optional", gather(optional),
+			"Options with an optional argument.", 'o');
+	opt.add_multi_arg_option(
+			"multi", gather(multi), "Options with many arguments.", 'm');
+	opt.add_option<size_t>(
+			"raw",
+			[&](size_t n) {
+				num_raw = n;
+				return true;
+			},
+			"The number of raw arguments of the command lines.");
+	opt.add_option<size_t>(
+			"threads",
+			[&](size_t n) {
+				num_threads = n;
+				return true;
+			},
+			"The number of threads, all cores by default.", 'j');
+	opt.add_help_intro("Validates a file of command lines with all cores.\n"
+					   "Short names follow a ':', ex 'verbose:v'.");
+
+	if (!opt.parse_options(size_t(argc), argv) || path.empty()) {
+		return 1;
+	}
+
+	// The validated command lines. Errors aren't printed, thousands of lines
+	// may fail.
+	fea::get_opt_spec<char> spec{ print_nothing };
+	for (size_t i = 0; i < num_raw; ++i) {
+		spec.add_raw_option(
+				"raw" + std::to_string(i),
+				[](std::string_view) { return true; }, "");
+	}
+
+	try {
+		add_options(spec, flags, option_kind::flag);
+		add_options(spec, required, option_kind::required_arg);
+		add_options(spec, optional, option_kind::optional_arg);
+		add_options(spec, multi, option_kind::multi_arg);
+		spec.freeze();
+	} catch (const std::exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+
+	fea::detail::mapped_file file;
+	if (!file.open(path)) {
+		printf("Couldn't read '%s'.\n", path.c_str());
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Split in lines, the views point into the mapped file.
+	std::vector<std::string_view> lines;
+	std::string_view content{ file.data(), file.size() };
+	while (!content.empty()) {
+		size_t pos = content.find('\n');
+		std::string_view line = content.substr(0, pos);
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		lines.push_back(line);
+
+		if (pos == std::string_view::npos) {
+			break;
+		}
+		content.remove_prefix(pos + 1);
+	}
+
+	std::vector<bool> results = fea::parse_batch(spec, lines, num_threads);
+
+	std::chrono::duration<double> elapsed
+			= std::chrono::steady_clock::now() - start;
+
+	// Report the first few failures, with 1 based line numbers.
+	constexpr size_t max_reported = 20;
+	size_t num_failed = 0;
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (results[i]) {
+			continue;
+		}
+		if (num_failed < max_reported) {
+			std::string line{ lines[i] };
+			printf("line %zu : %s\n", i + 1, line.c_str());
+		}
+		++num_failed;
+	}
+
+	double seconds = elapsed.count();
+	double lines_per_sec = seconds > 0.0 ? double(lines.size()) / seconds : 0.0;
+	printf("%zu lines, %zu invalid, %.3f s, %.0f lines/sec\n", lines.size(),
+			num_failed, seconds, lines_per_sec);
+
+	return num_failed == 0 ? 0 : 1;
+}